@@ -0,0 +1,185 @@
+/*
+	Arena and Pool Allocator Benchmarks
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "earena.h"
+#include "estrings.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+#include "internal/bench.h"
+
+static size_t bench_requests = 20000;
+static int bench_reps = 3;
+
+/*
+	A request makes ALLOCS small allocations of mixed sizes, touches them, and drops
+	them all at the end. The sizes are precomputed, so each run does the same work.
+*/
+#define ALLOCS 1000
+#define MAX_SIZE 256
+
+static uint32_t alloc_sizes[ALLOCS];
+
+static uint64_t request_malloc(void) {
+	static void *ptrs[ALLOCS];
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < ALLOCS ; ++i) {
+		char *p = malloc(alloc_sizes[i]);
+		p[0] = (char)i;
+		sum += (uintptr_t)p[0];
+		ptrs[i] = p;
+	}
+	for (size_t i = 0 ; i < ALLOCS ; ++i)
+		free(ptrs[i]);
+	return sum;
+}
+
+static uint64_t request_arena(struct arena *a) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < ALLOCS ; ++i) {
+		char *p = arena_alloc(a, alloc_sizes[i]);
+		p[0] = (char)i;
+		sum += (uintptr_t)p[0];
+	}
+	arena_reset(a);
+	return sum;
+}
+
+// Fixed-size objects, as for nodes of a list or tree.
+static uint64_t request_malloc_fixed(void) {
+	static void *ptrs[ALLOCS];
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < ALLOCS ; ++i) {
+		char *p = malloc(48);
+		p[0] = (char)i;
+		sum += (uintptr_t)p[0];
+		ptrs[i] = p;
+	}
+	for (size_t i = 0 ; i < ALLOCS ; ++i)
+		free(ptrs[i]);
+	return sum;
+}
+
+static uint64_t request_pool(struct pool *p) {
+	static void *ptrs[ALLOCS];
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < ALLOCS ; ++i) {
+		char *o = pool_get(p);
+		o[0] = (char)i;
+		sum += (uintptr_t)o[0];
+		ptrs[i] = o;
+	}
+	for (size_t i = 0 ; i < ALLOCS ; ++i)
+		pool_put(p, ptrs[i]);
+	return sum;
+}
+
+static void bench_requests_small(void) {
+	BENCH_START(small);
+
+	uint64_t state = 0x5EED;
+	for (size_t i = 0 ; i < ALLOCS ; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		alloc_sizes[i] = 8 + (state >> 33) % (MAX_SIZE - 8);
+	}
+
+	size_t n = bench_requests;
+	size_t allocs = n * ALLOCS;
+	printf("  %zu requests of %d allocations, 8-%d bytes (MB/s is millions of allocations per second)\n", n, ALLOCS, MAX_SIZE);
+
+	BENCH_RUN("malloc/free", bench_reps, allocs, for (size_t r = 0 ; r < n ; ++r) BENCH_SINK(request_malloc()));
+
+	struct arena a;
+	arena_init(&a, 0);
+	BENCH_RUN("arena", bench_reps, allocs, for (size_t r = 0 ; r < n ; ++r) BENCH_SINK(request_arena(&a)));
+	arena_free(&a);
+
+	if (arena_init_reserve(&a, (size_t)1 << 30) == 0) {
+		BENCH_RUN("arena (reserved)", bench_reps, allocs, for (size_t r = 0 ; r < n ; ++r) BENCH_SINK(request_arena(&a)));
+		arena_free(&a);
+	}
+
+	BENCH_RUN("malloc/free, 48 bytes", bench_reps, allocs, for (size_t r = 0 ; r < n ; ++r) BENCH_SINK(request_malloc_fixed()));
+
+	struct pool p;
+	pool_init(&p, 48, 1024);
+	BENCH_RUN("pool, 48 bytes", bench_reps, allocs, for (size_t r = 0 ; r < n ; ++r) BENCH_SINK(request_pool(&p)));
+	pool_free(&p);
+}
+
+static uint64_t read_files_malloc(size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t len;
+		char *data = read_entire_file("LICENSE", &len);
+		sum += len;
+		free(data);
+	}
+	return sum;
+}
+
+static uint64_t read_files_arena(struct arena *a, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t len;
+		int err;
+		read_entire_file_arena(a, "LICENSE", &len, 0, &err);
+		sum += len;
+		// A request per file.
+		arena_reset(a);
+	}
+	return sum;
+}
+
+static void bench_read_file(void) {
+	BENCH_START(read_file);
+
+	size_t n = bench_requests;
+	size_t len;
+	free(read_entire_file("LICENSE", &len));
+	printf("  %zu reads of a %zu byte file\n", n, len);
+
+	BENCH_RUN("read_entire_file", bench_reps, n * len, BENCH_SINK(read_files_malloc(n)));
+	struct arena a;
+	arena_init(&a, 0);
+	BENCH_RUN("read_entire_file_arena", bench_reps, n * len, BENCH_SINK(read_files_arena(&a, n)));
+	arena_free(&a);
+}
+
+static const struct bench {
+	const char *name;
+	void (*fn)(void);
+} benchmarks[] = {
+	{ "small", bench_requests_small },
+	{ "read_file", bench_read_file },
+};
+
+// Usage: bench_arena [number of requests [benchmark name ...]]
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		bench_requests = strtoull(argv[1], NULL, 0);
+
+	printf("Benchmarking, best of %d\n", bench_reps);
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(benchmarks) ; ++i) {
+		int run = argc <= 2;
+		for (int j = 2 ; j < argc ; ++j) {
+			run |= strcmp(argv[j], benchmarks[i].name) == 0;
+		}
+		if (run)
+			benchmarks[i].fn();
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,685 @@
+/*
+	Array Utility Functions Benchmarks
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "earrays.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+#include "internal/bench.h"
+
+static size_t bench_max_n = 10000000;
+static int bench_reps = 3;
+
+// Small arrays are sorted in batches, so each measurement covers at least this many elements.
+#define BENCH_MIN_ELEMENTS 1000000
+
+GEN_SORT(sort_u32, uint32_t, SORT_ARRAY_CMP_GT);
+GEN_SORT(sort_u64, uint64_t, SORT_ARRAY_CMP_GT);
+GEN_SORT(sort_f32, float, SORT_ARRAY_CMP_GT);
+GEN_PARALLEL_SORT(psort_u32, uint32_t, SORT_ARRAY_CMP_GT);
+GEN_SORT(sort_cstr_gen, const char *, SORT_ARRAY_CMP_CSTR_ASC);
+GEN_SORT_DATA(sort_perm_u32, uint32_t, SORT_ARRAY_CMP_PERM_GT, const uint32_t *);
+
+static uint32_t *make_random_u32(size_t n, uint32_t seed) {
+	uint32_t *data = malloc(n * sizeof(*data));
+	if (!data)
+		return NULL;
+	uint32_t x = seed;
+	for (size_t i = 0 ; i < n ; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		data[i] = x;
+	}
+	return data;
+}
+
+static int cmp_u32_qsort(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+static int is_sorted_u32(const uint32_t *arr, size_t n) {
+	for (size_t i = 1 ; i < n ; ++i) {
+		if (arr[i - 1] > arr[i])
+			return 0;
+	}
+	return 1;
+}
+
+enum sort_method { SORT_QSORT, SORT_INSERTION, SORT_GEN, SORT_NET };
+
+// Sort total/n arrays of n elements each. The copy from src is included in the time.
+static void sort_batch(uint32_t *dst, const uint32_t *src, size_t total, size_t n, enum sort_method method) {
+	memcpy(dst, src, total * sizeof(*dst));
+	for (uint32_t *arr = dst ; arr + n <= dst + total ; arr += n) {
+		switch (method) {
+			case SORT_QSORT:
+				qsort(arr, n, sizeof(*arr), cmp_u32_qsort);
+				break;
+			case SORT_INSERTION:
+				sort_array(arr, n);
+				break;
+			case SORT_GEN:
+				sort_u32(arr, n);
+				break;
+			case SORT_NET:
+				sort_small_u32(arr, n);
+				break;
+		}
+	}
+}
+
+static void bench_sort(void) {
+	BENCH_START(sort);
+
+	size_t max_total = MAX(bench_max_n, (size_t)BENCH_MIN_ELEMENTS);
+	uint32_t *src = make_random_u32(max_total, 0xBEEF);
+	uint32_t *dst = malloc(max_total * sizeof(*dst));
+	if (!src || !dst) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+
+	for (size_t n = 10 ; n <= bench_max_n ; n *= 10) {
+		size_t total = MAX(n, (size_t)BENCH_MIN_ELEMENTS) / n * n;
+		size_t bytes = total * sizeof(*dst);
+
+		printf("  n=%zu, %zu arrays\n", n, total / n);
+		BENCH_RUN("qsort", bench_reps, bytes, sort_batch(dst, src, total, n, SORT_QSORT));
+		// The insertion sort is quadratic, don't wait for it on large arrays.
+		if (n <= 10000) {
+			BENCH_RUN("sort_array (insertion sort)", bench_reps, bytes, sort_batch(dst, src, total, n, SORT_INSERTION));
+		}
+		BENCH_RUN("GEN_SORT", bench_reps, bytes, sort_batch(dst, src, total, n, SORT_GEN));
+		for (size_t i = 0 ; i < total ; i += n) {
+			if (!is_sorted_u32(dst + i, n)) {
+				fprintf(stderr, "GEN_SORT output not sorted!\n");
+				break;
+			}
+		}
+	}
+
+out:
+	free(dst);
+	free(src);
+}
+
+static void bench_small(void) {
+	BENCH_START(small);
+
+	const size_t sizes[] = { 4, 8, 12, 16, 24, 32 };
+	size_t max_total = BENCH_MIN_ELEMENTS;
+	uint32_t *src = make_random_u32(max_total, 0xCAFE);
+	uint32_t *dst = malloc(max_total * sizeof(*dst));
+	if (!src || !dst) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		size_t total = max_total / n * n;
+		size_t bytes = total * sizeof(*dst);
+
+		printf("  n=%zu, %zu arrays\n", n, total / n);
+		BENCH_RUN("sort_array (insertion sort)", bench_reps, bytes, sort_batch(dst, src, total, n, SORT_INSERTION));
+		BENCH_RUN("GEN_SORT", bench_reps, bytes, sort_batch(dst, src, total, n, SORT_GEN));
+		BENCH_RUN("sort_small_u32 (network)", bench_reps, bytes, sort_batch(dst, src, total, n, SORT_NET));
+		for (size_t i = 0 ; i < total ; i += n) {
+			if (!is_sorted_u32(dst + i, n)) {
+				fprintf(stderr, "sort_small_u32 output not sorted!\n");
+				break;
+			}
+		}
+	}
+
+out:
+	free(dst);
+	free(src);
+}
+
+static void psort_run(uint32_t *dst, const uint32_t *src, size_t n, int threads) {
+	memcpy(dst, src, n * sizeof(*dst));
+	psort_u32(dst, n, threads);
+}
+
+static void bench_parallel(void) {
+	BENCH_START(parallel);
+
+	const int threads[] = { 1, 2, 4, 8, 16, 32 };
+	size_t n = bench_max_n;
+	uint32_t *src = make_random_u32(n, 0xD00D);
+	uint32_t *dst = malloc(n * sizeof(*dst));
+	if (!src || !dst) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+
+	size_t bytes = n * sizeof(*dst);
+	printf("  n=%zu, %ld online CPUs\n", n, sysconf(_SC_NPROCESSORS_ONLN));
+	BENCH_RUN("GEN_SORT", bench_reps, bytes, memcpy(dst, src, bytes); sort_u32(dst, n));
+	for (size_t t = 0 ; t < ARRAY_SIZE(threads) ; ++t) {
+		char label[64];
+		snprintf(label, sizeof(label), "GEN_PARALLEL_SORT, %d threads", threads[t]);
+		BENCH_RUN(label, bench_reps, bytes, psort_run(dst, src, n, threads[t]));
+		if (!is_sorted_u32(dst, n))
+			fprintf(stderr, "GEN_PARALLEL_SORT output not sorted!\n");
+	}
+
+out:
+	free(dst);
+	free(src);
+}
+
+static int cmp_cstr_qsort(const void *a, const void *b) {
+	return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+enum cstr_method { CSTR_QSORT, CSTR_INSERTION, CSTR_GEN, CSTR_SORT, CSTR_PERM };
+
+static void cstr_run(const char **dst, const char **src, size_t n, enum cstr_method method, uint32_t *perm) {
+	memcpy(dst, src, n * sizeof(*dst));
+	switch (method) {
+		case CSTR_QSORT:
+			qsort(dst, n, sizeof(*dst), cmp_cstr_qsort);
+			break;
+		case CSTR_INSERTION:
+			sort_array_cmp(dst, n, SORT_ARRAY_CMP_CSTR_ASC);
+			break;
+		case CSTR_GEN:
+			sort_cstr_gen(dst, n);
+			break;
+		case CSTR_SORT:
+			sort_cstr(dst, n, SORT_CSTR_ASC);
+			break;
+		case CSTR_PERM:
+			sort_cstr_perm(src, n, perm, SORT_CSTR_ASC);
+			break;
+	}
+}
+
+// Symbol-table like keys: long shared prefixes, distinguished late.
+static void bench_cstr(void) {
+	BENCH_START(cstr);
+
+	const size_t max_n = MIN(bench_max_n, (size_t)2000000);
+	const size_t width = 48;
+	char *pool = malloc(max_n * width);
+	const char **src = malloc(max_n * sizeof(*src));
+	const char **dst = malloc(max_n * sizeof(*dst));
+	uint32_t *perm = malloc(max_n * sizeof(*perm));
+	uint32_t *rnd = make_random_u32(max_n, 0x5717);
+	if (!pool || !src || !dst || !perm || !rnd) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+	for (size_t i = 0 ; i < max_n ; ++i) {
+		char *p = pool + i * width;
+		snprintf(p, width, "eutils::module%u::func_%08x", (unsigned)(rnd[i] % 16), (unsigned)rnd[i]);
+		src[i] = p;
+	}
+
+	for (size_t n = 1000 ; n <= max_n ; n *= 10) {
+		size_t bytes = n * sizeof(*dst);
+		printf("  n=%zu\n", n);
+		BENCH_RUN("qsort(strcmp)", bench_reps, bytes, cstr_run(dst, src, n, CSTR_QSORT, NULL));
+		if (n <= 10000) {
+			BENCH_RUN("sort_array_cmp (insertion sort)", bench_reps, bytes, cstr_run(dst, src, n, CSTR_INSERTION, NULL));
+		}
+		BENCH_RUN("GEN_SORT(CSTR_ASC)", bench_reps, bytes, cstr_run(dst, src, n, CSTR_GEN, NULL));
+		BENCH_RUN("sort_cstr", bench_reps, bytes, cstr_run(dst, src, n, CSTR_SORT, NULL));
+		for (size_t i = 1 ; i < n ; ++i) {
+			if (strcmp(dst[i - 1], dst[i]) > 0) {
+				fprintf(stderr, "sort_cstr output not sorted!\n");
+				break;
+			}
+		}
+		BENCH_RUN("sort_cstr_perm", bench_reps, bytes, cstr_run(dst, src, n, CSTR_PERM, perm));
+	}
+
+out:
+	free(rnd);
+	free(perm);
+	free(dst);
+	free(src);
+	free(pool);
+}
+
+static void bench_reverse(void) {
+	BENCH_START(reverse);
+
+	size_t n = bench_max_n;
+	uint32_t *arr = make_random_u32(n, 0xAB);
+	if (!arr) {
+		fprintf(stderr, "allocation failed\n");
+		return;
+	}
+
+	uint8_t *bytes = (uint8_t*)arr;
+	printf("  n=%zu\n", n);
+	BENCH_RUN("u8: reverse_array", bench_reps, n, reverse_array(bytes, n));
+	BENCH_RUN("u8: reverse_array_u8", bench_reps, n, reverse_array_u8(bytes, n));
+	BENCH_RUN("u32: reverse_array", bench_reps, 4 * n, reverse_array(arr, n));
+	BENCH_RUN("u32: reverse_array_u32", bench_reps, 4 * n, reverse_array_u32(arr, n));
+	BENCH_SINK(arr[0]);
+
+	free(arr);
+}
+
+static int rot_u32_ctx;
+static uint32_t rot_u32_buf[4096];
+GEN_ROTATE_ARRAY_CB(rotate_u32_cb, uint32_t);
+GEN_ROTATE_ARRAY_RANGE_CB(rotate_u32_range_cb, uint32_t);
+
+static void bench_rotate(void) {
+	BENCH_START(rotate);
+
+	size_t n = bench_max_n;
+	uint32_t *arr = make_random_u32(n, 0xCD);
+	if (!arr) {
+		fprintf(stderr, "allocation failed\n");
+		return;
+	}
+
+	uint8_t *bytes = (uint8_t*)arr;
+	const ptrdiff_t shifts[] = { 100, (ptrdiff_t)n / 3 };
+	for (size_t k = 0 ; k < ARRAY_SIZE(shifts) ; ++k) {
+		ptrdiff_t d = shifts[k];
+		printf("  n=%zu, d=%td\n", n, d);
+		BENCH_RUN("u8: rotate_array", bench_reps, n, rotate_array(bytes, n, d));
+		BENCH_RUN("u8: rotate_array_mem", bench_reps, n, rotate_array_mem(bytes, n, 1, d));
+		BENCH_RUN("u32: rotate_array", bench_reps, 4 * n, rotate_array(arr, n, d));
+		if (n <= INT32_MAX) {
+			BENCH_RUN("u32: rotate_array_cb (juggling)", bench_reps, 4 * n, rotate_array_cb(arr, n, d, rotate_u32_cb, &rot_u32_ctx));
+		}
+		BENCH_RUN("u32: rotate_array_range_cb", bench_reps, 4 * n, rotate_array_range_cb(arr, n, d, ARRAY_SIZE(rot_u32_buf), rotate_u32_range_cb, rot_u32_buf));
+		BENCH_RUN("u32: rotate_array_mem", bench_reps, 4 * n, rotate_array_mem(arr, n, sizeof(*arr), d));
+	}
+	BENCH_SINK(arr[0]);
+
+	free(arr);
+}
+
+enum radix_method { RADIX_GEN, RADIX_SORT, RADIX_PERM_GEN, RADIX_PERM };
+
+// Sort the first n elements of src as u32, u64 (two u32 per key) and f32, or argsort them.
+static void radix_run(void *dst, const uint32_t *src, size_t n, int width, enum radix_method method, uint32_t *perm) {
+	memcpy(dst, src, n * (width == 64 ? 8 : 4));
+	switch (method) {
+		case RADIX_GEN:
+			if (width == 64)
+				sort_u64(dst, n);
+			else if (width == 'f')
+				sort_f32(dst, n);
+			else
+				sort_u32(dst, n);
+			break;
+		case RADIX_SORT:
+			if (width == 64)
+				radix_sort_u64(dst, n, NULL);
+			else if (width == 'f')
+				radix_sort_f32(dst, n, NULL);
+			else
+				radix_sort_u32(dst, n, NULL);
+			break;
+		case RADIX_PERM_GEN:
+			for (size_t i = 0 ; i < n ; ++i)
+				perm[i] = i;
+			sort_perm_u32(perm, n, src);
+			break;
+		case RADIX_PERM:
+			radix_argsort_u32(src, n, perm);
+			break;
+	}
+}
+
+static void bench_radix(void) {
+	BENCH_START(radix);
+
+	size_t n = bench_max_n;
+	uint32_t *src = make_random_u32(2 * n, 0xF00D);
+	float *srcf = malloc(n * sizeof(*srcf));
+	uint64_t *dst = malloc(n * sizeof(*dst));
+	uint32_t *perm = malloc(n * sizeof(*perm));
+	if (!src || !srcf || !dst || !perm) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+	for (size_t i = 0 ; i < n ; ++i)
+		srcf[i] = (float)(int32_t)src[i] / 65536.0f;
+
+	size_t bytes = n * sizeof(uint32_t);
+	printf("  n=%zu\n", n);
+	BENCH_RUN("u32: qsort", bench_reps, bytes, memcpy(dst, src, bytes); qsort(dst, n, sizeof(uint32_t), cmp_u32_qsort));
+	BENCH_RUN("u32: GEN_SORT", bench_reps, bytes, radix_run(dst, src, n, 32, RADIX_GEN, NULL));
+	BENCH_RUN("u32: radix_sort_u32", bench_reps, bytes, radix_run(dst, src, n, 32, RADIX_SORT, NULL));
+	if (!is_sorted_u32((const uint32_t*)dst, n))
+		fprintf(stderr, "radix_sort_u32 output not sorted!\n");
+	BENCH_RUN("u64: GEN_SORT", bench_reps, 2 * bytes, radix_run(dst, src, n, 64, RADIX_GEN, NULL));
+	BENCH_RUN("u64: radix_sort_u64", bench_reps, 2 * bytes, radix_run(dst, src, n, 64, RADIX_SORT, NULL));
+	BENCH_RUN("f32: GEN_SORT", bench_reps, bytes, radix_run(dst, (const uint32_t*)srcf, n, 'f', RADIX_GEN, NULL));
+	BENCH_RUN("f32: radix_sort_f32", bench_reps, bytes, radix_run(dst, (const uint32_t*)srcf, n, 'f', RADIX_SORT, NULL));
+	BENCH_RUN("argsort: GEN_SORT_DATA", bench_reps, bytes, radix_run(dst, src, n, 32, RADIX_PERM_GEN, perm));
+	BENCH_RUN("argsort: radix_argsort_u32", bench_reps, bytes, radix_run(dst, src, n, 32, RADIX_PERM, perm));
+	for (size_t i = 1 ; i < n ; ++i) {
+		if (src[perm[i - 1]] > src[perm[i]]) {
+			fprintf(stderr, "radix_argsort_u32 output not sorted!\n");
+			break;
+		}
+	}
+
+out:
+	free(perm);
+	free(dst);
+	free(srcf);
+	free(src);
+}
+
+GEN_SEARCH(search_u32, uint32_t, SORT_ARRAY_CMP_GT);
+GEN_EYTZINGER(eyt_u32, uint32_t, SORT_ARRAY_CMP_GT);
+
+#define SEARCH_LOOKUPS 1000000
+
+enum search_method { SEARCH_BSEARCH, SEARCH_BRANCHY, SEARCH_BRANCHLESS, SEARCH_EYTZINGER };
+
+// The textbook loop, for reference.
+static size_t lower_bound_branchy(const uint32_t *arr, size_t n, uint32_t key) {
+	size_t lo = 0, hi = n;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (arr[mid] < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static uint64_t search_run(const uint32_t *table, size_t n, const uint32_t *queries, enum search_method method) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < SEARCH_LOOKUPS ; ++i) {
+		switch (method) {
+			case SEARCH_BSEARCH: {
+				const uint32_t *p = bsearch(&queries[i], table, n, sizeof(*table), cmp_u32_qsort);
+				sum += p != NULL;
+				break;
+			}
+			case SEARCH_BRANCHY:
+				sum += lower_bound_branchy(table, n, queries[i]);
+				break;
+			case SEARCH_BRANCHLESS:
+				sum += search_u32_lower_bound(table, n, queries[i]);
+				break;
+			case SEARCH_EYTZINGER:
+				sum += eyt_u32_lower_bound(table, n, queries[i]);
+				break;
+		}
+	}
+	return sum;
+}
+
+static void bench_search(void) {
+	BENCH_START(search);
+
+	long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (llc <= 0)
+		llc = 8 * 1024 * 1024;
+	size_t max_n = 10 * (size_t)llc / sizeof(uint32_t);
+	printf("  %d random lookups per run, LLC %ld KiB, table sizes up to %zu KiB\n", SEARCH_LOOKUPS, llc / 1024, max_n * sizeof(uint32_t) / 1024);
+
+	uint32_t *full = make_random_u32(max_n, 0x5EA2C4);
+	uint32_t *table = malloc(max_n * sizeof(*table));
+	uint32_t *queries = make_random_u32(SEARCH_LOOKUPS, 0xACE);
+	// One spare slot since the Eytzinger index is 1-based, aligned so each node block is a cache line.
+	size_t eyt_bytes = ((max_n + 1) * sizeof(uint32_t) + 63) & ~(size_t)63;
+	uint32_t *eyt = aligned_alloc(64, eyt_bytes);
+	if (!full || !table || !queries || !eyt) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+	radix_sort_u32(full, max_n, table);
+
+	const struct {
+		const char *name;
+		enum search_method method;
+	} methods[] = {
+		{ "bsearch", SEARCH_BSEARCH },
+		{ "branchy", SEARCH_BRANCHY },
+		{ "GEN_SEARCH", SEARCH_BRANCHLESS },
+		{ "GEN_EYTZINGER", SEARCH_EYTZINGER },
+	};
+
+	size_t bytes = SEARCH_LOOKUPS * sizeof(uint32_t);
+	for (size_t n = 1024 ; ; n *= 4) {
+		if (n > max_n)
+			n = max_n;
+		// Subsample the full table, so every size has the same key distribution.
+		size_t stride = max_n / n;
+		for (size_t i = 0 ; i < n ; ++i)
+			table[i] = full[i * stride];
+		eyt_u32_build(eyt, table, n);
+		for (size_t m = 0 ; m < ARRAY_SIZE(methods) ; ++m) {
+			char label[64];
+			snprintf(label, sizeof(label), "%s, %zu KiB", methods[m].name, n * sizeof(uint32_t) / 1024);
+			const uint32_t *arr = methods[m].method == SEARCH_EYTZINGER ? eyt : table;
+			BENCH_RUN(label, bench_reps, bytes, BENCH_SINK(search_run(arr, n, queries, methods[m].method)));
+		}
+		if (n == max_n)
+			break;
+	}
+
+out:
+	free(eyt);
+	free(queries);
+	free(table);
+	free(full);
+}
+
+GEN_SELECT(select_u32, uint32_t, SORT_ARRAY_CMP_GT);
+GEN_SELECT(select_u32_desc, uint32_t, SORT_ARRAY_CMP_LT);
+
+enum pct_method { PCT_SORT, PCT_SELECT, PCT_HEAP };
+
+// p50, p99 and p999 of src, the way a latency report would compute them.
+static uint64_t percentiles_run(uint32_t *dst, const uint32_t *src, size_t n, enum pct_method method, uint32_t *heap) {
+	const size_t k50 = n / 2, k99 = n * 99 / 100, k999 = n * 999 / 1000;
+	memcpy(dst, src, n * sizeof(*dst));
+	switch (method) {
+		case PCT_SORT:
+			sort_u32(dst, n);
+			return (uint64_t)dst[k50] + dst[k99] + dst[k999];
+		case PCT_SELECT:
+			// Each selection leaves the later percentiles to the right of the previous.
+			select_u32_select_nth(dst, n, k50);
+			select_u32_select_nth(dst + k50 + 1, n - k50 - 1, k99 - k50 - 1);
+			select_u32_select_nth(dst + k99 + 1, n - k99 - 1, k999 - k99 - 1);
+			return (uint64_t)dst[k50] + dst[k99] + dst[k999];
+		case PCT_HEAP: {
+			// Only the tail, streamed through a heap of the n - k99 largest.
+			size_t count = 0;
+			for (size_t i = 0 ; i < n ; ++i)
+				select_u32_desc_topk_push(heap, &count, n - k99, src[i]);
+			select_u32_desc_topk_sort(heap, count);
+			return (uint64_t)heap[n - 1 - k99] + heap[n - 1 - k999];
+		}
+	}
+	return 0;
+}
+
+static void bench_select(void) {
+	BENCH_START(select);
+
+	size_t n = bench_max_n;
+	uint32_t *src = make_random_u32(n, 0x9999);
+	uint32_t *dst = malloc(n * sizeof(*dst));
+	uint32_t *heap = malloc((n - n * 99 / 100) * sizeof(*heap));
+	if (!src || !dst || !heap) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+
+	size_t bytes = n * sizeof(*dst);
+	printf("  p50, p99 and p999 of n=%zu\n", n);
+	BENCH_RUN("GEN_SORT", bench_reps, bytes, BENCH_SINK(percentiles_run(dst, src, n, PCT_SORT, heap)));
+	uint64_t expected = percentiles_run(dst, src, n, PCT_SORT, heap);
+	BENCH_RUN("GEN_SELECT select_nth", bench_reps, bytes, BENCH_SINK(percentiles_run(dst, src, n, PCT_SELECT, heap)));
+	if (percentiles_run(dst, src, n, PCT_SELECT, heap) != expected)
+		fprintf(stderr, "select_nth percentiles mismatch!\n");
+	uint32_t median = dst[n / 2];
+	BENCH_RUN("GEN_SELECT topk heap (p99, p999 only)", bench_reps, bytes, BENCH_SINK(percentiles_run(dst, src, n, PCT_HEAP, heap)));
+	if (percentiles_run(dst, src, n, PCT_HEAP, heap) != expected - median)
+		fprintf(stderr, "topk heap percentiles mismatch!\n");
+
+out:
+	free(heap);
+	free(dst);
+	free(src);
+}
+
+// The loops the kernels replace, left to the auto-vectorizer.
+static void clamp_f32_macro(float *dst, const float *src, size_t n, float lo, float hi) {
+	for (size_t i = 0 ; i < n ; ++i)
+		dst[i] = CLAMP(src[i], lo, hi);
+}
+
+static void clamp_u8_macro(uint8_t *dst, const uint8_t *src, size_t n, uint8_t lo, uint8_t hi) {
+	for (size_t i = 0 ; i < n ; ++i)
+		dst[i] = CLAMP(src[i], lo, hi);
+}
+
+static float minmax_f32_macro(const float *arr, size_t n) {
+	float mn = arr[0], mx = arr[0];
+	for (size_t i = 1 ; i < n ; ++i) {
+		mn = MIN(mn, arr[i]);
+		mx = MAX(mx, arr[i]);
+	}
+	return mx - mn;
+}
+
+static int32_t minmax_i32_macro(const int32_t *arr, size_t n) {
+	int32_t mn = arr[0], mx = arr[0];
+	for (size_t i = 1 ; i < n ; ++i) {
+		mn = MIN(mn, arr[i]);
+		mx = MAX(mx, arr[i]);
+	}
+	return mx - mn;
+}
+
+static void lerp_f32_macro(float *dst, const float *v0, const float *v1, size_t n, float t) {
+	for (size_t i = 0 ; i < n ; ++i)
+		dst[i] = LERP(v0[i], v1[i], t);
+}
+
+static void lerp_u8_macro(uint8_t *dst, const uint8_t *v0, const uint8_t *v1, size_t n, float t) {
+	for (size_t i = 0 ; i < n ; ++i)
+		dst[i] = LERP(v0[i], v1[i], t);
+}
+
+static float minmax_f32_kernel(const float *arr, size_t n) {
+	float mn = 0.0f, mx = 0.0f;
+	minmax_reduce_f32(arr, n, &mn, &mx);
+	return mx - mn;
+}
+
+static int32_t minmax_i32_kernel(const int32_t *arr, size_t n) {
+	int32_t mn = 0, mx = 0;
+	minmax_reduce_i32(arr, n, &mn, &mx);
+	return mx - mn;
+}
+
+static void bench_kernels(void) {
+	BENCH_START(kernels);
+
+	size_t n = bench_max_n;
+	uint32_t *src = make_random_u32(n, 0x1E2);
+	uint32_t *src2 = make_random_u32(n, 0x1E3);
+	float *f = malloc(n * sizeof(*f));
+	float *f2 = malloc(n * sizeof(*f2));
+	float *fout = malloc(n * sizeof(*fout));
+	uint8_t *bout = malloc(n);
+	if (!src || !src2 || !f || !f2 || !fout || !bout) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+	for (size_t i = 0 ; i < n ; ++i) {
+		f[i] = (float)(int32_t)src[i] / 1e9f;
+		f2[i] = (float)(int32_t)src2[i] / 1e9f;
+	}
+	// Sample bytes from the random words, which don't have to stay intact.
+	const uint8_t *b = (const uint8_t*)src;
+	const uint8_t *b2 = (const uint8_t*)src2;
+	const int32_t *d = (const int32_t*)src;
+
+	printf("  n=%zu\n", n);
+	size_t fbytes = n * sizeof(float);
+	BENCH_RUN("CLAMP loop, f32", bench_reps, fbytes, clamp_f32_macro(fout, f, n, -1.0f, 1.0f); BENCH_SINK(fout[0]));
+	BENCH_RUN("clamp_f32", bench_reps, fbytes, clamp_f32(fout, f, n, -1.0f, 1.0f); BENCH_SINK(fout[0]));
+	BENCH_RUN("CLAMP loop, u8", bench_reps, n, clamp_u8_macro(bout, b, n, 16, 235); BENCH_SINK(bout[0]));
+	BENCH_RUN("clamp_u8", bench_reps, n, clamp_u8(bout, b, n, 16, 235); BENCH_SINK(bout[0]));
+	BENCH_RUN("MIN/MAX loop, f32", bench_reps, fbytes, BENCH_SINK(minmax_f32_macro(f, n)));
+	BENCH_RUN("minmax_reduce_f32", bench_reps, fbytes, BENCH_SINK(minmax_f32_kernel(f, n)));
+	BENCH_RUN("MIN/MAX loop, i32", bench_reps, fbytes, BENCH_SINK(minmax_i32_macro(d, n)));
+	BENCH_RUN("minmax_reduce_i32", bench_reps, fbytes, BENCH_SINK(minmax_i32_kernel(d, n)));
+	BENCH_RUN("LERP loop, f32", bench_reps, fbytes, lerp_f32_macro(fout, f, f2, n, 0.3f); BENCH_SINK(fout[0]));
+	BENCH_RUN("lerp_f32", bench_reps, fbytes, lerp_f32(fout, f, f2, n, 0.3f); BENCH_SINK(fout[0]));
+	BENCH_RUN("LERP loop, u8 through float", bench_reps, n, lerp_u8_macro(bout, b, b2, n, 0.3f); BENCH_SINK(bout[0]));
+	BENCH_RUN("lerp_u8", bench_reps, n, lerp_u8(bout, b, b2, n, 77); BENCH_SINK(bout[0]));
+
+out:
+	free(bout);
+	free(fout);
+	free(f2);
+	free(f);
+	free(src2);
+	free(src);
+}
+
+static const struct bench {
+	const char *name;
+	void (*fn)(void);
+} benchmarks[] = {
+	{ "sort", bench_sort },
+	{ "small", bench_small },
+	{ "radix", bench_radix },
+	{ "parallel", bench_parallel },
+	{ "cstr", bench_cstr },
+	{ "reverse", bench_reverse },
+	{ "rotate", bench_rotate },
+	{ "search", bench_search },
+	{ "select", bench_select },
+	{ "kernels", bench_kernels },
+};
+
+// Usage: bench_arrays [max number of elements [benchmark name ...]]
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		bench_max_n = strtoull(argv[1], NULL, 0);
+
+	printf("Benchmarking with up to %zu elements, best of %d\n", bench_max_n, bench_reps);
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(benchmarks) ; ++i) {
+		int run = argc <= 2;
+		for (int j = 2 ; j < argc ; ++j) {
+			run |= strcmp(argv[j], benchmarks[i].name) == 0;
+		}
+		if (run)
+			benchmarks[i].fn();
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*
+	Batched File Loading Benchmarks
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "estrings.h"
+#include "efiles.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+#include "internal/bench.h"
+
+static size_t num_files = 10000;
+static size_t max_file_size = 8192;
+static int bench_reps = 5;
+
+static size_t load_loop(const char **names, size_t n, struct file_blob *out) {
+	size_t failed = 0;
+	for (size_t i = 0 ; i < n ; ++i) {
+		out[i].data = out[i].alloc = read_entire_file(names[i], &out[i].len);
+		failed += out[i].data == NULL;
+	}
+	return failed;
+}
+
+static void bench_read_files(void) {
+	BENCH_START(read_files);
+
+	// Prefer tmpfs, so we measure syscall overhead and not the disk.
+	struct stat sb;
+	char dir[64];
+	int have_shm = stat("/dev/shm", &sb) == 0 && S_ISDIR(sb.st_mode);
+	snprintf(dir, sizeof(dir), "%s/eutils_bench_XXXXXX", have_shm ? "/dev/shm" : "/tmp");
+	if (!mkdtemp(dir)) {
+		fprintf(stderr, "failed to create directory\n");
+		return;
+	}
+
+	char **paths = calloc(num_files, sizeof(*paths));
+	const char **names = calloc(num_files, sizeof(*names));
+	struct file_blob *out = calloc(num_files, sizeof(*out));
+	char *data = malloc(max_file_size);
+	size_t total = 0;
+	memset(data, 'x', max_file_size);
+
+	// File sizes from 1 byte to max_file_size, like a directory of configs and small assets.
+	uint32_t x = 0x5EED;
+	for (size_t i = 0 ; i < num_files ; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		size_t len = 1 + x % max_file_size;
+		paths[i] = malloc(sizeof(dir) + 32);
+		snprintf(paths[i], sizeof(dir) + 32, "%s/%zu", dir, i);
+		names[i] = paths[i];
+		FILE *f = fopen(paths[i], "wb");
+		if (!f || fwrite(data, 1, len, f) != len) {
+			fprintf(stderr, "failed to create test file '%s'\n", paths[i]);
+		}
+		if (f)
+			fclose(f);
+		total += len;
+	}
+	free(data);
+
+	printf("  %zu files, %zu bytes in '%s'\n", num_files, total, dir);
+
+	size_t failed = 0;
+	BENCH_RUN("read_entire_file loop", bench_reps, total,
+		failed += load_loop(names, num_files, out); read_files_free(out, num_files));
+	BENCH_RUN("read_files, io_uring", bench_reps, total,
+		failed += read_files(names, num_files, out, 0); read_files_free(out, num_files));
+	BENCH_RUN("read_files, io_uring, slab", bench_reps, total,
+		failed += read_files(names, num_files, out, READFILES_SLAB); read_files_free(out, num_files));
+	BENCH_RUN("read_files, thread pool", bench_reps, total,
+		failed += read_files(names, num_files, out, READFILES_NO_URING); read_files_free(out, num_files));
+	BENCH_RUN("read_files, thread pool, slab", bench_reps, total,
+		failed += read_files(names, num_files, out, READFILES_NO_URING | READFILES_SLAB); read_files_free(out, num_files));
+	if (failed)
+		fprintf(stderr, "%zu loads failed\n", failed);
+
+	for (size_t i = 0 ; i < num_files ; ++i) {
+		unlink(paths[i]);
+		free(paths[i]);
+	}
+	rmdir(dir);
+	free(paths);
+	free(names);
+	free(out);
+}
+
+// Usage: bench_files [number of files [max file size]]
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		num_files = strtoull(argv[1], NULL, 0);
+	if (argc > 2)
+		max_file_size = strtoull(argv[2], NULL, 0);
+	if (num_files == 0 || max_file_size == 0) {
+		fprintf(stderr, "Usage: %s [number of files [max file size]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("Benchmarking, best of %d\n", bench_reps);
+	bench_read_files();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*
+	Checksum and Hashing Benchmarks
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "ehash.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+#include "internal/bench.h"
+
+static size_t bench_max_size = (size_t)1 << 30;
+static int bench_reps = 3;
+
+// Each measurement processes at least this many bytes, by repeating small sizes.
+#define BENCH_BYTES (256 * 1024 * 1024)
+
+// The classic one table, one byte at a time CRC, for reference.
+static uint32_t crc32c_bytewise(uint32_t crc, const uint8_t *p, size_t len) {
+	static uint32_t table[256];
+	if (!table[1]) {
+		for (uint32_t i = 0 ; i < 256 ; ++i) {
+			uint32_t c = i;
+			for (int k = 0 ; k < 8 ; ++k)
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	while (len--)
+		crc = (crc >> 8) ^ table[(crc ^ *p++) & 0xFF];
+	return ~crc;
+}
+
+#ifdef EHASH_CRC32C_SSE42
+// One dependent chain of crc32 instructions, to show what the three-way split gains.
+EUTILS_TARGET_SSE42 static uint32_t crc32c_one_stream(uint32_t crc, const uint8_t *p, size_t len) {
+	uint64_t c = ~crc;
+	for ( ; len >= 8 ; len -= 8, p += 8)
+		c = _mm_crc32_u64(c, hash_read64(p));
+	uint32_t c32 = c;
+	while (len--)
+		c32 = _mm_crc32_u8(c32, *p++);
+	return ~c32;
+}
+#endif
+
+enum method { CRC_BYTEWISE, CRC_SW, CRC_ONE_STREAM, CRC_HW, HASH64 };
+
+static uint64_t run(enum method m, const uint8_t *data, size_t size, size_t iters) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < iters ; ++i) {
+		// Vary the start a little, so the calls can't be hoisted.
+		const uint8_t *p = data + (i & 7);
+		switch (m) {
+			case CRC_BYTEWISE: sum += crc32c_bytewise(0, p, size); break;
+			case CRC_SW: sum += crc32c_sw(0, p, size); break;
+#ifdef EHASH_CRC32C_SSE42
+			case CRC_ONE_STREAM: sum += crc32c_one_stream(0, p, size); break;
+#else
+			case CRC_ONE_STREAM: break;
+#endif
+			case CRC_HW: sum += crc32c(0, p, size); break;
+			case HASH64: sum += hash64(p, size, i); break;
+		}
+	}
+	return sum;
+}
+
+static void bench_sizes(void) {
+	BENCH_START(sizes);
+
+	uint8_t *data = malloc(bench_max_size + 8);
+	if (!data) {
+		fprintf(stderr, "failed to allocate %zu bytes\n", bench_max_size);
+		return;
+	}
+	for (size_t i = 0 ; i < bench_max_size + 8 ; ++i)
+		data[i] = i * 131;
+
+	printf("  crc32c is running at level '%s' (MB/s is millions of bytes per second)\n", cpu_level_name(cpu_level()));
+	for (size_t size = 16 ; size <= bench_max_size ; size *= 4) {
+		size_t iters = MAX(BENCH_BYTES / size, (size_t)1);
+		size_t bytes = iters * size;
+		char label[64];
+		printf("  %zu bytes\n", size);
+		// The bytewise CRC is too slow for the largest sizes to be worth waiting for.
+		if (size <= 16 * 1024 * 1024) {
+			snprintf(label, sizeof(label), "  crc32c bytewise table");
+			BENCH_RUN(label, bench_reps, bytes, BENCH_SINK(run(CRC_BYTEWISE, data, size, iters)));
+		}
+		snprintf(label, sizeof(label), "  crc32c_sw, slicing-by-8");
+		BENCH_RUN(label, bench_reps, bytes, BENCH_SINK(run(CRC_SW, data, size, iters)));
+#ifdef EHASH_CRC32C_SSE42
+		if (cpu_level() >= CPU_SSE42) {
+			snprintf(label, sizeof(label), "  crc32 instruction, one stream");
+			BENCH_RUN(label, bench_reps, bytes, BENCH_SINK(run(CRC_ONE_STREAM, data, size, iters)));
+		}
+#endif
+		snprintf(label, sizeof(label), "  crc32c");
+		BENCH_RUN(label, bench_reps, bytes, BENCH_SINK(run(CRC_HW, data, size, iters)));
+		snprintf(label, sizeof(label), "  hash64");
+		BENCH_RUN(label, bench_reps, bytes, BENCH_SINK(run(HASH64, data, size, iters)));
+	}
+
+	free(data);
+}
+
+// Combining is independent of the data, and its cost grows with the number of bits in the length.
+static uint64_t run_combine(int hw, size_t n) {
+	uint64_t sum = 0;
+	uint32_t crc = 0x12345678;
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t len = (i * 0x9E3779B97F4A7C15ULL) >> 28;	// Up to 2^36 bytes.
+#ifdef EHASH_CRC32C_SSE42
+		if (hw)
+			crc = crc32c_shift_bytes_sse42(crc, len) ^ (uint32_t)i;
+		else
+#endif
+			crc = crc32c_shift_bytes_sw(crc, len) ^ (uint32_t)i;
+		sum += crc;
+	}
+	return sum;
+}
+
+static void bench_combine(void) {
+	BENCH_START(combine);
+
+	size_t n = 200000;
+	printf("  %zu crc32c_combine of lengths up to 2^36 (MB/s is millions of combines per second)\n", n);
+	BENCH_RUN("  square-and-multiply", bench_reps, n, BENCH_SINK(run_combine(0, n)));
+#ifdef EHASH_CRC32C_SSE42
+	if (cpu_level() >= CPU_SSE42)
+		BENCH_RUN("  pclmul and crc32", bench_reps, n, BENCH_SINK(run_combine(1, n)));
+#endif
+}
+
+static const struct bench {
+	const char *name;
+	void (*fn)(void);
+} benchmarks[] = {
+	{ "sizes", bench_sizes },
+	{ "combine", bench_combine },
+};
+
+// Usage: bench_hash [max size in bytes [benchmark name ...]]
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		bench_max_size = strtoull(argv[1], NULL, 0);
+
+	printf("Benchmarking with up to %zu bytes, best of %d\n", bench_max_size, bench_reps);
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(benchmarks) ; ++i) {
+		int run_it = argc <= 2;
+		for (int j = 2 ; j < argc ; ++j) {
+			run_it |= strcmp(argv[j], benchmarks[i].name) == 0;
+		}
+		if (run_it)
+			benchmarks[i].fn();
+	}
+
+	return EXIT_SUCCESS;
+}
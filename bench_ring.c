@@ -0,0 +1,135 @@
+/*
+	Ring Buffer Benchmarks
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "ering.h"
+#include "earrays.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+#include "internal/bench.h"
+
+static size_t stream_mb = 256;
+static int bench_reps = 3;
+
+/*
+	A stream parser that needs a contiguous window of WINDOW bytes to look at, receiving
+	and consuming CHUNK bytes per step. The linear buffer variants keep the window at the
+	start of the buffer by shifting the remaining data down on every step.
+*/
+#define BUF_SIZE (1024 * 1024)
+#define WINDOW (64 * 1024)
+#define CHUNK 4096
+
+enum linear_method { LINEAR_ROTATE, LINEAR_ROTATE_MEM, LINEAR_MEMMOVE };
+
+// Stand-in for parsing: look at both ends of the window.
+static uint64_t process(const uint8_t *window, size_t len) {
+	return window[0] + window[len - 1];
+}
+
+static uint64_t stream_linear(const uint8_t *chunk, size_t total, enum linear_method method) {
+	static uint8_t buf[BUF_SIZE];
+	size_t fill = 0;
+	uint64_t sum = 0;
+	for (size_t produced = 0 ; produced < total ; produced += CHUNK) {
+		memcpy(buf + fill, chunk, CHUNK);
+		fill += CHUNK;
+		if (fill < WINDOW)
+			continue;
+		sum += process(buf, WINDOW);
+		switch (method) {
+			case LINEAR_ROTATE:
+				rotate_array(buf, BUF_SIZE, CHUNK);
+				break;
+			case LINEAR_ROTATE_MEM:
+				rotate_array_mem(buf, BUF_SIZE, 1, CHUNK);
+				break;
+			case LINEAR_MEMMOVE:
+				memmove(buf, buf + CHUNK, fill - CHUNK);
+				break;
+		}
+		fill -= CHUNK;
+	}
+	return sum;
+}
+
+static uint64_t stream_ring(struct ring *r, const uint8_t *chunk, size_t total) {
+	uint64_t sum = 0;
+	for (size_t produced = 0 ; produced < total ; produced += CHUNK) {
+		size_t avail;
+		uint8_t *w = ring_write_begin(r, &avail);
+		memcpy(w, chunk, CHUNK);
+		ring_write_commit(r, CHUNK);
+		const uint8_t *window = ring_read_begin(r, &avail);
+		if (avail < WINDOW)
+			continue;
+		sum += process(window, WINDOW);
+		ring_read_commit(r, CHUNK);
+	}
+	return sum;
+}
+
+static void bench_window(void) {
+	BENCH_START(window);
+
+	uint8_t chunk[CHUNK];
+	for (size_t i = 0 ; i < sizeof(chunk) ; ++i)
+		chunk[i] = i * 7;
+
+	size_t total = stream_mb * 1024 * 1024;
+	printf("  %zu MiB in %d byte chunks through a %d byte window\n", stream_mb, CHUNK, WINDOW);
+
+	// Rotating the whole buffer is what we're replacing, but it's very slow, so run it on less data.
+	size_t slow_total = total / 256;
+	BENCH_RUN("rotate_array (1/256th of the data)", bench_reps, slow_total, BENCH_SINK(stream_linear(chunk, slow_total, LINEAR_ROTATE)));
+	BENCH_RUN("rotate_array_mem", bench_reps, total, BENCH_SINK(stream_linear(chunk, total, LINEAR_ROTATE_MEM)));
+	BENCH_RUN("memmove", bench_reps, total, BENCH_SINK(stream_linear(chunk, total, LINEAR_MEMMOVE)));
+
+	struct ring r;
+	if (ring_init(&r, 2 * WINDOW, 0) == 0) {
+		printf("  ring capacity %zu, %s\n", r.cap, r.mirrored ? "mirrored" : "fallback");
+		BENCH_RUN("ring (mirrored)", bench_reps, total, BENCH_SINK(stream_ring(&r, chunk, total)));
+		ring_free(&r);
+	}
+	if (ring_init(&r, 2 * WINDOW, RING_NO_MIRROR) == 0) {
+		BENCH_RUN("ring (copying fallback)", bench_reps, total, BENCH_SINK(stream_ring(&r, chunk, total)));
+		ring_free(&r);
+	}
+}
+
+static const struct bench {
+	const char *name;
+	void (*fn)(void);
+} benchmarks[] = {
+	{ "window", bench_window },
+};
+
+// Usage: bench_ring [MiB to stream [benchmark name ...]]
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		stream_mb = strtoull(argv[1], NULL, 0);
+
+	printf("Benchmarking, best of %d\n", bench_reps);
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(benchmarks) ; ++i) {
+		int run = argc <= 2;
+		for (int j = 2 ; j < argc ; ++j) {
+			run |= strcmp(argv[j], benchmarks[i].name) == 0;
+		}
+		if (run)
+			benchmarks[i].fn();
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,726 @@
+/*
+	String and String Buffer Utility Functions Benchmarks
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "estrings.h"
+#include "earrays.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+#include "internal/bench.h"
+
+static size_t bench_size = 32 << 20;
+static int bench_reps = 3;
+
+static uint8_t *make_random_bytes(size_t len, uint32_t seed) {
+	uint8_t *data = malloc(len);
+	if (!data)
+		return NULL;
+	uint32_t x = seed;
+	for (size_t i = 0 ; i < len ; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		data[i] = x;
+	}
+	return data;
+}
+
+// The original fprintf-per-byte implementation, for reference.
+static void fprint_hex_fprintf(FILE *f, const uint8_t *data, size_t len, int width, const char *indent, int show_offset) {
+	for (size_t i = 0 ; i < len ; ++i) {
+		if (show_offset && (i % width == 0)) fprintf(f, "%08zx: ", i);
+		fprintf(f, "%02x", data[i]);
+		if (i < len -1) {
+			if (indent && *indent && ((i+1) % width == 0)) {
+				fprintf(f, "%s", indent);
+			} else {
+				fprintf(f, " ");
+			}
+		}
+	}
+}
+
+static void bench_hex(void) {
+	BENCH_START(hex);
+
+	uint8_t *data = make_random_bytes(bench_size, 0x12345678);
+	char *out = malloc(2 * bench_size);
+	FILE *devnull = fopen("/dev/null", "wb");
+	if (!data || !out || !devnull) {
+		fprintf(stderr, "allocation failed\n");
+		goto out;
+	}
+
+	BENCH_RUN("hex_encode", bench_reps, bench_size, BENCH_SINK(hex_encode(data, bench_size, out)));
+	int err;
+	BENCH_RUN("hex_decode", bench_reps, bench_size, BENCH_SINK(hex_decode(out, 2 * bench_size, data, &err)));
+
+	const int widths[] = { 16, 32, 64 };
+	for (size_t i = 0 ; i < ARRAY_SIZE(widths) ; ++i) {
+		char label[64];
+		snprintf(label, sizeof(label), "fprint_hex (fprintf), width %d", widths[i]);
+		BENCH_RUN(label, bench_reps, bench_size, fprint_hex_fprintf(devnull, data, bench_size, widths[i], "\n", 1));
+		snprintf(label, sizeof(label), "fprint_hex, width %d", widths[i]);
+		BENCH_RUN(label, bench_reps, bench_size, fprint_hex(devnull, data, bench_size, widths[i], "\n", HEX_OFFSET));
+		snprintf(label, sizeof(label), "fprint_hex +ascii, width %d", widths[i]);
+		BENCH_RUN(label, bench_reps, bench_size, fprint_hex(devnull, data, bench_size, widths[i], "\n", HEX_OFFSET | HEX_ASCII));
+	}
+
+out:
+	if (devnull)
+		fclose(devnull);
+	free(out);
+	free(data);
+}
+
+// The original byte-at-a-time implementation, for reference.
+static uint8_t nibble_ref(const char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return 10 + c - 'a';
+	} else if (c >= 'A' && c <= 'F') {
+		return 10 + c - 'A';
+	}
+	return 0;
+}
+
+static size_t expand_escapes_bytewise(const char *input, size_t slen, char *dest, size_t dlen, int *err) {
+	size_t rp = 0;
+	size_t wp = 0;
+
+#define RETURN_ERR(err_enum) { if (err) *err = err_enum; return rp_start; } while (0)
+	assert(err != NULL);
+
+	while (rp < slen && (wp < dlen || dest == NULL)) {
+		// Use start of scan as return value on error.
+		size_t rp_start = rp;
+		char c = input[rp++];
+		if (c == '\\') {
+			// Check if dangling escape
+			if (rp >= slen)
+				RETURN_ERR(ESC_ERROR);
+
+			if (input[rp] == 'x') {
+				// HEX escape
+				if (rp + 2 < slen && isxdigit(input[rp+1]) && isxdigit(input[rp+2])) {
+					c = (nibble_ref(input[rp+1]) << 4) | nibble_ref(input[rp+2]);
+					rp += 3;
+				} else {
+					RETURN_ERR(ESC_ERROR_HEX);
+				}
+			} else if (isdigit(input[rp])) {
+				// DECimal escape
+				int decval = input[rp++] - '0';
+				if (rp < slen && isdigit(input[rp])) {
+					decval *= 10;
+					decval += input[rp++] - '0';
+				}
+				if (rp < slen && isdigit(input[rp])) {
+					decval *= 10;
+					decval += input[rp++] - '0';
+				}
+				if (decval > 255) {
+					RETURN_ERR(ESC_ERROR_DEC);
+				}
+				c = decval;
+			} else {
+				// Standard escape character
+				// We don't support \? because that is a trigraphs legacy.
+				switch (input[rp++]) {
+					case 'a': c = '\a'; break;
+					case 'b': c = '\b'; break;
+					case 'f': c = '\f'; break;
+					case 'n': c = '\n'; break;
+					case 'r': c = '\r'; break;
+					case 't': c = '\t'; break;
+					case 'v': c = '\v'; break;
+					case '"': c = '"';  break;
+					case '\\': c = '\\';break;
+					default:
+						RETURN_ERR(ESC_ERROR_CHAR);
+				}
+			}
+		}
+
+		if (dest && dlen) {
+			if (wp < dlen) {
+				dest[wp] = c;
+			}
+		}
+		++wp;
+	}
+	if (err)
+		*err = 0;
+	return wp;
+#undef RETURN_ERR
+}
+
+// Generate text where roughly 'density' percent of the output bytes come from escapes.
+static char *make_escaped_text(size_t len, int density, size_t *out_len, uint32_t seed) {
+	static const char *escapes[] = { "\\n", "\\t", "\\\\", "\\\"", "\\x7f", "\\0", "\\255" };
+	char *text = malloc(len + 8);
+	if (!text)
+		return NULL;
+	uint32_t x = seed;
+	size_t wp = 0;
+	while (wp < len) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		if ((int)(x % 100) < density) {
+			const char *e = escapes[(x >> 8) % ARRAY_SIZE(escapes)];
+			size_t n = strlen(e);
+			memcpy(text + wp, e, n);
+			wp += n;
+		} else {
+			text[wp++] = 'a' + (x >> 8) % 26;
+		}
+	}
+	*out_len = wp;
+	return text;
+}
+
+static void bench_expand_escapes(void) {
+	BENCH_START(expand_escapes);
+
+	const int densities[] = { 0, 1, 5, 10, 25, 50 };
+	for (size_t i = 0 ; i < ARRAY_SIZE(densities) ; ++i) {
+		size_t len = 0;
+		char *text = make_escaped_text(bench_size, densities[i], &len, 0xC0FFEE);
+		char *out = malloc(len);
+		char *ref = malloc(len);
+		if (!text || !out || !ref) {
+			fprintf(stderr, "allocation failed\n");
+			free(text);
+			free(out);
+			free(ref);
+			return;
+		}
+
+		int err;
+		size_t ref_len = expand_escapes_bytewise(text, len, ref, len, &err);
+		size_t res = expand_escapes(text, len, out, len, &err);
+		if (res != ref_len || memcmp(out, ref, res) != 0) {
+			fprintf(stderr, "expand_escapes output differs from reference at density %d%%!\n", densities[i]);
+		}
+
+		char label[64];
+		snprintf(label, sizeof(label), "bytewise, %d%% escapes", densities[i]);
+		BENCH_RUN(label, bench_reps, len, BENCH_SINK(expand_escapes_bytewise(text, len, out, len, &err)));
+		snprintf(label, sizeof(label), "expand_escapes, %d%% escapes", densities[i]);
+		BENCH_RUN(label, bench_reps, len, BENCH_SINK(expand_escapes(text, len, out, len, &err)));
+		snprintf(label, sizeof(label), "bytewise sizing, %d%% escapes", densities[i]);
+		BENCH_RUN(label, bench_reps, len, BENCH_SINK(expand_escapes_bytewise(text, len, NULL, 0, &err)));
+		snprintf(label, sizeof(label), "expand_escapes sizing, %d%% escapes", densities[i]);
+		BENCH_RUN(label, bench_reps, len, BENCH_SINK(expand_escapes(text, len, NULL, 0, &err)));
+
+		free(ref);
+		free(out);
+		free(text);
+	}
+}
+
+// A typical hand-rolled escaper, for reference.
+static size_t escape_string_bytewise(const char *input, size_t slen, char *dest) {
+	size_t wp = 0;
+	for (size_t i = 0 ; i < slen ; ++i) {
+		unsigned char c = input[i];
+		switch (c) {
+			case '\n': dest[wp++] = '\\'; dest[wp++] = 'n'; break;
+			case '\t': dest[wp++] = '\\'; dest[wp++] = 't'; break;
+			case '\r': dest[wp++] = '\\'; dest[wp++] = 'r'; break;
+			case '"': dest[wp++] = '\\'; dest[wp++] = '"'; break;
+			case '\\': dest[wp++] = '\\'; dest[wp++] = '\\'; break;
+			default:
+				if (c < 0x20 || c > 0x7e) {
+					wp += sprintf(dest + wp, "\\x%02x", c);
+				} else {
+					dest[wp++] = c;
+				}
+		}
+	}
+	return wp;
+}
+
+static void bench_escape_string(void) {
+	BENCH_START(escape_string);
+
+	char *input = (char*)make_random_bytes(bench_size, 0xFEEDF00D);
+	char *out = malloc(4 * bench_size + 1);
+	if (!input || !out) {
+		fprintf(stderr, "allocation failed\n");
+		free(input);
+		free(out);
+		return;
+	}
+	const uint8_t *rnd = (const uint8_t*)input;
+
+	const int binary_pcts[] = { 0, 1, 10, 50, 100 };
+	for (size_t i = 0 ; i < ARRAY_SIZE(binary_pcts) ; ++i) {
+		// Map the random bytes to printable text, leaving binary_pct percent as-is.
+		uint8_t *text = malloc(bench_size);
+		if (!text)
+			break;
+		for (size_t j = 0 ; j < bench_size ; ++j) {
+			text[j] = (rnd[j] % 100) < binary_pcts[i] ? rnd[j ^ 1] : ' ' + rnd[j] % 95;
+		}
+
+		char label[64];
+		snprintf(label, sizeof(label), "bytewise, %d%% binary", binary_pcts[i]);
+		BENCH_RUN(label, bench_reps, bench_size, BENCH_SINK(escape_string_bytewise((const char*)text, bench_size, out)));
+		snprintf(label, sizeof(label), "escape_string, %d%% binary", binary_pcts[i]);
+		BENCH_RUN(label, bench_reps, bench_size, BENCH_SINK(escape_string((const char*)text, bench_size, out, 4 * bench_size)));
+		snprintf(label, sizeof(label), "escape_string sizing, %d%% binary", binary_pcts[i]);
+		BENCH_RUN(label, bench_reps, bench_size, BENCH_SINK(escape_string((const char*)text, bench_size, NULL, 0)));
+		free(text);
+	}
+
+	free(out);
+	free(input);
+}
+
+#define RECORD_FIELDS 10000
+
+static size_t build_record_buf_printf(char *buf, size_t bufsize, const uint64_t *values) {
+	size_t wp = 0;
+	for (size_t i = 0 ; i < RECORD_FIELDS ; ++i) {
+		buf_printf(buf, bufsize, &wp, NULL, "f%zu=%" PRIu64 ",%" PRId64 ",%" PRIx64 ";", i, values[i], -(int64_t)values[i], values[i]);
+	}
+	return wp;
+}
+
+static size_t build_record_strbuf(struct strbuf *sb, const uint64_t *values) {
+	strbuf_reset(sb);
+	for (size_t i = 0 ; i < RECORD_FIELDS ; ++i) {
+		strbuf_append_char(sb, 'f');
+		strbuf_append_u64(sb, i);
+		strbuf_append_char(sb, '=');
+		strbuf_append_u64(sb, values[i]);
+		strbuf_append_char(sb, ',');
+		strbuf_append_i64(sb, -(int64_t)values[i]);
+		strbuf_append_char(sb, ',');
+		strbuf_append_hex(sb, values[i]);
+		strbuf_append_char(sb, ';');
+	}
+	return sb->len;
+}
+
+static size_t build_record_strbuf_printf(struct strbuf *sb, const uint64_t *values) {
+	strbuf_reset(sb);
+	for (size_t i = 0 ; i < RECORD_FIELDS ; ++i) {
+		strbuf_printf(sb, "f%zu=%" PRIu64 ",%" PRId64 ",%" PRIx64 ";", i, values[i], -(int64_t)values[i], values[i]);
+	}
+	return sb->len;
+}
+
+static void bench_strbuf(void) {
+	BENCH_START(strbuf);
+
+	uint64_t *values = (uint64_t*)make_random_bytes(RECORD_FIELDS * sizeof(uint64_t), 0xABCDEF);
+	size_t bufsize = RECORD_FIELDS * 64;
+	char *buf = malloc(bufsize);
+	if (!values || !buf) {
+		fprintf(stderr, "allocation failed\n");
+		free(values);
+		free(buf);
+		return;
+	}
+	for (size_t i = 0 ; i < RECORD_FIELDS ; ++i) {
+		values[i] >>= (i % 64); // mix of short and long numbers
+	}
+
+	struct strbuf sb;
+	strbuf_init(&sb);
+	size_t len = build_record_buf_printf(buf, bufsize, values);
+	if (build_record_strbuf(&sb, values) != len || memcmp(sb.buf, buf, len) != 0) {
+		fprintf(stderr, "strbuf record differs from buf_printf record!\n");
+	}
+
+	const int reps = bench_reps * 10;
+	BENCH_RUN("buf_printf chain, 10k fields", reps, len, BENCH_SINK(build_record_buf_printf(buf, bufsize, values)));
+	BENCH_RUN("strbuf typed appends, 10k fields", reps, len, BENCH_SINK(build_record_strbuf(&sb, values)));
+	BENCH_RUN("strbuf_printf, 10k fields", reps, len, BENCH_SINK(build_record_strbuf_printf(&sb, values)));
+	strbuf_free(&sb);
+
+	// Include the cost of growing from empty.
+	BENCH_RUN("strbuf typed appends, from empty", reps, len, do {
+		strbuf_init(&sb);
+		BENCH_SINK(build_record_strbuf(&sb, values));
+		strbuf_free(&sb);
+	} while (0));
+
+	free(buf);
+	free(values);
+}
+
+// The record counts and lengths are summed, so every method must find every record.
+struct record_sum {
+	size_t num;
+	size_t len;
+};
+
+static struct record_sum split_strchr(const char *data) {
+	struct record_sum sum = { 0, 0 };
+	const char *p = data;
+	while (*p) {
+		const char *nl = strchr(p, '\n');
+		size_t len = nl ? (size_t)(nl - p) : strlen(p);
+		sum.num++;
+		sum.len += len;
+		if (!nl)
+			break;
+		p = nl + 1;
+	}
+	return sum;
+}
+
+static struct record_sum split_memchr(const char *data, size_t len) {
+	struct record_sum sum = { 0, 0 };
+	size_t pos = 0;
+	while (pos < len) {
+		const char *nl = memchr(data + pos, '\n', len - pos);
+		size_t end = nl ? (size_t)(nl - data) : len;
+		sum.num++;
+		sum.len += end - pos;
+		pos = end + 1;
+	}
+	return sum;
+}
+
+static struct record_sum split_record_iter(const char *data, size_t len) {
+	struct record_sum sum = { 0, 0 };
+	struct record_iter it;
+	struct record rec;
+	record_iter_init(&it, data, len, '\n', 0);
+	while (record_next(&it, &rec)) {
+		sum.num++;
+		sum.len += rec.len;
+	}
+	return sum;
+}
+
+static struct record_sum split_record_stream(int fd) {
+	struct record_sum sum = { 0, 0 };
+	struct record_stream rs;
+	struct record rec;
+	lseek(fd, 0, SEEK_SET);
+	record_stream_init(&rs, fd, 1 << 16, '\n', 0);
+	while (record_stream_next(&rs, &rec)) {
+		sum.num++;
+		sum.len += rec.len;
+	}
+	record_stream_free(&rs);
+	return sum;
+}
+
+static void bench_records(void) {
+	BENCH_START(records);
+
+	char *data = (char*)make_random_bytes(bench_size + 1, 0x10C5);
+	if (!data) {
+		fprintf(stderr, "allocation failed\n");
+		return;
+	}
+
+	const struct {
+		const char *label;
+		size_t min_len, max_len;
+	} profiles[] = {
+		{ "short lines", 0, 32 },
+		{ "log lines", 40, 200 },
+	};
+
+	for (size_t p = 0 ; p < ARRAY_SIZE(profiles) ; ++p) {
+		size_t range = profiles[p].max_len - profiles[p].min_len + 1;
+		uint32_t x = 0xF00D;
+		for (size_t pos = 0 ; pos < bench_size ; ) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			size_t len = profiles[p].min_len + x % range;
+			for (size_t i = 0 ; i < len && pos < bench_size ; ++i, ++pos) {
+				data[pos] = 'a' + (uint8_t)data[pos] % 26;
+			}
+			if (pos < bench_size)
+				data[pos++] = '\n';
+		}
+		data[bench_size] = 0;
+
+		FILE *f = tmpfile();
+		if (!f || fwrite(data, 1, bench_size, f) != bench_size || fflush(f) != 0) {
+			fprintf(stderr, "failed to create test file\n");
+			if (f)
+				fclose(f);
+			break;
+		}
+
+		struct record_sum ref = split_memchr(data, bench_size);
+		struct record_sum a = split_strchr(data);
+		struct record_sum b = split_record_iter(data, bench_size);
+		struct record_sum c = split_record_stream(fileno(f));
+		if (a.num != ref.num || a.len != ref.len || b.num != ref.num || b.len != ref.len || c.num != ref.num || c.len != ref.len) {
+			fprintf(stderr, "record split mismatch!\n");
+		}
+		printf("  %s, %zu records\n", profiles[p].label, ref.num);
+
+		BENCH_RUN("strchr loop", bench_reps, bench_size, BENCH_SINK(split_strchr(data)));
+		BENCH_RUN("memchr loop", bench_reps, bench_size, BENCH_SINK(split_memchr(data, bench_size)));
+		BENCH_RUN("record_next", bench_reps, bench_size, BENCH_SINK(split_record_iter(data, bench_size)));
+		BENCH_RUN("record_stream_next, 64KiB buffers", bench_reps, bench_size, BENCH_SINK(split_record_stream(fileno(f))));
+		fclose(f);
+	}
+
+	free(data);
+}
+
+static uint64_t sum_bytes(const char *data, size_t len) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < len ; ++i) {
+		sum += (uint8_t)data[i];
+	}
+	return sum;
+}
+
+enum load_method { LOAD_READ, LOAD_READ_SEQUENTIAL, LOAD_MAP, LOAD_MAP_POPULATE };
+
+// Load the file in a child process, so that peak RSS is measured for the method alone.
+static void bench_load_child(const char *label, const char *filename, enum load_method method) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return;
+	}
+	if (pid > 0) {
+		waitpid(pid, NULL, 0);
+		return;
+	}
+
+	struct file_map fm;
+	size_t len = 0;
+	const char *data = NULL;
+	double t0 = bench_now();
+	switch (method) {
+		case LOAD_READ:
+			data = read_entire_file(filename, &len);
+			break;
+		case LOAD_READ_SEQUENTIAL: {
+			int err;
+			data = read_entire_file_ex(filename, &len, READFILE_SEQUENTIAL, &err);
+			break;
+		}
+		case LOAD_MAP: {
+			int err;
+			data = map_entire_file(filename, &fm, FILEMAP_SEQUENTIAL, &err);
+			len = fm.len;
+			break;
+		}
+		case LOAD_MAP_POPULATE: {
+			int err;
+			data = map_entire_file(filename, &fm, FILEMAP_SEQUENTIAL | FILEMAP_POPULATE, &err);
+			len = fm.len;
+			break;
+		}
+	}
+	if (!data)
+		_exit(1);
+	BENCH_SINK(data[0]);
+	double t_first = bench_now() - t0;
+	BENCH_SINK(sum_bytes(data, len));
+	double t_all = bench_now() - t0;
+
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	printf("  %-40s first byte %8.3f ms, all bytes %8.3f ms, peak RSS %8ld KiB\n", label, t_first * 1e3, t_all * 1e3, ru.ru_maxrss);
+	fflush(stdout);
+	_exit(0);
+}
+
+static void bench_load_file(void) {
+	BENCH_START(load_file);
+
+	char filename[] = "/tmp/eutils_bench_XXXXXX";
+	int fd = mkstemp(filename);
+	uint8_t *data = make_random_bytes(bench_size, 0x5EED);
+	if (fd < 0 || !data || write(fd, data, bench_size) != (ssize_t)bench_size) {
+		fprintf(stderr, "failed to create test file\n");
+		if (fd >= 0) {
+			close(fd);
+			unlink(filename);
+		}
+		free(data);
+		return;
+	}
+	close(fd);
+	free(data);
+
+	// The file is in the page cache, so this measures the cost of copying versus mapping.
+	for (int r = 0 ; r < 2 ; ++r) {
+		bench_load_child("read_entire_file", filename, LOAD_READ);
+		bench_load_child("read_entire_file_ex, sequential", filename, LOAD_READ_SEQUENTIAL);
+		bench_load_child("map_entire_file", filename, LOAD_MAP);
+		bench_load_child("map_entire_file, populate", filename, LOAD_MAP_POPULATE);
+	}
+
+	unlink(filename);
+}
+
+GEN_SORT(sort_symbols_strcmp, const char *, SORT_ARRAY_CMP_CSTR_ASC)
+GEN_SORT(sort_symbols_interned, const char *, SORT_ARRAY_CMP_INTERNED_ASC)
+GEN_SORT(sort_symbols_address, const char *, SORT_ARRAY_CMP_GT)
+
+static uint64_t intern_all(struct strintern *si, const struct strview *tokens, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < n ; ++i)
+		sum += (uintptr_t)strintern(si, tokens[i]);
+	return sum;
+}
+
+static uint64_t find_all(struct strintern *si, const struct strview *tokens, size_t n) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < n ; ++i)
+		sum += (uintptr_t)strintern_find(si, tokens[i]);
+	return sum;
+}
+
+static void bench_intern(void) {
+	BENCH_START(intern);
+
+	// A stream of symbols like 'ns12::name_345', skewed towards the first ones like real identifiers.
+	const size_t nsyms = MAX(bench_size / 64, (size_t)1024);
+	const size_t ntokens = 8 * nsyms;
+	char *text = malloc(nsyms * 40);
+	struct strview *syms = malloc(nsyms * sizeof(*syms));
+	struct strview *tokens = malloc(ntokens * sizeof(*tokens));
+	struct strview *misses = malloc(nsyms * sizeof(*misses));
+	const char **interned = malloc(ntokens * sizeof(*interned));
+	size_t wp = 0;
+	for (size_t i = 0 ; i < nsyms ; ++i) {
+		int len = sprintf(text + wp, "ns%zu::%.*sname_%zu", i % 97, (int)(i % 13), "detail_inner_", i);
+		syms[i] = (struct strview){ text + wp, len };
+		wp += len + 1;
+	}
+	uint64_t x = 0x5EED;
+	for (size_t i = 0 ; i < ntokens ; ++i) {
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+		double u = (double)(x >> 11) / (double)(1ULL << 53);
+		tokens[i] = syms[(size_t)(u * u * u * (double)nsyms)];
+	}
+	size_t distinct_bytes = 0;
+	for (size_t i = 0 ; i < nsyms ; ++i) {
+		// Same lengths, but never interned.
+		misses[i] = syms[i];
+		distinct_bytes += syms[i].len;
+	}
+	char *miss_text = malloc(wp);
+	memcpy(miss_text, text, wp);
+	for (size_t i = 0 ; i < nsyms ; ++i) {
+		misses[i].ptr = miss_text + (syms[i].ptr - text);
+		miss_text[misses[i].ptr - miss_text] = 'N';
+	}
+
+	printf("  %zu tokens from %zu symbols of average length %.1f (MB/s is million lookups per second)\n",
+		ntokens, nsyms, (double)distinct_bytes / (double)nsyms);
+
+	struct strintern si;
+	strintern_init(&si, 0);
+	// The first run inserts, the others only find.
+	BENCH_RUN("strintern", bench_reps, ntokens, BENCH_SINK(intern_all(&si, tokens, ntokens)));
+	BENCH_RUN("strintern_find, hits", bench_reps, ntokens, BENCH_SINK(find_all(&si, tokens, ntokens)));
+	BENCH_RUN("strintern_find, misses", bench_reps, nsyms, BENCH_SINK(find_all(&si, misses, nsyms)));
+
+	// The bytes in use. The free tail of the last chunk is mostly untouched, so not resident.
+	size_t arena_bytes = 0;
+	for (const struct arena_chunk *c = si.arena.head ; c ; c = c->next) {
+		if (c == si.arena.cur) {
+			arena_bytes += sizeof(*c) + (si.arena.ptr - (const char*)(c + 1));
+			break;
+		}
+		arena_bytes += sizeof(*c) + c->size;
+	}
+	size_t heap_bytes = 0;
+	size_t ndups = 0;
+	char **dups = malloc(si.count * sizeof(*dups));
+	for (size_t i = 0 ; i < nsyms ; ++i) {
+		if (!strintern_find(&si, syms[i]))
+			continue;
+		dups[ndups] = strndup(syms[i].ptr, syms[i].len);
+		// Plus the malloc chunk header, and a pointer to find it by.
+		heap_bytes += malloc_usable_size(dups[ndups++]) + sizeof(size_t) + sizeof(char*);
+	}
+	printf("  %zu distinct, memory per string: strintern %.1f bytes, strdup %.1f bytes without any index\n",
+		si.count, (double)arena_bytes / (double)si.count, (double)heap_bytes / (double)si.count);
+	for (size_t i = 0 ; i < ndups ; ++i)
+		free(dups[i]);
+	free(dups);
+
+	for (size_t i = 0 ; i < ntokens ; ++i)
+		interned[i] = strintern(&si, tokens[i]);
+	const char **work = malloc(ntokens * sizeof(*work));
+	BENCH_RUN("sort, SORT_ARRAY_CMP_CSTR_ASC", bench_reps, ntokens,
+		memcpy(work, interned, ntokens * sizeof(*work)); sort_symbols_strcmp(work, ntokens));
+	BENCH_RUN("sort, SORT_ARRAY_CMP_INTERNED_ASC", bench_reps, ntokens,
+		memcpy(work, interned, ntokens * sizeof(*work)); sort_symbols_interned(work, ntokens));
+	// Enough to group equal strings, e.g to count or deduplicate them.
+	BENCH_RUN("sort by address", bench_reps, ntokens,
+		memcpy(work, interned, ntokens * sizeof(*work)); sort_symbols_address(work, ntokens));
+
+	strintern_free(&si);
+	free(work);
+	free(interned);
+	free(miss_text);
+	free(misses);
+	free(tokens);
+	free(syms);
+	free(text);
+}
+
+static const struct bench {
+	const char *name;
+	void (*fn)(void);
+} benchmarks[] = {
+	{ "hex", bench_hex },
+	{ "expand_escapes", bench_expand_escapes },
+	{ "escape_string", bench_escape_string },
+	{ "strbuf", bench_strbuf },
+	{ "records", bench_records },
+	{ "load_file", bench_load_file },
+	{ "intern", bench_intern },
+};
+
+// Usage: bench_strings [input size [benchmark name ...]]
+int main(int argc, char *argv[]) {
+	if (argc > 1)
+		bench_size = strtoull(argv[1], NULL, 0);
+
+	printf("Benchmarking with %zu byte inputs, best of %d\n", bench_size, bench_reps);
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(benchmarks) ; ++i) {
+		int run = argc <= 2;
+		for (int j = 2 ; j < argc ; ++j) {
+			run |= strcmp(argv[j], benchmarks[i].name) == 0;
+		}
+		if (run)
+			benchmarks[i].fn();
+	}
+
+	return EXIT_SUCCESS;
+}
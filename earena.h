@@ -0,0 +1,309 @@
+#pragma once
+/*
+	Arena and Pool Allocators
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+
+	An arena hands out memory by bumping a pointer through large chunks, and everything
+	is released at once with arena_reset() or arena_reset_to(). Chunks are kept across
+	resets, so once warmed up a per-request arena does no further calls to malloc.
+
+	Alternatively arena_init_reserve() maps one large range of address space up front,
+	with MAP_NORESERVE where available, which the kernel backs with pages as they're
+	touched. Allocations from it never move, and fail once the range is used up.
+
+	A pool hands out objects of one size from an arena, and recycles them through a free list.
+
+	Not thread safe; use one arena per thread.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Alignment of arena_alloc(), suitable for any type.
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+// Default minimum size of the chunks of a growing arena.
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#endif
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;		// Usable bytes, following the header.
+};
+
+struct arena {
+	char *ptr;		// Next free byte in the current chunk.
+	char *end;
+	char *last;		// Start of the latest allocation, which arena_realloc() can resize in place.
+	struct arena_chunk *cur;
+	struct arena_chunk *head;
+	size_t chunk_size;	// Minimum size of the next new chunk. Doubles for each chunk, up to 64 MiB.
+	size_t reserved;	// Non-zero if the arena is one mapped range of this many bytes.
+};
+
+// A position to return to with arena_reset_to().
+struct arena_pos {
+	struct arena_chunk *chunk;
+	char *ptr;
+};
+
+/*
+	Initialize a growing arena. A chunk_size of zero means ARENA_CHUNK_SIZE.
+	Nothing is allocated until the first allocation.
+*/
+void arena_init(struct arena *a, size_t chunk_size);
+
+/*
+	Initialize an arena backed by a single mapping of size bytes.
+
+	Returns 0 on success, or -1 on error with errno set. Fails with ENOSYS where anonymous
+	mappings aren't available, e.g a strict -std=c11 build without _GNU_SOURCE.
+*/
+int arena_init_reserve(struct arena *a, size_t size);
+void arena_free(struct arena *a);
+
+// Release all allocations, keeping the memory for reuse.
+void arena_reset(struct arena *a);
+struct arena_pos arena_mark(const struct arena *a);
+// Release everything allocated since the mark was taken.
+void arena_reset_to(struct arena *a, struct arena_pos pos);
+
+void *arena_alloc_slow(struct arena *a, size_t size, size_t align);
+
+// Returns size bytes aligned to align, which must be a power of two, or NULL if out of memory.
+static inline void *arena_alloc_aligned(struct arena *a, size_t size, size_t align) {
+	uintptr_t p = ((uintptr_t)a->ptr + (align - 1)) & ~(uintptr_t)(align - 1);
+	uintptr_t end = (uintptr_t)a->end;
+	if (__builtin_expect(size != 0 && p <= end && end - p >= size, 1)) {
+		a->last = (char*)p;
+		a->ptr = (char*)p + size;
+		return (void*)p;
+	}
+	return arena_alloc_slow(a, size, align);
+}
+
+static inline void *arena_alloc(struct arena *a, size_t size) {
+	return arena_alloc_aligned(a, size, ARENA_ALIGN);
+}
+
+/*
+	Resize an allocation of old_size bytes. The latest allocation is resized in place when it fits,
+	anything else is copied to a new allocation, and the old space is only reclaimed by a reset.
+*/
+void *arena_realloc(struct arena *a, void *p, size_t old_size, size_t new_size);
+
+// Copy n bytes of s into the arena, zero-terminated.
+char *arena_strndup(struct arena *a, const char *s, size_t n);
+
+struct pool_node {
+	struct pool_node *next;
+};
+
+struct pool {
+	struct pool_node *free;
+	size_t size;
+	size_t align;
+	struct arena arena;
+};
+
+/*
+	Initialize a pool of objects of obj_size bytes. The first chunk of its arena holds
+	objs_per_chunk objects, or ARENA_CHUNK_SIZE bytes if zero, and later chunks double
+	in size as for arena_init().
+*/
+void pool_init(struct pool *p, size_t obj_size, size_t objs_per_chunk);
+void pool_free(struct pool *p);
+// Return every object to the pool at once.
+void pool_reset(struct pool *p);
+
+// Returns an uninitialized object, or NULL if out of memory.
+static inline void *pool_get(struct pool *p) {
+	struct pool_node *n = p->free;
+	if (n) {
+		p->free = n->next;
+		return n;
+	}
+	return arena_alloc_aligned(&p->arena, p->size, p->align);
+}
+
+static inline void pool_put(struct pool *p, void *obj) {
+	struct pool_node *n = obj;
+	n->next = p->free;
+	p->free = n;
+}
+
+#ifdef EUTILS_IMPLEMENTATION
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define ARENA_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+
+static inline char *arena_chunk_data(struct arena_chunk *c) {
+	return (char*)(c + 1);
+}
+
+static void arena_enter(struct arena *a, struct arena_chunk *c) {
+	a->cur = c;
+	a->ptr = arena_chunk_data(c);
+	a->end = a->ptr + c->size;
+	a->last = NULL;
+}
+
+void arena_init(struct arena *a, size_t chunk_size) {
+	memset(a, 0, sizeof(*a));
+	a->chunk_size = chunk_size ? chunk_size : ARENA_CHUNK_SIZE;
+}
+
+int arena_init_reserve(struct arena *a, size_t size) {
+	arena_init(a, 0);
+	if (size <= sizeof(struct arena_chunk)) {
+		errno = EINVAL;
+		return -1;
+	}
+#ifdef MAP_ANONYMOUS
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+	flags |= MAP_NORESERVE;
+#endif
+	void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (base == MAP_FAILED)
+		return -1;
+	struct arena_chunk *c = base;
+	c->next = NULL;
+	c->size = size - sizeof(*c);
+	a->head = c;
+	a->reserved = size;
+	arena_enter(a, c);
+	return 0;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+void arena_free(struct arena *a) {
+	if (a->reserved) {
+		munmap(a->head, a->reserved);
+	} else {
+		struct arena_chunk *c = a->head;
+		while (c) {
+			struct arena_chunk *next = c->next;
+			free(c);
+			c = next;
+		}
+	}
+	memset(a, 0, sizeof(*a));
+}
+
+void arena_reset(struct arena *a) {
+	if (a->head)
+		arena_enter(a, a->head);
+}
+
+struct arena_pos arena_mark(const struct arena *a) {
+	return (struct arena_pos){ a->cur, a->ptr };
+}
+
+void arena_reset_to(struct arena *a, struct arena_pos pos) {
+	if (!pos.chunk) {
+		arena_reset(a);
+		return;
+	}
+	arena_enter(a, pos.chunk);
+	a->ptr = pos.ptr;
+}
+
+// Move to the next chunk if the allocation fits there, else insert a new chunk after the current one.
+void *arena_alloc_slow(struct arena *a, size_t size, size_t align) {
+	// Zero bytes still gets a unique pointer.
+	if (size == 0)
+		return arena_alloc_aligned(a, 1, align);
+	if (a->reserved) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	struct arena_chunk *next = a->cur ? a->cur->next : a->head;
+	if (next && next->size >= size + align - 1) {
+		arena_enter(a, next);
+		return arena_alloc_aligned(a, size, align);
+	}
+
+	size_t need;
+	if (__builtin_add_overflow(size, align - 1, &need) || need > SIZE_MAX - sizeof(struct arena_chunk)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	size_t csize = need > a->chunk_size ? need : a->chunk_size;
+	struct arena_chunk *c = malloc(sizeof(*c) + csize);
+	if (!c)
+		return NULL;
+	c->size = csize;
+	c->next = next;
+	if (a->cur)
+		a->cur->next = c;
+	else
+		a->head = c;
+	if (a->chunk_size < ARENA_MAX_CHUNK_SIZE)
+		a->chunk_size *= 2;
+	arena_enter(a, c);
+	return arena_alloc_aligned(a, size, align);
+}
+
+void *arena_realloc(struct arena *a, void *p, size_t old_size, size_t new_size) {
+	if (!p)
+		return arena_alloc(a, new_size);
+	if (p == a->last && new_size != 0 && (size_t)(a->end - a->last) >= new_size) {
+		a->ptr = a->last + new_size;
+		return p;
+	}
+	if (new_size <= old_size)
+		return p;
+	void *q = arena_alloc(a, new_size);
+	if (q)
+		memcpy(q, p, old_size);
+	return q;
+}
+
+char *arena_strndup(struct arena *a, const char *s, size_t n) {
+	char *d = arena_alloc_aligned(a, n + 1, 1);
+	if (d) {
+		memcpy(d, s, n);
+		d[n] = 0;
+	}
+	return d;
+}
+
+void pool_init(struct pool *p, size_t obj_size, size_t objs_per_chunk) {
+	// Room for the free list link, and the natural alignment of the size, up to ARENA_ALIGN.
+	size_t size = obj_size < sizeof(struct pool_node) ? sizeof(struct pool_node) : obj_size;
+	size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+	size_t align = size & -size;
+	p->free = NULL;
+	p->size = size;
+	p->align = align < ARENA_ALIGN ? align : ARENA_ALIGN;
+	arena_init(&p->arena, objs_per_chunk ? objs_per_chunk * size + p->align : 0);
+}
+
+void pool_free(struct pool *p) {
+	arena_free(&p->arena);
+	p->free = NULL;
+}
+
+void pool_reset(struct pool *p) {
+	arena_reset(&p->arena);
+	p->free = NULL;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
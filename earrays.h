@@ -9,19 +9,56 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "emacros.h"
 
 #define reverse_array(arr, n) reverse_array_impl(arr, n, GENID(i), GENID(j))
 #define reverse_array_impl(arr, n, i, j) do { \
-	for (int i=0, j=((n)-1) ; i < j ; ++i, --j) \
-		SWAP((arr)[i], (arr)[j]); \
+	for (size_t i = 0, j = (n) ; i + 1 < j ; ++i, --j) \
+		SWAP((arr)[i], (arr)[j - 1]); \
 } while(0)
 
+// Reverse arrays of 8, 16 and 32-bit elements, swapping 32 bytes from each end at a time with AVX2.
+void reverse_array_u8(uint8_t *arr, size_t n);
+void reverse_array_u16(uint16_t *arr, size_t n);
+void reverse_array_u32(uint32_t *arr, size_t n);
+
+/*
+	Array versions of CLAMP, MIN, MAX and LERP from emacros.h. The clamps and reductions use AVX2
+	or AVX-512 and the lerps AVX2, when cpu_level() from ecpu.h says so.
+
+	clamp_*() store CLAMP(src[i], lo, hi) of n elements in dst, which may equal src. The result is
+	the same as the macro's, also for NaN and when lo > hi.
+
+	minmax_reduce_*() set *min and *max to the smallest and largest of the n elements of arr, as
+	folding MIN and MAX over it would. Does nothing if n is 0. With NaNs or zeros of different
+	signs, which float comes out depends on the evaluation order, which isn't left to right.
+
+	lerp_f32() stores LERP(v0[i], v1[i], t), i.e v0[i] + t * (v1[i] - v0[i]). The AVX2 version
+	never fuses the multiply-add, which is also what the macro does in ISO C mode.
+
+	lerp_u8() interpolates in fixed point, where t in [0, 255] means [0, 1]. The result is rounded
+	to nearest and exact at both ends, unlike LERP on integers, which truncates through float.
+*/
+void clamp_f32(float *dst, const float *src, size_t n, float lo, float hi);
+void clamp_i32(int32_t *dst, const int32_t *src, size_t n, int32_t lo, int32_t hi);
+void clamp_u8(uint8_t *dst, const uint8_t *src, size_t n, uint8_t lo, uint8_t hi);
+void minmax_reduce_f32(const float *arr, size_t n, float *min, float *max);
+void minmax_reduce_i32(const int32_t *arr, size_t n, int32_t *min, int32_t *max);
+void minmax_reduce_u8(const uint8_t *arr, size_t n, uint8_t *min, uint8_t *max);
+void lerp_f32(float *dst, const float *v0, const float *v1, size_t n, float t);
+void lerp_u8(uint8_t *dst, const uint8_t *v0, const uint8_t *v1, size_t n, uint8_t t);
+
 // Insertion sort any simple-valued array in ascending order
 #define SORT_ARRAY_CMP_GT(a,b,cmp_data) ((a) > (b))
 #define SORT_ARRAY_CMP_LT(a,b,cmp_data) ((a) < (b))
 #define SORT_ARRAY_CMP_CSTR_ASC(s1,s2,cmp_data) (strcmp((s1), (s2)) > 0)
 #define SORT_ARRAY_CMP_CSTR_DESC(s1,s2,cmp_data) (strcmp((s1), (s2)) < 0)
+// For strings from strintern() in estrings.h, where equal strings are the same pointer.
+#define SORT_ARRAY_CMP_INTERNED_ASC(s1,s2,cmp_data) ((s1) != (s2) && strcmp((s1), (s2)) > 0)
+#define SORT_ARRAY_CMP_INTERNED_DESC(s1,s2,cmp_data) ((s1) != (s2) && strcmp((s1), (s2)) < 0)
 #define SORT_ARRAY_CMP_PERM_GT(a,b,cmp_data) ((cmp_data)[a] > (cmp_data)[b])
 #define SORT_ARRAY_CMP_PERM_LT(a,b,cmp_data) ((cmp_data)[a] < (cmp_data)[b])
 
@@ -31,8 +68,8 @@ extern "C" {
 #define sort_array_simple_impl(arr, n, cmp, cmp_data, j, x) do { \
 	_Pragma("GCC diagnostic push") \
 	_Pragma("GCC diagnostic ignored \"-Wtype-limits\"") \
-	/* Attempt to signal compiler that these inputs can't alias */ \
-	assert(&arr[0] != cmp_data); \
+	/* Attempt to signal compiler that these inputs can't alias. An empty range may end up anywhere. */ \
+	assert((n) == 0 || (const void*)&(arr)[0] != (const void*)(cmp_data)); \
 	size_t j; \
 	for (size_t i = 1 ; i < (n) ; ++i) { \
 		__auto_type x = (arr)[i]; \
@@ -44,24 +81,794 @@ extern "C" {
 	_Pragma("GCC diagnostic pop") \
 } while(0)
 
+/*
+	Macros to generate O(n log n) sort functions, specialized for a type and comparator.
+
+	GEN_SORT(name, type, cmp) generates 'void name(type *arr, size_t n)'.
+	GEN_SORT_DATA(name, type, cmp, data_type) generates 'void name(type *arr, size_t n, data_type cmp_data)'.
+
+	The comparators are the same as for sort_array_cmp(), e.g SORT_ARRAY_CMP_GT for ascending order,
+	or SORT_ARRAY_CMP_PERM_GT with GEN_SORT_DATA to sort a permutation. Being macros, they are
+	inlined into the sort, unlike with qsort().
+
+	Pattern-defeating Quicksort (Orson Peters, https://arxiv.org/abs/2106.05123), i.e introsort with
+	median-of-three/ninther pivots, detection of sorted and equal-heavy partitions, and a heapsort
+	fallback bounding the worst case. Partitions smaller than SORT_INSERTION_THRESHOLD are finished
+	with sort_array_simple_impl(). Not stable.
+*/
+#ifndef SORT_INSERTION_THRESHOLD
+#define SORT_INSERTION_THRESHOLD 24
+#endif
+#define SORT_NINTHER_THRESHOLD 128
+#define SORT_BLOCK_SIZE 64
+
+#define GEN_SORT(name, type, cmp) \
+GEN_SORT_IMPL(name, type, cmp, const void *) \
+static void name(type *arr, size_t n) { \
+	name##_pdq_loop(arr, n, NULL); \
+}
+
+#define GEN_SORT_DATA(name, type, cmp, data_type) \
+GEN_SORT_IMPL(name, type, cmp, data_type) \
+static void name(type *arr, size_t n, data_type cmp_data) { \
+	name##_pdq_loop(arr, n, cmp_data); \
+}
+
+#define GEN_SORT_IMPL(name, type, cmp, data_type) \
+static inline void name##_sort2(type *a, type *b, data_type UNUSED(cmp_data)) { \
+	if (cmp(*a, *b, cmp_data)) \
+		SWAP(*a, *b); \
+} \
+\
+static inline void name##_sort3(type *a, type *b, type *c, data_type cmp_data) { \
+	name##_sort2(a, b, cmp_data); \
+	name##_sort2(b, c, cmp_data); \
+	name##_sort2(a, b, cmp_data); \
+} \
+\
+static void name##_insertion(type *arr, size_t n, data_type UNUSED(cmp_data)) { \
+	sort_array_simple_impl(arr, n, cmp, cmp_data, j, x); \
+} \
+\
+/* Insertion sort that gives up after a few moves. Returns 1 if arr was sorted. */ \
+static int name##_partial_insertion(type *arr, size_t n, data_type UNUSED(cmp_data)) { \
+	size_t moves = 0; \
+	for (size_t i = 1 ; i < n ; ++i) { \
+		if (cmp(arr[i - 1], arr[i], cmp_data)) { \
+			type x = arr[i]; \
+			size_t j = i; \
+			do { \
+				arr[j] = arr[j - 1]; \
+				--j; \
+			} while (j > 0 && cmp(arr[j - 1], x, cmp_data)); \
+			arr[j] = x; \
+			moves += i - j; \
+			if (moves > 8) \
+				return 0; \
+		} \
+	} \
+	return 1; \
+} \
+\
+static void name##_sift_down(type *arr, size_t i, size_t n, data_type UNUSED(cmp_data)) { \
+	type x = arr[i]; \
+	size_t child; \
+	while ((child = 2 * i + 1) < n) { \
+		if (child + 1 < n && cmp(arr[child + 1], arr[child], cmp_data)) \
+			++child; \
+		if (!cmp(arr[child], x, cmp_data)) \
+			break; \
+		arr[i] = arr[child]; \
+		i = child; \
+	} \
+	arr[i] = x; \
+} \
+\
+static void name##_heapsort(type *arr, size_t n, data_type cmp_data) { \
+	for (size_t i = n / 2 ; i-- > 0 ; ) \
+		name##_sift_down(arr, i, n, cmp_data); \
+	for (size_t i = n ; i-- > 1 ; ) { \
+		SWAP(arr[0], arr[i]); \
+		name##_sift_down(arr, 0, i, cmp_data); \
+	} \
+} \
+\
+/* Move the elements at the num left and right offsets to the other side. With equal counts, */ \
+/* all pairs are swapped; otherwise they're rotated through one temporary, in fewer moves. */ \
+static inline void name##_swap_offsets(type *arr, size_t first, size_t last, const unsigned char *offsets_l, const unsigned char *offsets_r, size_t num, int use_swaps) { \
+	if (use_swaps) { \
+		for (size_t i = 0 ; i < num ; ++i) \
+			SWAP(arr[first + offsets_l[i]], arr[last - offsets_r[i]]); \
+	} else if (num > 0) { \
+		size_t l = first + offsets_l[0]; \
+		size_t r = last - offsets_r[0]; \
+		type tmp = arr[l]; \
+		arr[l] = arr[r]; \
+		for (size_t i = 1 ; i < num ; ++i) { \
+			l = first + offsets_l[i]; \
+			arr[r] = arr[l]; \
+			r = last - offsets_r[i]; \
+			arr[l] = arr[r]; \
+		} \
+		arr[r] = tmp; \
+	} \
+} \
+\
+/* Partition around the pivot arr[0], with elements equal to it going right. Returns the */ \
+/* pivot's final position, and sets *sorted if no elements were out of place. */ \
+/* Uses block partitioning (Edelkamp & Weiss, BlockQuicksort): the comparison results of a block */ \
+/* are first recorded as offsets without branching, then the misplaced elements are swapped. */ \
+static size_t name##_partition_right(type *arr, size_t n, int *sorted, data_type UNUSED(cmp_data)) { \
+	type pivot = arr[0]; \
+	size_t first = 0; \
+	size_t last = n; \
+	/* The pivot selection guarantees an element not less than the pivot. The indices are */ \
+	/* stepped outside of cmp, which may evaluate its arguments more than once. */ \
+	do ++first; while (cmp(pivot, arr[first], cmp_data)); \
+	if (first == 1) { \
+		while (first < last && (--last, !cmp(pivot, arr[last], cmp_data))) \
+			; \
+	} else { \
+		do --last; while (!cmp(pivot, arr[last], cmp_data)); \
+	} \
+	*sorted = first >= last; \
+	if (!*sorted) { \
+		unsigned char offsets_l[SORT_BLOCK_SIZE]; \
+		unsigned char offsets_r[SORT_BLOCK_SIZE]; \
+		size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0; \
+		SWAP(arr[first], arr[last]); \
+		++first; \
+		/* [first, last) is unknown, except for leftovers in the blocks at either end. */ \
+		while (last - first > 2 * SORT_BLOCK_SIZE) { \
+			if (num_l == 0) { \
+				start_l = 0; \
+				for (size_t i = 0 ; i < SORT_BLOCK_SIZE ; ++i) { \
+					offsets_l[num_l] = i; \
+					num_l += !cmp(pivot, arr[first + i], cmp_data); \
+				} \
+			} \
+			if (num_r == 0) { \
+				start_r = 0; \
+				for (size_t i = 0 ; i < SORT_BLOCK_SIZE ; ) { \
+					offsets_r[num_r] = ++i; \
+					num_r += cmp(pivot, arr[last - i], cmp_data); \
+				} \
+			} \
+			size_t num = num_l < num_r ? num_l : num_r; \
+			name##_swap_offsets(arr, first, last, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r); \
+			num_l -= num; \
+			num_r -= num; \
+			start_l += num; \
+			start_r += num; \
+			if (num_l == 0) \
+				first += SORT_BLOCK_SIZE; \
+			if (num_r == 0) \
+				last -= SORT_BLOCK_SIZE; \
+		} \
+		/* Split what's left between the blocks, keeping a block with leftovers whole. */ \
+		size_t l_size, r_size; \
+		size_t unknown = (last - first) - ((num_r || num_l) ? SORT_BLOCK_SIZE : 0); \
+		if (num_r) { \
+			l_size = unknown; \
+			r_size = SORT_BLOCK_SIZE; \
+		} else if (num_l) { \
+			l_size = SORT_BLOCK_SIZE; \
+			r_size = unknown; \
+		} else { \
+			l_size = unknown / 2; \
+			r_size = unknown - l_size; \
+		} \
+		if (unknown && !num_l) { \
+			start_l = 0; \
+			for (size_t i = 0 ; i < l_size ; ++i) { \
+				offsets_l[num_l] = i; \
+				num_l += !cmp(pivot, arr[first + i], cmp_data); \
+			} \
+		} \
+		if (unknown && !num_r) { \
+			start_r = 0; \
+			for (size_t i = 0 ; i < r_size ; ) { \
+				offsets_r[num_r] = ++i; \
+				num_r += cmp(pivot, arr[last - i], cmp_data); \
+			} \
+		} \
+		size_t num = num_l < num_r ? num_l : num_r; \
+		name##_swap_offsets(arr, first, last, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r); \
+		num_l -= num; \
+		num_r -= num; \
+		start_l += num; \
+		start_r += num; \
+		if (num_l == 0) \
+			first += l_size; \
+		if (num_r == 0) \
+			last -= r_size; \
+		/* Misplaced elements left over in one block go next to the boundary. */ \
+		if (num_l) { \
+			while (num_l--) { \
+				--last; \
+				SWAP(arr[first + offsets_l[start_l + num_l]], arr[last]); \
+			} \
+			first = last; \
+		} \
+		if (num_r) { \
+			while (num_r--) { \
+				SWAP(arr[last - offsets_r[start_r + num_r]], arr[first]); \
+				++first; \
+			} \
+		} \
+	} \
+	size_t pos = first - 1; \
+	arr[0] = arr[pos]; \
+	arr[pos] = pivot; \
+	return pos; \
+} \
+\
+/* Partition around the pivot arr[0], with elements equal to it going left. Used when the pivot */ \
+/* equals an element left of the partition, so the left part is all equal and done. */ \
+static size_t name##_partition_left(type *arr, size_t n, data_type UNUSED(cmp_data)) { \
+	type pivot = arr[0]; \
+	size_t first = 0; \
+	size_t last = n; \
+	do --last; while (cmp(arr[last], pivot, cmp_data)); \
+	if (last + 1 == n) { \
+		while (first < last && (++first, !cmp(arr[first], pivot, cmp_data))) \
+			; \
+	} else { \
+		do ++first; while (!cmp(arr[first], pivot, cmp_data)); \
+	} \
+	while (first < last) { \
+		SWAP(arr[first], arr[last]); \
+		do --last; while (cmp(arr[last], pivot, cmp_data)); \
+		do ++first; while (!cmp(arr[first], pivot, cmp_data)); \
+	} \
+	arr[0] = arr[last]; \
+	arr[last] = pivot; \
+	return last; \
+} \
+\
+/* Swap a few elements around, to break up patterns that cause bad pivots. */ \
+static inline void name##_shuffle(type *arr, size_t n) { \
+	if (n >= SORT_INSERTION_THRESHOLD) { \
+		SWAP(arr[0], arr[n / 4]); \
+		SWAP(arr[n - 1], arr[n - n / 4]); \
+		if (n > SORT_NINTHER_THRESHOLD) { \
+			SWAP(arr[1], arr[n / 4 + 1]); \
+			SWAP(arr[2], arr[n / 4 + 2]); \
+			SWAP(arr[n - 2], arr[n - n / 4 - 1]); \
+			SWAP(arr[n - 3], arr[n - n / 4 - 2]); \
+		} \
+	} \
+} \
+\
+static void name##_pdq(type *arr, size_t n, int bad_allowed, int leftmost, data_type cmp_data) { \
+	while (n >= SORT_INSERTION_THRESHOLD) { \
+		size_t mid = n / 2; \
+		if (n > SORT_NINTHER_THRESHOLD) { \
+			name##_sort3(&arr[0], &arr[mid], &arr[n - 1], cmp_data); \
+			name##_sort3(&arr[1], &arr[mid - 1], &arr[n - 2], cmp_data); \
+			name##_sort3(&arr[2], &arr[mid + 1], &arr[n - 3], cmp_data); \
+			name##_sort3(&arr[mid - 1], &arr[mid], &arr[mid + 1], cmp_data); \
+			SWAP(arr[0], arr[mid]); \
+		} else { \
+			name##_sort3(&arr[mid], &arr[0], &arr[n - 1], cmp_data); \
+		} \
+\
+		/* An element to the left equal to the pivot means there are many equal elements. */ \
+		if (!leftmost && !cmp(arr[0], arr[-1], cmp_data)) { \
+			size_t pos = name##_partition_left(arr, n, cmp_data); \
+			arr += pos + 1; \
+			n -= pos + 1; \
+			continue; \
+		} \
+\
+		int sorted; \
+		size_t pos = name##_partition_right(arr, n, &sorted, cmp_data); \
+		size_t left = pos; \
+		size_t right = n - pos - 1; \
+\
+		if (left < n / 8 || right < n / 8) { \
+			if (--bad_allowed == 0) { \
+				name##_heapsort(arr, n, cmp_data); \
+				return; \
+			} \
+			name##_shuffle(arr, left); \
+			name##_shuffle(arr + pos + 1, right); \
+		} else if (sorted && name##_partial_insertion(arr, left, cmp_data) && name##_partial_insertion(arr + pos + 1, right, cmp_data)) { \
+			return; \
+		} \
+\
+		/* Recurse into the smaller side to bound the stack depth, loop on the other. */ \
+		if (left < right) { \
+			name##_pdq(arr, left, bad_allowed, leftmost, cmp_data); \
+			arr += pos + 1; \
+			n = right; \
+			leftmost = 0; \
+		} else { \
+			name##_pdq(arr + pos + 1, right, bad_allowed, 0, cmp_data); \
+			n = left; \
+		} \
+	} \
+	name##_insertion(arr, n, cmp_data); \
+} \
+\
+static void name##_pdq_loop(type *arr, size_t n, data_type cmp_data) { \
+	int bad_allowed = 1; \
+	for (size_t m = n ; m > 1 ; m >>= 1) \
+		++bad_allowed; \
+	name##_pdq(arr, n, bad_allowed, 1, cmp_data); \
+}
+
+/*
+	Macros to generate selection functions, specialized for a type and comparator like GEN_SORT.
+	Percentiles only need the elements at a few positions, which doesn't require a full sort.
+
+	GEN_SELECT(name, type, cmp) generates:
+
+	'void name_select_nth(type *arr, size_t n, size_t k)' moves the element that would be at index k
+	if arr was sorted there, with no element before it that sorts after it, and vice versa.
+	Does nothing if k >= n. Introselect: the pdqsort partitioning, only descending into the side
+	holding k, for linear expected time. Falls back to heapsort like the sort, bounding the worst case.
+
+	'void name_partial_sort(type *arr, size_t n, size_t k)' sorts the first k elements of the sorted
+	order into arr[0..k), leaving the rest in unspecified order.
+
+	'void name_topk_push(type *heap, size_t *count, size_t k, type x)' keeps the first k elements in
+	sort order of a stream in heap, which has room for k elements and starts with *count = 0.
+	The last of them is at heap[0], so a new element is rejected after a single compare.
+	'void name_topk_sort(type *heap, size_t count)' then sorts the heap, after which it's an array.
+
+	GEN_SELECT_DATA(name, type, cmp, data_type) generates the same functions with a trailing
+	'data_type cmp_data' argument, as GEN_SORT_DATA.
+
+	The selection functions reuse GEN_SORT_IMPL, so don't also use the same name with GEN_SORT.
+*/
+#define GEN_SELECT(name, type, cmp) \
+GEN_SELECT_IMPL(name, type, cmp, const void *) \
+__attribute__((unused)) static void name##_select_nth(type *arr, size_t n, size_t k) { \
+	name##_select_loop(arr, n, k, NULL); \
+} \
+\
+__attribute__((unused)) static void name##_partial_sort(type *arr, size_t n, size_t k) { \
+	name##_partial_sort_impl(arr, n, k, NULL); \
+} \
+\
+__attribute__((unused)) static void name##_topk_push(type *heap, size_t *count, size_t k, type x) { \
+	name##_topk_push_impl(heap, count, k, x, NULL); \
+} \
+\
+__attribute__((unused)) static void name##_topk_sort(type *heap, size_t count) { \
+	name##_topk_sort_impl(heap, count, NULL); \
+}
+
+#define GEN_SELECT_DATA(name, type, cmp, data_type) \
+GEN_SELECT_IMPL(name, type, cmp, data_type) \
+__attribute__((unused)) static void name##_select_nth(type *arr, size_t n, size_t k, data_type cmp_data) { \
+	name##_select_loop(arr, n, k, cmp_data); \
+} \
+\
+__attribute__((unused)) static void name##_partial_sort(type *arr, size_t n, size_t k, data_type cmp_data) { \
+	name##_partial_sort_impl(arr, n, k, cmp_data); \
+} \
+\
+__attribute__((unused)) static void name##_topk_push(type *heap, size_t *count, size_t k, type x, data_type cmp_data) { \
+	name##_topk_push_impl(heap, count, k, x, cmp_data); \
+} \
+\
+__attribute__((unused)) static void name##_topk_sort(type *heap, size_t count, data_type cmp_data) { \
+	name##_topk_sort_impl(heap, count, cmp_data); \
+}
+
+#define GEN_SELECT_IMPL(name, type, cmp, data_type) \
+GEN_SORT_IMPL(name, type, cmp, data_type) \
+\
+static void name##_select_loop(type *arr, size_t n, size_t k, data_type cmp_data) { \
+	if (k >= n) \
+		return; \
+	int bad_allowed = 1; \
+	for (size_t m = n ; m > 1 ; m >>= 1) \
+		++bad_allowed; \
+	int leftmost = 1; \
+	while (n >= SORT_INSERTION_THRESHOLD) { \
+		size_t mid = n / 2; \
+		if (n > SORT_NINTHER_THRESHOLD) { \
+			name##_sort3(&arr[0], &arr[mid], &arr[n - 1], cmp_data); \
+			name##_sort3(&arr[1], &arr[mid - 1], &arr[n - 2], cmp_data); \
+			name##_sort3(&arr[2], &arr[mid + 1], &arr[n - 3], cmp_data); \
+			name##_sort3(&arr[mid - 1], &arr[mid], &arr[mid + 1], cmp_data); \
+			SWAP(arr[0], arr[mid]); \
+		} else { \
+			name##_sort3(&arr[mid], &arr[0], &arr[n - 1], cmp_data); \
+		} \
+\
+		/* As in the sort, everything up to the returned position equals the pivot. */ \
+		if (!leftmost && !cmp(arr[0], arr[-1], cmp_data)) { \
+			size_t pos = name##_partition_left(arr, n, cmp_data); \
+			if (k <= pos) \
+				return; \
+			arr += pos + 1; \
+			n -= pos + 1; \
+			k -= pos + 1; \
+			continue; \
+		} \
+\
+		int sorted; \
+		size_t pos = name##_partition_right(arr, n, &sorted, cmp_data); \
+		if (pos == k) \
+			return; \
+\
+		size_t left = pos; \
+		size_t right = n - pos - 1; \
+		if (left < n / 8 || right < n / 8) { \
+			if (--bad_allowed == 0) { \
+				name##_heapsort(arr, n, cmp_data); \
+				return; \
+			} \
+			name##_shuffle(arr, left); \
+			name##_shuffle(arr + pos + 1, right); \
+		} \
+\
+		if (k < pos) { \
+			n = left; \
+		} else { \
+			arr += pos + 1; \
+			n = right; \
+			k -= pos + 1; \
+			leftmost = 0; \
+		} \
+	} \
+	name##_insertion(arr, n, cmp_data); \
+} \
+\
+static void name##_partial_sort_impl(type *arr, size_t n, size_t k, data_type cmp_data) { \
+	if (k >= n) { \
+		name##_pdq_loop(arr, n, cmp_data); \
+	} else if (k > 0) { \
+		name##_select_loop(arr, n, k - 1, cmp_data); \
+		name##_pdq_loop(arr, k - 1, cmp_data); \
+	} \
+} \
+\
+static void name##_topk_push_impl(type *heap, size_t *count, size_t k, type x, data_type UNUSED(cmp_data)) { \
+	size_t i = *count; \
+	if (i < k) { \
+		while (i > 0 && cmp(x, heap[(i - 1) / 2], cmp_data)) { \
+			heap[i] = heap[(i - 1) / 2]; \
+			i = (i - 1) / 2; \
+		} \
+		heap[i] = x; \
+		++*count; \
+	} else if (k > 0 && cmp(heap[0], x, cmp_data)) { \
+		heap[0] = x; \
+		name##_sift_down(heap, 0, k, cmp_data); \
+	} \
+} \
+\
+static void name##_topk_sort_impl(type *heap, size_t count, data_type cmp_data) { \
+	for (size_t i = count ; i-- > 1 ; ) { \
+		SWAP(heap[0], heap[i]); \
+		name##_sift_down(heap, 0, i, cmp_data); \
+	} \
+}
+
+/*
+	Generate 'static void name(type *arr, size_t n, int threads)', a parallel merge sort, and
+	'static void name_ex(type *arr, size_t n, int threads, size_t cutoff)'. GEN_PARALLEL_SORT_DATA
+	(name, type, cmp, data_type) adds a trailing 'data_type cmp_data' to both, as GEN_SORT_DATA.
+
+	The array is split into one chunk per thread, each sorted by a GEN_SORT instance, and the
+	sorted runs are then merged pairwise. Every merge round is split evenly across all threads
+	by binary searching for where each thread's slice of the output begins in the two runs.
+	The threads are started once per sort, and reused for the chunk sorts and every round.
+
+	Each chunk holds at least cutoff elements, or PSORT_CUTOFF if zero; smaller inputs are sorted
+	on the calling thread. threads <= 0 means one per online CPU, up to PSORT_MAX_THREADS.
+
+	Needs n extra elements of scratch space. If that can't be allocated, sorts sequentially.
+	Requires POSIX threads (link with -pthread). Not stable.
+*/
+#ifndef PSORT_CUTOFF
+#define PSORT_CUTOFF 65536
+#endif
+#define PSORT_MAX_THREADS 64
+
+// Worker threads that run one parallel job after another. Used by GEN_PARALLEL_SORT.
+struct psort_team;
+// Start threads - 1 workers, the calling thread being the last. Returns NULL if none could be started.
+struct psort_team *psort_team_start(int threads);
+// Run fn(ctx, t) for t in [0, tasks) on the team and the calling thread, and wait for them all. team may be NULL.
+void psort_team_run(struct psort_team *team, void (*fn)(void *ctx, int t), void *ctx, int tasks);
+void psort_team_stop(struct psort_team *team);
+int psort_num_threads(int threads, size_t n, size_t cutoff);
+
+#define GEN_PARALLEL_SORT(name, type, cmp) \
+GEN_PARALLEL_SORT_IMPL(name, type, cmp, const void *) \
+__attribute__((unused)) static void name##_ex(type *arr, size_t n, int threads, size_t cutoff) { \
+	name##_run(arr, n, threads, cutoff, NULL); \
+} \
+\
+__attribute__((unused)) static void name(type *arr, size_t n, int threads) { \
+	name##_run(arr, n, threads, 0, NULL); \
+}
+
+#define GEN_PARALLEL_SORT_DATA(name, type, cmp, data_type) \
+GEN_PARALLEL_SORT_IMPL(name, type, cmp, data_type) \
+__attribute__((unused)) static void name##_ex(type *arr, size_t n, int threads, size_t cutoff, data_type cmp_data) { \
+	name##_run(arr, n, threads, cutoff, cmp_data); \
+} \
+\
+__attribute__((unused)) static void name(type *arr, size_t n, int threads, data_type cmp_data) { \
+	name##_run(arr, n, threads, 0, cmp_data); \
+}
+
+#define GEN_PARALLEL_SORT_IMPL(name, type, cmp, data_type) \
+GEN_SORT_IMPL(name##_seq, type, cmp, data_type) \
+\
+struct name##_ctx { \
+	type *src; \
+	type *dst; \
+	size_t n; \
+	int threads; \
+	int runs; \
+	size_t *bnd; \
+	data_type cmp_data; \
+}; \
+\
+static void name##_sort_chunk(void *arg, int t) { \
+	struct name##_ctx *ctx = arg; \
+	name##_seq_pdq_loop(ctx->src + ctx->bnd[t], ctx->bnd[t + 1] - ctx->bnd[t], ctx->cmp_data); \
+} \
+\
+/* Number of elements taken from a in the first k of the merge of a and b. Ties go to a. */ \
+static size_t name##_corank(size_t k, const type *a, size_t la, const type *b, size_t lb, data_type UNUSED(cmp_data)) { \
+	size_t lo = k > lb ? k - lb : 0; \
+	size_t hi = k < la ? k : la; \
+	while (lo < hi) { \
+		size_t i = lo + (hi - lo) / 2; \
+		if (!cmp(a[i], b[k - i - 1], cmp_data)) \
+			lo = i + 1; \
+		else \
+			hi = i; \
+	} \
+	return lo; \
+} \
+\
+static void name##_merge_slice(void *arg, int t) { \
+	struct name##_ctx *ctx = arg; \
+	data_type UNUSED(cmp_data) = ctx->cmp_data; \
+	size_t lo = ctx->n * t / ctx->threads; \
+	size_t hi = ctx->n * (t + 1) / ctx->threads; \
+	for (int r = 0 ; r < ctx->runs ; r += 2) { \
+		size_t s = ctx->bnd[r]; \
+		size_t m = ctx->bnd[r + 1]; \
+		size_t e = r + 2 <= ctx->runs ? ctx->bnd[r + 2] : m; \
+		if (e <= lo || s >= hi) \
+			continue; \
+		const type *a = ctx->src + s; \
+		const type *b = ctx->src + m; \
+		size_t la = m - s; \
+		size_t lb = e - m; \
+		size_t k0 = (lo > s ? lo : s) - s; \
+		size_t k1 = (hi < e ? hi : e) - s; \
+		size_t i = name##_corank(k0, a, la, b, lb, cmp_data); \
+		size_t j = k0 - i; \
+		size_t i1 = name##_corank(k1, a, la, b, lb, cmp_data); \
+		size_t j1 = k1 - i1; \
+		type *out = ctx->dst + s + k0; \
+		while (i < i1 && j < j1) { \
+			if (cmp(a[i], b[j], cmp_data)) \
+				*out++ = b[j++]; \
+			else \
+				*out++ = a[i++]; \
+		} \
+		while (i < i1) \
+			*out++ = a[i++]; \
+		while (j < j1) \
+			*out++ = b[j++]; \
+	} \
+} \
+\
+static void name##_copy_slice(void *arg, int t) { \
+	struct name##_ctx *ctx = arg; \
+	size_t lo = ctx->n * t / ctx->threads; \
+	size_t hi = ctx->n * (t + 1) / ctx->threads; \
+	memcpy(ctx->dst + lo, ctx->src + lo, (hi - lo) * sizeof(type)); \
+} \
+\
+static void name##_run(type *arr, size_t n, int threads, size_t cutoff, data_type cmp_data) { \
+	struct name##_ctx ctx; \
+	ctx.threads = psort_num_threads(threads, n, cutoff); \
+	ctx.dst = NULL; \
+	ctx.bnd = NULL; \
+	if (ctx.threads < 2 || (ctx.dst = malloc(n * sizeof(type))) == NULL || \
+		(ctx.bnd = malloc((ctx.threads + 1) * sizeof(size_t))) == NULL) { \
+		free(ctx.dst); \
+		name##_seq_pdq_loop(arr, n, cmp_data); \
+		return; \
+	} \
+	ctx.src = arr; \
+	ctx.n = n; \
+	ctx.runs = ctx.threads; \
+	ctx.cmp_data = cmp_data; \
+	for (int t = 0 ; t <= ctx.threads ; ++t) \
+		ctx.bnd[t] = n * t / ctx.threads; \
+	struct psort_team *team = psort_team_start(ctx.threads); \
+	psort_team_run(team, name##_sort_chunk, &ctx, ctx.threads); \
+	type *tmp = ctx.dst; \
+	while (ctx.runs > 1) { \
+		psort_team_run(team, name##_merge_slice, &ctx, ctx.threads); \
+		for (int r = 0 ; r <= ctx.runs ; r += 2) \
+			ctx.bnd[r / 2] = ctx.bnd[r]; \
+		ctx.bnd[(ctx.runs + 1) / 2] = n; \
+		ctx.runs = (ctx.runs + 1) / 2; \
+		SWAP(ctx.src, ctx.dst); \
+	} \
+	if (ctx.src != arr) { \
+		ctx.dst = arr; \
+		psort_team_run(team, name##_copy_slice, &ctx, ctx.threads); \
+	} \
+	psort_team_stop(team); \
+	free(tmp); \
+	free(ctx.bnd); \
+}
+
+/*
+	Generate branchless binary searches over an array sorted with the same comparator:
+
+	'static size_t name_lower_bound(const type *arr, size_t n, type key)' returns the index of
+	the first element that doesn't go before key, and 'name_upper_bound' the first that goes
+	after it, or n if there is none.
+
+	Each step picks the next half with a conditional move instead of a branch, and prefetches
+	both candidates for the step after, so misses overlap rather than stall on mispredictions.
+
+	GEN_SEARCH_DATA(name, type, cmp, data_type) generates the same functions with a trailing
+	'data_type cmp_data' argument, as GEN_SORT_DATA, e.g to search a permutation sorted with
+	SORT_ARRAY_CMP_PERM_GT for the key at some index.
+*/
+#define GEN_SEARCH(name, type, cmp) \
+GEN_SEARCH_IMPL(name, type, cmp, const void *) \
+__attribute__((unused)) static size_t name##_lower_bound(const type *arr, size_t n, type key) { \
+	return name##_lower_bound_impl(arr, n, key, NULL); \
+} \
+\
+__attribute__((unused)) static size_t name##_upper_bound(const type *arr, size_t n, type key) { \
+	return name##_upper_bound_impl(arr, n, key, NULL); \
+}
+
+#define GEN_SEARCH_DATA(name, type, cmp, data_type) \
+GEN_SEARCH_IMPL(name, type, cmp, data_type) \
+__attribute__((unused)) static size_t name##_lower_bound(const type *arr, size_t n, type key, data_type cmp_data) { \
+	return name##_lower_bound_impl(arr, n, key, cmp_data); \
+} \
+\
+__attribute__((unused)) static size_t name##_upper_bound(const type *arr, size_t n, type key, data_type cmp_data) { \
+	return name##_upper_bound_impl(arr, n, key, cmp_data); \
+}
+
+#define GEN_SEARCH_IMPL(name, type, cmp, data_type) \
+GEN_SEARCH_BOUND(name##_lower_bound_impl, type, cmp(key, x, cmp_data), data_type) \
+GEN_SEARCH_BOUND(name##_upper_bound_impl, type, !cmp(x, key, cmp_data), data_type)
+
+// before(x) is true for the elements ahead of the result.
+#define GEN_SEARCH_BOUND(name, type, before, data_type) \
+static inline size_t name(const type *arr, size_t n, type key, data_type UNUSED(cmp_data)) { \
+	if (n == 0) \
+		return 0; \
+	const type *base = arr; \
+	while (n > 1) { \
+		size_t half = n / 2; \
+		size_t next = (n - half) / 2; \
+		__builtin_prefetch(base + next); \
+		__builtin_prefetch(base + half + next); \
+		type x = base[half - 1]; \
+		/* Multiply rather than select, which GCC compiles to a branch. */ \
+		base += (size_t)((before) ? 1 : 0) * half; \
+		n -= half; \
+	} \
+	type x = *base; \
+	return (size_t)(base - arr) + ((before) ? 1 : 0); \
+}
+
+/*
+	Generate binary searches over an array in Eytzinger (BFS) order, i.e like a binary heap where
+	the children of element k are at 2k and 2k+1. The top of the tree shares cache lines, and
+	the sixteen descendants four levels down of any element are adjacent, so they can be
+	prefetched a few steps ahead.
+
+	'static void name_build(type *eyt, const type *sorted, size_t n)' lays out n sorted elements
+	in eyt, which must have room for n + 1 elements since index zero is unused. Aligning eyt to
+	a cache line makes the prefetching most effective.
+
+	'static size_t name_lower_bound(const type *eyt, size_t n, type key)' and 'name_upper_bound'
+	return the Eytzinger index of the result, as GEN_SEARCH but in eyt order, or zero if
+	there is none. Keep any associated data in the same order.
+
+	GEN_EYTZINGER_DATA(name, type, cmp, data_type) generates searches with a trailing
+	'data_type cmp_data' argument, as GEN_SEARCH_DATA.
+*/
+#define GEN_EYTZINGER(name, type, cmp) \
+GEN_EYTZINGER_IMPL(name, type, cmp, const void *) \
+__attribute__((unused)) static size_t name##_lower_bound(const type *eyt, size_t n, type key) { \
+	return name##_lower_bound_impl(eyt, n, key, NULL); \
+} \
+\
+__attribute__((unused)) static size_t name##_upper_bound(const type *eyt, size_t n, type key) { \
+	return name##_upper_bound_impl(eyt, n, key, NULL); \
+}
+
+#define GEN_EYTZINGER_DATA(name, type, cmp, data_type) \
+GEN_EYTZINGER_IMPL(name, type, cmp, data_type) \
+__attribute__((unused)) static size_t name##_lower_bound(const type *eyt, size_t n, type key, data_type cmp_data) { \
+	return name##_lower_bound_impl(eyt, n, key, cmp_data); \
+} \
+\
+__attribute__((unused)) static size_t name##_upper_bound(const type *eyt, size_t n, type key, data_type cmp_data) { \
+	return name##_upper_bound_impl(eyt, n, key, cmp_data); \
+}
+
+#define GEN_EYTZINGER_IMPL(name, type, cmp, data_type) \
+static size_t name##_fill(type *eyt, const type *sorted, size_t n, size_t i, size_t k) { \
+	if (k <= n) { \
+		i = name##_fill(eyt, sorted, n, i, 2 * k); \
+		eyt[k] = sorted[i++]; \
+		i = name##_fill(eyt, sorted, n, i, 2 * k + 1); \
+	} \
+	return i; \
+} \
+\
+__attribute__((unused)) static void name##_build(type *eyt, const type *sorted, size_t n) { \
+	name##_fill(eyt, sorted, n, 0, 1); \
+} \
+\
+GEN_EYTZINGER_BOUND(name##_lower_bound_impl, type, cmp(key, x, cmp_data), data_type) \
+GEN_EYTZINGER_BOUND(name##_upper_bound_impl, type, !cmp(x, key, cmp_data), data_type)
+
+// Descend right past the elements ahead of the result, then undo the right turns taken after the last left.
+#define GEN_EYTZINGER_BOUND(name, type, before, data_type) \
+static inline size_t name(const type *eyt, size_t n, type key, data_type UNUSED(cmp_data)) { \
+	const size_t block = 64 / sizeof(type) > 0 ? 64 / sizeof(type) : 1; \
+	size_t k = 1; \
+	while (k <= n) { \
+		__builtin_prefetch(eyt + k * block); \
+		type x = eyt[k]; \
+		k = 2 * k + ((before) ? 1 : 0); \
+	} \
+	k >>= __builtin_ctzll(~(unsigned long long)k) + 1; \
+	return k; \
+}
+
+// Rotate left by dir elements, or right if dir is negative, by reversing both parts and then the whole.
 #define rotate_array(arr, n, dir) rotate_array_impl(arr, n, dir, GENID(d))
 #define rotate_array_impl(arr, n, dir, dID) do { \
+	size_t dID = 0; \
 	if ((n) > 1) { \
-		int dID; \
 		if ((dir) < 0) { \
-			dID = (n) - (-(dir) % (n)); \
+			dID = (0 - (size_t)(dir)) % (size_t)(n); \
+			dID = dID > 0 ? (size_t)(n) - dID : 0; \
 		} else { \
-			dID = ((dir) % (n)); \
-		} \
-		if ((dID > 0) && (dID < (n))) { \
-			--dID; \
-			reverse_array((arr)		 , (dID)	); \
-			reverse_array((arr)+(dID), (n)-(dID)); \
-			reverse_array((arr)      , ((n)-1)  ); \
+			dID = (size_t)(dir) % (size_t)(n); \
 		} \
 	} \
+	if (dID > 0) { \
+		reverse_array((arr), dID); \
+		reverse_array((arr) + dID, (size_t)(n) - dID); \
+		reverse_array((arr), (n)); \
+	} \
 } while(0)
 
+/*
+	Rotate an array of n elements of the given size like rotate_array(), moving bytes with memcpy.
+
+	If the smaller side fits in ROTATE_BUFFER_SIZE bytes it is set aside on the stack while the
+	larger side is moved over with memmove(), otherwise the sides are block-swapped (Gries & Mills)
+	until the remainder fits. Every byte is thus moved about once, where the three reversals of
+	rotate_array() move every element twice.
+*/
+#ifndef ROTATE_BUFFER_SIZE
+#define ROTATE_BUFFER_SIZE 4096
+#endif
+void rotate_array_mem(void *arr, size_t n, size_t size, ptrdiff_t dir);
+
 enum rotate_array_action {
 	ROT_ACTION_SAVE,
 	ROT_ACTION_RESTORE,
@@ -98,11 +905,144 @@ static void name(void *arr, int src, int dst, enum rotate_array_action action, v
 	also more complex structures, such as a whole memory block.
 
 	For something simpler, consider the '3-reverse' algorithm instead.
+	To move contiguous ranges per callback, see rotate_array_range_cb().
 */
 void rotate_array_cb(void *arr, int n, int d, rot_cb cb, void *ctx);
 
+enum rotate_range_action {
+	ROT_RANGE_SWAP,		// Exchange [src, src+count) with [dst, dst+count). The ranges don't overlap.
+	ROT_RANGE_SAVE,		// Save [src, src+count) to temporary storage. count is at most buf_count.
+	ROT_RANGE_MOVE,		// Move [src, src+count) to [dst, dst+count). The ranges may overlap.
+	ROT_RANGE_RESTORE	// Copy the saved elements to [dst, dst+count).
+};
+
+typedef void (*rot_range_cb)(void *arr, size_t src, size_t dst, size_t count, enum rotate_range_action action, void *ctx);
+
+/*
+	Macro to generate rotate_array_range_cb() callbacks for trivial types, using memcpy() and memmove().
+	ctx must point to storage for buf_count elements, or may be NULL if buf_count is zero.
+*/
+#define GEN_ROTATE_ARRAY_RANGE_CB(name, type) \
+static void name(void *arr, size_t src, size_t dst, size_t count, enum rotate_range_action action, void *ctx) { \
+	type *typed_arr = arr; \
+	switch (action) { \
+		case ROT_RANGE_SWAP: { \
+			type tmp[256 / sizeof(type) > 0 ? 256 / sizeof(type) : 1]; \
+			for ( ; count >= ARRAY_SIZE(tmp) ; count -= ARRAY_SIZE(tmp)) { \
+				memcpy(tmp, typed_arr + src, sizeof(tmp)); \
+				memcpy(typed_arr + src, typed_arr + dst, sizeof(tmp)); \
+				memcpy(typed_arr + dst, tmp, sizeof(tmp)); \
+				src += ARRAY_SIZE(tmp); \
+				dst += ARRAY_SIZE(tmp); \
+			} \
+			memcpy(tmp, typed_arr + src, count * sizeof(type)); \
+			memcpy(typed_arr + src, typed_arr + dst, count * sizeof(type)); \
+			memcpy(typed_arr + dst, tmp, count * sizeof(type)); \
+			break; \
+		} \
+		case ROT_RANGE_SAVE: \
+			memcpy(ctx, typed_arr + src, count * sizeof(type)); \
+			break; \
+		case ROT_RANGE_MOVE: \
+			memmove(typed_arr + dst, typed_arr + src, count * sizeof(type)); \
+			break; \
+		case ROT_RANGE_RESTORE: \
+			memcpy(typed_arr + dst, ctx, count * sizeof(type)); \
+			break; \
+	} \
+}
+
+/*
+	Rotate like rotate_array_cb(), but with callbacks over contiguous ranges of elements.
+
+	Block-swaps the two sides (Gries & Mills, "Swapping Sections") until the smaller one is
+	at most buf_count elements, then saves it, moves the larger one over and restores it.
+	Every callback covers a contiguous range, so it can be served by memcpy() and memmove()
+	at sequential access, unlike the strided single-element copies of the juggling algorithm.
+
+	With buf_count zero, only ROT_RANGE_SWAP is used, but tiny remainders may then take
+	many callbacks.
+*/
+void rotate_array_range_cb(void *arr, size_t n, ptrdiff_t d, size_t buf_count, rot_range_cb cb, void *ctx);
+
+/*
+	LSD radix sort in ascending order, with 11-bit digits.
+
+	All digit histograms are counted in a single pass up front, and passes where every key
+	has the same digit are skipped. Floats are ordered by their bits made order-preserving,
+	i.e -0.0 sorts before 0.0, and NaNs go to the ends according to their sign.
+
+	tmp must have room for n elements, or be NULL to have it allocated.
+
+	Returns 0 on success, or -1 if memory allocation failed.
+*/
+int radix_sort_u32(uint32_t *arr, size_t n, uint32_t *tmp);
+int radix_sort_i32(int32_t *arr, size_t n, int32_t *tmp);
+int radix_sort_u64(uint64_t *arr, size_t n, uint64_t *tmp);
+int radix_sort_f32(float *arr, size_t n, float *tmp);
+
+/*
+	Radix argsort. Fills perm with the indices of keys in ascending key order.
+
+	The sort is stable, so the permutation is the same as the one produced by
+	'sort_array_cmp_data(perm, n, SORT_ARRAY_CMP_PERM_GT, keys)' from the identity.
+	n must not exceed UINT32_MAX.
+
+	Returns 0 on success, or -1 if memory allocation failed.
+*/
+int radix_argsort_u32(const uint32_t *keys, size_t n, uint32_t *perm);
+int radix_argsort_i32(const int32_t *keys, size_t n, uint32_t *perm);
+int radix_argsort_u64(const uint64_t *keys, size_t n, uint32_t *perm);
+int radix_argsort_f32(const float *keys, size_t n, uint32_t *perm);
+
+/*
+	Sort small arrays of up to SORT_NET_MAX elements in ascending order, without data-dependent branches.
+
+	The input is padded up to 8, 16 or 32 elements and run through a bitonic sorting network,
+	built from AVX2 min/max and permutes when available, and from scalar min/max otherwise.
+	Larger arrays are passed on to a GEN_SORT instance. Not stable. Floats must not be NaN.
+*/
+#define SORT_NET_MAX 32
+void sort_small_i32(int32_t *arr, size_t n);
+void sort_small_u32(uint32_t *arr, size_t n);
+void sort_small_f32(float *arr, size_t n);
+
+enum sort_cstr_flags {
+	SORT_CSTR_ASC = 0,
+	SORT_CSTR_DESC = 1,
+};
+
+/*
+	Sort an array of C strings in strcmp() order, or reverse order with SORT_CSTR_DESC.
+
+	Multikey quicksort (Bentley & Sedgewick) over eight characters at a time: the next eight
+	characters of each string are cached as an integer key, and only partitions of strings
+	sharing those characters move on to load the next eight. Common prefixes are thus read
+	once per partitioning level rather than once per comparison. The stack depth is logarithmic,
+	and a heapsort fallback bounds the worst case, as for GEN_SORT. Not stable.
+
+	Returns 0 on success, or -1 if memory allocation failed.
+*/
+int sort_cstr(const char **arr, size_t n, int flags);
+
+/*
+	Like sort_cstr(), but leaves arr untouched and fills perm with the indices of its strings
+	in sorted order. n must not exceed UINT32_MAX.
+*/
+int sort_cstr_perm(const char *const *arr, size_t n, uint32_t *perm, int flags);
+
 #ifdef EUTILS_IMPLEMENTATION
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h> // for INFINITY
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ecpu.h"
+#ifdef EUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
 
 static int gcd(int a, int b) {
 	assert(a >= 0);
@@ -146,6 +1086,956 @@ void rotate_array_cb(void *arr, int n, int d, rot_cb cb, void *ctx) {
 	}
 }
 
+#ifdef EUTILS_X86_SIMD
+#define REVERSE_U8(v) _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, _mm256_setr_epi8( \
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, \
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)), 0x4E)
+#define REVERSE_U16(v) _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, _mm256_setr_epi8( \
+	14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1, \
+	14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1)), 0x4E)
+#define REVERSE_U32(v) _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))
+#endif
+
+#ifdef EUTILS_X86_SIMD
+// Swaps the outer vectors of arr, and returns how many elements at each end are done.
+#define GEN_REVERSE_ARRAY(sfx, type, REV) \
+EUTILS_TARGET_AVX2 static size_t reverse_array_avx2_##sfx(type *arr, size_t n) { \
+	const size_t lanes = 32 / sizeof(type); \
+	size_t i = 0; \
+	size_t j = n; \
+	while (j - i >= 2 * lanes) { \
+		j -= lanes; \
+		__m256i a = _mm256_loadu_si256((const __m256i*)(arr + i)); \
+		__m256i b = _mm256_loadu_si256((const __m256i*)(arr + j)); \
+		_mm256_storeu_si256((__m256i*)(arr + i), REV(b)); \
+		_mm256_storeu_si256((__m256i*)(arr + j), REV(a)); \
+		i += lanes; \
+	} \
+	return i; \
+} \
+\
+void reverse_array_##sfx(type *arr, size_t n) { \
+	size_t i = cpu_level() >= CPU_AVX2 ? reverse_array_avx2_##sfx(arr, n) : 0; \
+	reverse_array(arr + i, n - 2 * i); \
+}
+#else
+#define GEN_REVERSE_ARRAY(sfx, type, REV) \
+void reverse_array_##sfx(type *arr, size_t n) { \
+	reverse_array(arr, n); \
+}
+#endif
+
+GEN_REVERSE_ARRAY(u8, uint8_t, REVERSE_U8)
+GEN_REVERSE_ARRAY(u16, uint16_t, REVERSE_U16)
+GEN_REVERSE_ARRAY(u32, uint32_t, REVERSE_U32)
+
+#ifdef EUTILS_X86_SIMD
+#define LOAD_PS(p) _mm256_loadu_ps(p)
+#define STORE_PS(p, v) _mm256_storeu_ps(p, v)
+#define LOAD_SI256(p) _mm256_loadu_si256((const __m256i*)(p))
+#define STORE_SI256(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define SET1_EPI8(x) _mm256_set1_epi8((char)(x))
+#define LOAD512_PS(p) _mm512_loadu_ps(p)
+#define STORE512_PS(p, v) _mm512_storeu_ps(p, v)
+#define LOAD_SI512(p) _mm512_loadu_si512(p)
+#define STORE_SI512(p, v) _mm512_storeu_si512(p, v)
+#define SET1_EPI8_512(x) _mm512_set1_epi8((char)(x))
+
+// maxps/minps return the second operand unless the first is greater/less, i.e v < lo ? lo : v.
+EUTILS_TARGET_AVX2 static inline __m256 clamp_v_f32(__m256 v, __m256 lo, __m256 hi) {
+	__m256 r = _mm256_max_ps(lo, v);
+	return _mm256_blendv_ps(r, hi, _mm256_cmp_ps(v, hi, _CMP_GT_OQ));
+}
+
+EUTILS_TARGET_AVX2 static inline __m256i clamp_v_i32(__m256i v, __m256i lo, __m256i hi) {
+	__m256i r = _mm256_max_epi32(lo, v);
+	return _mm256_blendv_epi8(r, hi, _mm256_cmpgt_epi32(v, hi));
+}
+
+// There's no unsigned compare, but v <= hi exactly when max(v, hi) == hi.
+EUTILS_TARGET_AVX2 static inline __m256i clamp_v_u8(__m256i v, __m256i lo, __m256i hi) {
+	__m256i r = _mm256_max_epu8(lo, v);
+	return _mm256_blendv_epi8(hi, r, _mm256_cmpeq_epi8(_mm256_max_epu8(v, hi), hi));
+}
+
+EUTILS_TARGET_AVX512 static inline __m512 clamp_v512_f32(__m512 v, __m512 lo, __m512 hi) {
+	return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(v, hi, _CMP_GT_OQ), _mm512_max_ps(lo, v), hi);
+}
+
+EUTILS_TARGET_AVX512 static inline __m512i clamp_v512_i32(__m512i v, __m512i lo, __m512i hi) {
+	return _mm512_mask_blend_epi32(_mm512_cmpgt_epi32_mask(v, hi), _mm512_max_epi32(lo, v), hi);
+}
+
+EUTILS_TARGET_AVX512 static inline __m512i clamp_v512_u8(__m512i v, __m512i lo, __m512i hi) {
+	return _mm512_mask_blend_epi8(_mm512_cmpgt_epu8_mask(v, hi), _mm512_max_epu8(lo, v), hi);
+}
+
+// The vector loop of clamp_sfx() for one instruction set. Returns the number of elements done.
+#define GEN_CLAMP_KERNEL(isa, TARGET, sfx, type, vec, LOAD, STORE, SET1, VCLAMP) \
+TARGET static size_t clamp_##isa##_##sfx(type *dst, const type *src, size_t n, type lo, type hi) { \
+	const size_t lanes = sizeof(vec) / sizeof(type); \
+	const vec vlo = SET1(lo); \
+	const vec vhi = SET1(hi); \
+	size_t i = 0; \
+	for ( ; i + lanes <= n ; i += lanes) \
+		STORE(dst + i, VCLAMP(LOAD(src + i), vlo, vhi)); \
+	return i; \
+}
+
+// Reduce per lane, then fold the lanes into *mn and *mx. Returns the number of elements done,
+// which is one, arr[0], if n is too small.
+#define GEN_MINMAX_KERNEL(isa, TARGET, sfx, type, vec, LOAD, STORE, VMIN, VMAX) \
+TARGET static size_t minmax_##isa##_##sfx(const type *arr, size_t n, type *mn, type *mx) { \
+	const size_t lanes = sizeof(vec) / sizeof(type); \
+	if (n < 2 * lanes) \
+		return 1; \
+	vec vmn = LOAD(arr); \
+	vec vmx = vmn; \
+	size_t i = lanes; \
+	for ( ; i + lanes <= n ; i += lanes) { \
+		vec v = LOAD(arr + i); \
+		vmn = VMIN(vmn, v); \
+		vmx = VMAX(vmx, v); \
+	} \
+	type lmn[sizeof(vec) / sizeof(type)]; \
+	type lmx[sizeof(vec) / sizeof(type)]; \
+	STORE(lmn, vmn); \
+	STORE(lmx, vmx); \
+	*mn = lmn[0]; \
+	*mx = lmx[0]; \
+	for (size_t l = 1 ; l < lanes ; ++l) { \
+		*mn = MIN(*mn, lmn[l]); \
+		*mx = MAX(*mx, lmx[l]); \
+	} \
+	return i; \
+}
+
+GEN_CLAMP_KERNEL(avx2, EUTILS_TARGET_AVX2, f32, float, __m256, LOAD_PS, STORE_PS, _mm256_set1_ps, clamp_v_f32)
+GEN_CLAMP_KERNEL(avx2, EUTILS_TARGET_AVX2, i32, int32_t, __m256i, LOAD_SI256, STORE_SI256, _mm256_set1_epi32, clamp_v_i32)
+GEN_CLAMP_KERNEL(avx2, EUTILS_TARGET_AVX2, u8, uint8_t, __m256i, LOAD_SI256, STORE_SI256, SET1_EPI8, clamp_v_u8)
+GEN_CLAMP_KERNEL(avx512, EUTILS_TARGET_AVX512, f32, float, __m512, LOAD512_PS, STORE512_PS, _mm512_set1_ps, clamp_v512_f32)
+GEN_CLAMP_KERNEL(avx512, EUTILS_TARGET_AVX512, i32, int32_t, __m512i, LOAD_SI512, STORE_SI512, _mm512_set1_epi32, clamp_v512_i32)
+GEN_CLAMP_KERNEL(avx512, EUTILS_TARGET_AVX512, u8, uint8_t, __m512i, LOAD_SI512, STORE_SI512, SET1_EPI8_512, clamp_v512_u8)
+GEN_MINMAX_KERNEL(avx2, EUTILS_TARGET_AVX2, f32, float, __m256, LOAD_PS, STORE_PS, _mm256_min_ps, _mm256_max_ps)
+GEN_MINMAX_KERNEL(avx2, EUTILS_TARGET_AVX2, i32, int32_t, __m256i, LOAD_SI256, STORE_SI256, _mm256_min_epi32, _mm256_max_epi32)
+GEN_MINMAX_KERNEL(avx2, EUTILS_TARGET_AVX2, u8, uint8_t, __m256i, LOAD_SI256, STORE_SI256, _mm256_min_epu8, _mm256_max_epu8)
+GEN_MINMAX_KERNEL(avx512, EUTILS_TARGET_AVX512, f32, float, __m512, LOAD512_PS, STORE512_PS, _mm512_min_ps, _mm512_max_ps)
+GEN_MINMAX_KERNEL(avx512, EUTILS_TARGET_AVX512, i32, int32_t, __m512i, LOAD_SI512, STORE_SI512, _mm512_min_epi32, _mm512_max_epi32)
+GEN_MINMAX_KERNEL(avx512, EUTILS_TARGET_AVX512, u8, uint8_t, __m512i, LOAD_SI512, STORE_SI512, _mm512_min_epu8, _mm512_max_epu8)
+
+// Run the widest name_isa_sfx kernel the CPU supports, setting done to what it returns.
+#define KERNEL_DISPATCH(done, name, sfx, args) do { \
+	int level_ = cpu_level(); \
+	if (level_ >= CPU_AVX512) \
+		done = name##_avx512_##sfx args; \
+	else if (level_ >= CPU_AVX2) \
+		done = name##_avx2_##sfx args; \
+} while (0)
+#else
+#define KERNEL_DISPATCH(done, name, sfx, args) do { } while (0)
+#endif
+
+#define GEN_CLAMP_ARRAY(sfx, type) \
+void clamp_##sfx(type *dst, const type *src, size_t n, type lo, type hi) { \
+	size_t i = 0; \
+	KERNEL_DISPATCH(i, clamp, sfx, (dst, src, n, lo, hi)); \
+	for ( ; i < n ; ++i) \
+		dst[i] = CLAMP(src[i], lo, hi); \
+}
+
+#define GEN_MINMAX_REDUCE(sfx, type) \
+void minmax_reduce_##sfx(const type *arr, size_t n, type *min, type *max) { \
+	if (n == 0) \
+		return; \
+	type mn = arr[0]; \
+	type mx = arr[0]; \
+	size_t i = 1; \
+	KERNEL_DISPATCH(i, minmax, sfx, (arr, n, &mn, &mx)); \
+	for ( ; i < n ; ++i) { \
+		mn = MIN(mn, arr[i]); \
+		mx = MAX(mx, arr[i]); \
+	} \
+	*min = mn; \
+	*max = mx; \
+}
+
+GEN_CLAMP_ARRAY(f32, float)
+GEN_CLAMP_ARRAY(i32, int32_t)
+GEN_CLAMP_ARRAY(u8, uint8_t)
+GEN_MINMAX_REDUCE(f32, float)
+GEN_MINMAX_REDUCE(i32, int32_t)
+GEN_MINMAX_REDUCE(u8, uint8_t)
+
+#ifdef EUTILS_X86_SIMD
+EUTILS_TARGET_AVX2 static void lerp_avx2_f32(float *dst, const float *v0, const float *v1, size_t n, float t) {
+	const __m256 vt = _mm256_set1_ps(t);
+	size_t i = 0;
+	for ( ; i + 8 <= n ; i += 8) {
+		__m256 a = _mm256_loadu_ps(v0 + i);
+		__m256 b = _mm256_loadu_ps(v1 + i);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(a, _mm256_mul_ps(vt, _mm256_sub_ps(b, a))));
+	}
+	// The tail goes through the same instructions, since the compiler may contract a scalar loop.
+	if (i < n) {
+		float a[8] = { 0 }, b[8] = { 0 };
+		memcpy(a, v0 + i, (n - i) * sizeof(float));
+		memcpy(b, v1 + i, (n - i) * sizeof(float));
+		lerp_avx2_f32(a, a, b, 8, t);
+		memcpy(dst + i, a, (n - i) * sizeof(float));
+	}
+}
+
+// Widen to 16 bits, where v0 * (255 - t) + v1 * t + 128 still fits. Returns the number of elements done.
+EUTILS_TARGET_AVX2 static size_t lerp_avx2_u8(uint8_t *dst, const uint8_t *v0, const uint8_t *v1, size_t n, uint8_t t) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i w0 = _mm256_set1_epi16(255 - t);
+	const __m256i w1 = _mm256_set1_epi16(t);
+	const __m256i bias = _mm256_set1_epi16(128);
+	size_t i = 0;
+	for ( ; i + 32 <= n ; i += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)(v0 + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(v1 + i));
+		__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), w0), _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), w1));
+		__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), w0), _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), w1));
+		lo = _mm256_add_epi16(lo, bias);
+		hi = _mm256_add_epi16(hi, bias);
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+		// The unpacks and the pack both work within 128-bit lanes, so the order comes back out.
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+	return i;
+}
+#endif
+
+void lerp_f32(float *dst, const float *v0, const float *v1, size_t n, float t) {
+#ifdef EUTILS_X86_SIMD
+	if (cpu_level() >= CPU_AVX2) {
+		lerp_avx2_f32(dst, v0, v1, n, t);
+		return;
+	}
+#endif
+	for (size_t i = 0 ; i < n ; ++i)
+		dst[i] = LERP(v0[i], v1[i], t);
+}
+
+// x / 255 rounded to nearest, for x in [0, 255 * 255] (Jim Blinn).
+#define DIV255_ROUND(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+
+void lerp_u8(uint8_t *dst, const uint8_t *v0, const uint8_t *v1, size_t n, uint8_t t) {
+	size_t i = 0;
+#ifdef EUTILS_X86_SIMD
+	if (cpu_level() >= CPU_AVX2)
+		i = lerp_avx2_u8(dst, v0, v1, n, t);
+#endif
+	for ( ; i < n ; ++i)
+		dst[i] = DIV255_ROUND(v0[i] * (255u - t) + v1[i] * (unsigned)t);
+}
+
+// Rotate the left bytes of p past the right ones. The smaller side must fit in ROTATE_BUFFER_SIZE.
+static void rotate_buffered(uint8_t *p, size_t left, size_t right) {
+	uint8_t buf[ROTATE_BUFFER_SIZE];
+	if (left <= right) {
+		memcpy(buf, p, left);
+		memmove(p, p + left, right);
+		memcpy(p + right, buf, left);
+	} else {
+		memcpy(buf, p + left, right);
+		memmove(p + right, p, left);
+		memcpy(p, buf, right);
+	}
+}
+
+static void swap_ranges(uint8_t *a, uint8_t *b, size_t len) {
+	uint8_t tmp[256];
+	while (len >= sizeof(tmp)) {
+		memcpy(tmp, a, sizeof(tmp));
+		memcpy(a, b, sizeof(tmp));
+		memcpy(b, tmp, sizeof(tmp));
+		a += sizeof(tmp);
+		b += sizeof(tmp);
+		len -= sizeof(tmp);
+	}
+	memcpy(tmp, a, len);
+	memcpy(a, b, len);
+	memcpy(b, tmp, len);
+}
+
+void rotate_array_range_cb(void *arr, size_t n, ptrdiff_t d, size_t buf_count, rot_range_cb cb, void *ctx) {
+	size_t shift = 0;
+	if (n > 1) {
+		if (d < 0) {
+			shift = (0 - (size_t)d) % n;
+			shift = shift > 0 ? n - shift : 0;
+		} else {
+			shift = (size_t)d % n;
+		}
+	}
+	if (shift == 0)
+		return;
+
+	// [mid - i, mid) and [mid, mid + j) remain to be exchanged.
+	size_t mid = shift;
+	size_t i = shift;
+	size_t j = n - shift;
+	while (MIN(i, j) > buf_count) {
+		if (i > j) {
+			cb(arr, mid - i, mid, j, ROT_RANGE_SWAP, ctx);
+			i -= j;
+		} else {
+			cb(arr, mid - i, mid + j - i, i, ROT_RANGE_SWAP, ctx);
+			j -= i;
+		}
+	}
+	if (i == 0 || j == 0)
+		return;
+	if (i <= j) {
+		cb(arr, mid - i, 0, i, ROT_RANGE_SAVE, ctx);
+		cb(arr, mid, mid - i, j, ROT_RANGE_MOVE, ctx);
+		cb(arr, 0, mid - i + j, i, ROT_RANGE_RESTORE, ctx);
+	} else {
+		cb(arr, mid, 0, j, ROT_RANGE_SAVE, ctx);
+		cb(arr, mid - i, mid - i + j, i, ROT_RANGE_MOVE, ctx);
+		cb(arr, 0, mid - i, j, ROT_RANGE_RESTORE, ctx);
+	}
+}
+
+void rotate_array_mem(void *arr, size_t n, size_t size, ptrdiff_t dir) {
+	size_t d = 0;
+	if (n > 1) {
+		if (dir < 0) {
+			d = (0 - (size_t)dir) % n;
+			d = d > 0 ? n - d : 0;
+		} else {
+			d = (size_t)dir % n;
+		}
+	}
+	if (d == 0)
+		return;
+
+	// Gries-Mills: [mid - i, mid) and [mid, mid + j) remain to be exchanged.
+	uint8_t *mid = (uint8_t*)arr + d * size;
+	size_t i = d * size;
+	size_t j = (n - d) * size;
+	while (MIN(i, j) > ROTATE_BUFFER_SIZE) {
+		if (i > j) {
+			swap_ranges(mid - i, mid, j);
+			i -= j;
+		} else {
+			swap_ranges(mid - i, mid + j - i, i);
+			j -= i;
+		}
+	}
+	rotate_buffered(mid - i, i, j);
+}
+
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+// Below this, the histogram overhead dominates, so use insertion sort.
+#define RADIX_SMALL 64
+
+// The sorts reinterpret signed and float arrays as their unsigned keys, in place.
+typedef uint32_t __attribute__((may_alias)) radix_u32;
+typedef uint64_t __attribute__((may_alias)) radix_u64;
+
+// Sort keys, and perm along with it if not NULL. ktmp and ptmp are scratch space of n elements.
+#define GEN_RADIX_CORE(name, K) \
+static int name(K *keys, K *ktmp, size_t n, uint32_t *perm, uint32_t *ptmp) { \
+	enum { passes = (sizeof(K) * 8 + RADIX_BITS - 1) / RADIX_BITS }; \
+	const K mask = RADIX_BUCKETS - 1; \
+\
+	if (n <= RADIX_SMALL) { \
+		for (size_t i = 1 ; i < n ; ++i) { \
+			K k = keys[i]; \
+			uint32_t p = perm ? perm[i] : 0; \
+			size_t j = i; \
+			for ( ; j > 0 && keys[j - 1] > k ; --j) { \
+				keys[j] = keys[j - 1]; \
+				if (perm) \
+					perm[j] = perm[j - 1]; \
+			} \
+			keys[j] = k; \
+			if (perm) \
+				perm[j] = p; \
+		} \
+		return 0; \
+	} \
+\
+	size_t *hist = calloc(passes * RADIX_BUCKETS, sizeof(*hist)); \
+	if (!hist) \
+		return -1; \
+	for (size_t i = 0 ; i < n ; ++i) { \
+		K k = keys[i]; \
+		for (int p = 0 ; p < passes ; ++p) \
+			hist[p * RADIX_BUCKETS + ((k >> (p * RADIX_BITS)) & mask)]++; \
+	} \
+\
+	K *src = keys; \
+	K *dst = ktmp; \
+	uint32_t *psrc = perm; \
+	uint32_t *pdst = ptmp; \
+	for (int p = 0 ; p < passes ; ++p) { \
+		size_t *h = hist + p * RADIX_BUCKETS; \
+		unsigned shift = p * RADIX_BITS; \
+		if (h[(src[0] >> shift) & mask] == n) \
+			continue; \
+		size_t sum = 0; \
+		for (size_t b = 0 ; b < RADIX_BUCKETS ; ++b) { \
+			size_t c = h[b]; \
+			h[b] = sum; \
+			sum += c; \
+		} \
+		if (perm) { \
+			for (size_t i = 0 ; i < n ; ++i) { \
+				size_t d = h[(src[i] >> shift) & mask]++; \
+				dst[d] = src[i]; \
+				pdst[d] = psrc[i]; \
+			} \
+			SWAP(psrc, pdst); \
+		} else { \
+			for (size_t i = 0 ; i < n ; ++i) \
+				dst[h[(src[i] >> shift) & mask]++] = src[i]; \
+		} \
+		SWAP(src, dst); \
+	} \
+	if (src != keys) { \
+		memcpy(keys, src, n * sizeof(*keys)); \
+		if (perm) \
+			memcpy(perm, psrc, n * sizeof(*perm)); \
+	} \
+	free(hist); \
+	return 0; \
+}
+
+GEN_RADIX_CORE(radix_core_u32, radix_u32)
+GEN_RADIX_CORE(radix_core_u64, radix_u64)
+
+// Flip the sign bit of positive floats, and all bits of negative ones, to order them as unsigned.
+static inline uint32_t radix_key_f32(uint32_t bits) {
+	return bits ^ (-(bits >> 31) | 0x80000000U);
+}
+
+static inline uint32_t radix_unkey_f32(uint32_t key) {
+	return key ^ (((key >> 31) - 1) | 0x80000000U);
+}
+
+static inline uint32_t radix_key_i32(uint32_t bits) {
+	return bits ^ 0x80000000U;
+}
+
+int radix_sort_u32(uint32_t *arr, size_t n, uint32_t *tmp) {
+	uint32_t *buf = tmp;
+	if (!buf && n > RADIX_SMALL && (buf = malloc(n * sizeof(*buf))) == NULL)
+		return -1;
+	int res = radix_core_u32(arr, buf, n, NULL, NULL);
+	if (buf != tmp)
+		free(buf);
+	return res;
+}
+
+int radix_sort_u64(uint64_t *arr, size_t n, uint64_t *tmp) {
+	uint64_t *buf = tmp;
+	if (!buf && n > RADIX_SMALL && (buf = malloc(n * sizeof(*buf))) == NULL)
+		return -1;
+	int res = radix_core_u64(arr, buf, n, NULL, NULL);
+	if (buf != tmp)
+		free(buf);
+	return res;
+}
+
+int radix_sort_i32(int32_t *arr, size_t n, int32_t *tmp) {
+	radix_u32 *keys = (radix_u32*)arr;
+	for (size_t i = 0 ; i < n ; ++i)
+		keys[i] = radix_key_i32(keys[i]);
+	int res = radix_sort_u32(keys, n, (radix_u32*)tmp);
+	for (size_t i = 0 ; i < n ; ++i)
+		keys[i] = radix_key_i32(keys[i]);
+	return res;
+}
+
+int radix_sort_f32(float *arr, size_t n, float *tmp) {
+	radix_u32 *keys = (radix_u32*)arr;
+	for (size_t i = 0 ; i < n ; ++i)
+		keys[i] = radix_key_f32(keys[i]);
+	int res = radix_sort_u32(keys, n, (radix_u32*)tmp);
+	for (size_t i = 0 ; i < n ; ++i)
+		keys[i] = radix_unkey_f32(keys[i]);
+	return res;
+}
+
+// Argsort through a transformed copy of the keys. 'key' maps each input element to its unsigned key.
+#define GEN_RADIX_ARGSORT(name, T, K, core, key) \
+int name(const T *keys, size_t n, uint32_t *perm) { \
+	assert(n <= UINT32_MAX); \
+	K *buf = malloc(2 * n * sizeof(*buf) + n * sizeof(*perm)); \
+	if (!buf && n > 0) \
+		return -1; \
+	const K *in = (const K*)keys; \
+	for (size_t i = 0 ; i < n ; ++i) { \
+		buf[i] = key(in[i]); \
+		perm[i] = i; \
+	} \
+	int res = core(buf, buf + n, n, perm, (uint32_t*)(buf + 2 * n)); \
+	free(buf); \
+	return res; \
+}
+
+#define RADIX_KEY_IDENTITY(x) (x)
+GEN_RADIX_ARGSORT(radix_argsort_u32, uint32_t, radix_u32, radix_core_u32, RADIX_KEY_IDENTITY)
+GEN_RADIX_ARGSORT(radix_argsort_i32, int32_t, radix_u32, radix_core_u32, radix_key_i32)
+GEN_RADIX_ARGSORT(radix_argsort_u64, uint64_t, radix_u64, radix_core_u64, RADIX_KEY_IDENTITY)
+GEN_RADIX_ARGSORT(radix_argsort_f32, float, radix_u32, radix_core_u32, radix_key_f32)
+#undef RADIX_KEY_IDENTITY
+
+// Below this, finish partitions with insertion sort.
+#define CSTR_SORT_SMALL 16
+
+// A string with its next eight characters cached in big-endian order, zero-padded after the terminator.
+struct cstr_item {
+	uint64_t key;
+	const char *str;
+};
+
+static inline uint64_t cstr_key(const char *s) {
+	uint64_t key = 0;
+	for (int i = 0 ; i < 8 ; ++i) {
+		unsigned char c = s[i];
+		key |= (uint64_t)c << (56 - 8 * i);
+		if (c == 0)
+			break;
+	}
+	return key;
+}
+
+static inline void cstr_swap(struct cstr_item *items, uint32_t *perm, size_t a, size_t b) {
+	SWAP(items[a], items[b]);
+	if (perm)
+		SWAP(perm[a], perm[b]);
+}
+
+// Greater-than on strings sharing their first depth characters, with keys cached at depth.
+static inline int cstr_gt(const struct cstr_item *a, const struct cstr_item *b, size_t depth) {
+	if (a->key != b->key)
+		return a->key > b->key;
+	return (a->key & 0xFF) && strcmp(a->str + depth + 8, b->str + depth + 8) > 0;
+}
+
+static void cstr_insertion(struct cstr_item *items, uint32_t *perm, size_t n, size_t depth) {
+	for (size_t i = 1 ; i < n ; ++i) {
+		for (size_t j = i ; j > 0 && cstr_gt(&items[j - 1], &items[j], depth) ; --j)
+			cstr_swap(items, perm, j - 1, j);
+	}
+}
+
+static void cstr_sift_down(struct cstr_item *items, uint32_t *perm, size_t i, size_t n, size_t depth) {
+	for (size_t c ; (c = 2 * i + 1) < n ; i = c) {
+		if (c + 1 < n && cstr_gt(&items[c + 1], &items[c], depth))
+			++c;
+		if (!cstr_gt(&items[c], &items[i], depth))
+			break;
+		cstr_swap(items, perm, i, c);
+	}
+}
+
+// The fallback bounding the worst case, as in GEN_SORT.
+static void cstr_heapsort(struct cstr_item *items, uint32_t *perm, size_t n, size_t depth) {
+	for (size_t i = n / 2 ; i-- > 0 ; )
+		cstr_sift_down(items, perm, i, n, depth);
+	for (size_t i = n ; i-- > 1 ; ) {
+		cstr_swap(items, perm, 0, i);
+		cstr_sift_down(items, perm, 0, i, depth);
+	}
+}
+
+static inline uint64_t cstr_med3(uint64_t a, uint64_t b, uint64_t c) {
+	if (a > b)
+		SWAP(a, b);
+	return c <= a ? a : c >= b ? b : c;
+}
+
+// Cache the eight characters at depth of each string.
+static void cstr_load_keys(struct cstr_item *items, size_t n, size_t depth) {
+	for (size_t k = 0 ; k < n ; ++k) {
+		// The strings are scattered by now, so fetch ahead.
+		if (k + 16 < n)
+			__builtin_prefetch(items[k + 16].str + depth);
+		items[k].key = cstr_key(items[k].str + depth);
+	}
+}
+
+/*
+	Only the two smaller of the three partitions are recursed into, each at most half of n,
+	bounding the stack depth, and the loop continues with the largest. Continuing with an outer
+	partition that the pivot barely shrank counts as bad, and after too many of those the rest is
+	heapsorted, like the pdqsort in GEN_SORT.
+*/
+static void cstr_mkqsort(struct cstr_item *items, uint32_t *perm, size_t n, size_t depth, int bad_allowed) {
+	while (n > CSTR_SORT_SMALL) {
+		uint64_t pivot;
+		if (n > 1024) {
+			size_t s = n / 8;
+			pivot = cstr_med3(cstr_med3(items[0].key, items[s].key, items[2 * s].key),
+				cstr_med3(items[3 * s].key, items[n / 2].key, items[5 * s].key),
+				cstr_med3(items[6 * s].key, items[7 * s].key, items[n - 1].key));
+		} else {
+			pivot = cstr_med3(items[0].key, items[n / 2].key, items[n - 1].key);
+		}
+
+		// Three-way partition into [0, lt) < pivot, [lt, gt) == pivot, [gt, n) > pivot.
+		size_t lt = 0, i = 0, gt = n;
+		while (i < gt) {
+			if (items[i].key < pivot)
+				cstr_swap(items, perm, i++, lt++);
+			else if (items[i].key > pivot)
+				cstr_swap(items, perm, i, --gt);
+			else
+				++i;
+		}
+
+		// Strings equal to a pivot that ends within its eight characters are done.
+		size_t left = lt;
+		size_t mid = (pivot & 0xFF) ? gt - lt : 0;
+		size_t right = n - gt;
+		uint32_t *perm_mid = perm ? perm + lt : NULL;
+		uint32_t *perm_right = perm ? perm + gt : NULL;
+
+		if (mid >= left && mid >= right) {
+			cstr_mkqsort(items, perm, left, depth, bad_allowed);
+			cstr_mkqsort(items + gt, perm_right, right, depth, bad_allowed);
+			if (mid == 0)
+				return;
+			items += lt;
+			perm = perm_mid;
+			n = mid;
+			depth += 8;
+			cstr_load_keys(items, n, depth);
+			continue;
+		}
+
+		if (mid) {
+			cstr_load_keys(items + lt, mid, depth + 8);
+			cstr_mkqsort(items + lt, perm_mid, mid, depth + 8, bad_allowed);
+		}
+		size_t next;
+		if (left >= right) {
+			cstr_mkqsort(items + gt, perm_right, right, depth, bad_allowed);
+			next = left;
+		} else {
+			cstr_mkqsort(items, perm, left, depth, bad_allowed);
+			items += gt;
+			perm = perm_right;
+			next = right;
+		}
+		if (next > n - n / 8 && --bad_allowed == 0) {
+			cstr_heapsort(items, perm, next, depth);
+			return;
+		}
+		n = next;
+	}
+	cstr_insertion(items, perm, n, depth);
+}
+
+// Sort strs, and perm along with it if not NULL.
+static int cstr_sort_impl(const char **strs, uint32_t *perm, size_t n, int flags) {
+	struct cstr_item *items = malloc(n * sizeof(*items));
+	if (!items && n > 0)
+		return -1;
+	for (size_t i = 0 ; i < n ; ++i)
+		items[i] = (struct cstr_item){ cstr_key(strs[i]), strs[i] };
+	int bad_allowed = 1;
+	for (size_t m = n ; m > 1 ; m >>= 1)
+		++bad_allowed;
+	cstr_mkqsort(items, perm, n, 0, bad_allowed);
+	for (size_t i = 0 ; i < n ; ++i)
+		strs[i] = items[i].str;
+	free(items);
+
+	if (flags & SORT_CSTR_DESC) {
+		reverse_array(strs, n);
+		if (perm)
+			reverse_array(perm, n);
+	}
+	return 0;
+}
+
+int sort_cstr(const char **arr, size_t n, int flags) {
+	return cstr_sort_impl(arr, NULL, n, flags);
+}
+
+int sort_cstr_perm(const char *const *arr, size_t n, uint32_t *perm, int flags) {
+	assert(n <= UINT32_MAX);
+	const char **strs = malloc(n * sizeof(*strs));
+	if (!strs && n > 0)
+		return -1;
+	for (size_t i = 0 ; i < n ; ++i) {
+		strs[i] = arr[i];
+		perm[i] = i;
+	}
+	int res = cstr_sort_impl(strs, perm, n, flags);
+	free(strs);
+	return res;
+}
+
+struct psort_team {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;		// A new job, or quit.
+	pthread_cond_t done;		// The last task of the job finished.
+	void (*fn)(void *ctx, int t);
+	void *ctx;
+	int tasks;
+	int next;			// Next task of the job to hand out.
+	int finished;
+	unsigned job;			// Counts jobs, so the workers can tell a new one from a spurious wakeup.
+	int quit;
+	int workers;
+	pthread_t thread[];
+};
+
+// Run tasks of the current job until there are none left. Called, and returns, with the lock held.
+static void psort_team_work(struct psort_team *team) {
+	while (team->next < team->tasks) {
+		int t = team->next++;
+		pthread_mutex_unlock(&team->lock);
+		team->fn(team->ctx, t);
+		pthread_mutex_lock(&team->lock);
+		if (++team->finished == team->tasks)
+			pthread_cond_signal(&team->done);
+	}
+}
+
+static void *psort_team_main(void *arg) {
+	struct psort_team *team = arg;
+	unsigned seen = 0;
+
+	pthread_mutex_lock(&team->lock);
+	while (1) {
+		while (!team->quit && team->job == seen)
+			pthread_cond_wait(&team->wake, &team->lock);
+		if (team->quit)
+			break;
+		seen = team->job;
+		psort_team_work(team);
+	}
+	pthread_mutex_unlock(&team->lock);
+	return NULL;
+}
+
+struct psort_team *psort_team_start(int threads) {
+	if (threads < 2)
+		return NULL;
+	struct psort_team *team = calloc(1, sizeof(*team) + (threads - 1) * sizeof(pthread_t));
+	if (!team)
+		return NULL;
+	pthread_mutex_init(&team->lock, NULL);
+	pthread_cond_init(&team->wake, NULL);
+	pthread_cond_init(&team->done, NULL);
+	// Tasks are handed out on demand, so fewer workers than asked for still run them all.
+	while (team->workers < threads - 1 && pthread_create(&team->thread[team->workers], NULL, psort_team_main, team) == 0)
+		++team->workers;
+	if (team->workers == 0) {
+		psort_team_stop(team);
+		return NULL;
+	}
+	return team;
+}
+
+void psort_team_run(struct psort_team *team, void (*fn)(void *ctx, int t), void *ctx, int tasks) {
+	if (!team) {
+		for (int t = 0 ; t < tasks ; ++t)
+			fn(ctx, t);
+		return;
+	}
+	pthread_mutex_lock(&team->lock);
+	team->fn = fn;
+	team->ctx = ctx;
+	team->tasks = tasks;
+	team->next = 0;
+	team->finished = 0;
+	++team->job;
+	pthread_cond_broadcast(&team->wake);
+	psort_team_work(team);
+	while (team->finished < team->tasks)
+		pthread_cond_wait(&team->done, &team->lock);
+	pthread_mutex_unlock(&team->lock);
+}
+
+void psort_team_stop(struct psort_team *team) {
+	if (!team)
+		return;
+	pthread_mutex_lock(&team->lock);
+	team->quit = 1;
+	pthread_cond_broadcast(&team->wake);
+	pthread_mutex_unlock(&team->lock);
+	for (int w = 0 ; w < team->workers ; ++w)
+		pthread_join(team->thread[w], NULL);
+	pthread_cond_destroy(&team->done);
+	pthread_cond_destroy(&team->wake);
+	pthread_mutex_destroy(&team->lock);
+	free(team);
+}
+
+// Number of threads to use for n elements, keeping at least cutoff elements per thread.
+int psort_num_threads(int threads, size_t n, size_t cutoff) {
+	if (threads <= 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > PSORT_MAX_THREADS ? PSORT_MAX_THREADS : cpus > 0 ? (int)cpus : 1;
+	}
+	size_t max_threads = n / (cutoff ? cutoff : PSORT_CUTOFF);
+	if ((size_t)threads > max_threads)
+		threads = max_threads > 0 ? (int)max_threads : 1;
+	return threads;
+}
+
+#ifdef EUTILS_X86_SIMD
+// Compare-exchange each lane of v with the lane 'perm' moves into it. Lanes set in 'hi' keep the max.
+#define SORT_NET_CMPEX(v, perm, hi, MIN, MAX) do { \
+	__m256i p_ = (perm); \
+	v = _mm256_blend_epi32(MIN(v, p_), MAX(v, p_), hi); \
+} while (0)
+
+#define SORT_NET_REV(v) _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))
+#define SORT_NET_PAIRS(v) _mm256_shuffle_epi32(v, 0xB1)
+#define SORT_NET_DIST2(v) _mm256_shuffle_epi32(v, 0x4E)
+#define SORT_NET_MIRROR4(v) _mm256_shuffle_epi32(v, 0x1B)
+#define SORT_NET_DIST4(v) _mm256_permute4x64_epi64(v, 0x4E)
+
+// Bitonic sort of a single register, with every comparator ascending.
+#define SORT_NET_SORT8(v, MIN, MAX) do { \
+	SORT_NET_CMPEX(v, SORT_NET_PAIRS(v), 0xAA, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_MIRROR4(v), 0xCC, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_PAIRS(v), 0xAA, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_REV(v), 0xF0, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_DIST2(v), 0xCC, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_PAIRS(v), 0xAA, MIN, MAX); \
+} while (0)
+
+// Sort a bitonic register.
+#define SORT_NET_CLEAN8(v, MIN, MAX) do { \
+	SORT_NET_CMPEX(v, SORT_NET_DIST4(v), 0xF0, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_DIST2(v), 0xCC, MIN, MAX); \
+	SORT_NET_CMPEX(v, SORT_NET_PAIRS(v), 0xAA, MIN, MAX); \
+} while (0)
+
+// Merge sorted a and b into a sorted pair a:b.
+#define SORT_NET_MERGE16(a, b, MIN, MAX) do { \
+	__m256i r_ = SORT_NET_REV(b); \
+	b = MAX(a, r_); \
+	a = MIN(a, r_); \
+	SORT_NET_CLEAN8(a, MIN, MAX); \
+	SORT_NET_CLEAN8(b, MIN, MAX); \
+} while (0)
+
+#define GEN_SORT_NET_AVX2(sfx, type, MIN, MAX) \
+EUTILS_TARGET_AVX2 static void sort_net_avx2_##sfx(type *buf, size_t size) { \
+	__m256i *v = (__m256i*)buf; \
+	__m256i r0 = _mm256_loadu_si256(v); \
+	SORT_NET_SORT8(r0, MIN, MAX); \
+	if (size == 8) { \
+		_mm256_storeu_si256(v, r0); \
+		return; \
+	} \
+	__m256i r1 = _mm256_loadu_si256(v + 1); \
+	SORT_NET_SORT8(r1, MIN, MAX); \
+	SORT_NET_MERGE16(r0, r1, MIN, MAX); \
+	if (size == 16) { \
+		_mm256_storeu_si256(v, r0); \
+		_mm256_storeu_si256(v + 1, r1); \
+		return; \
+	} \
+	__m256i r2 = _mm256_loadu_si256(v + 2); \
+	__m256i r3 = _mm256_loadu_si256(v + 3); \
+	SORT_NET_SORT8(r2, MIN, MAX); \
+	SORT_NET_SORT8(r3, MIN, MAX); \
+	SORT_NET_MERGE16(r2, r3, MIN, MAX); \
+	/* r0:r1 followed by r2:r3 reversed is bitonic, so half-clean it */ \
+	__m256i t2 = SORT_NET_REV(r3); \
+	__m256i t3 = SORT_NET_REV(r2); \
+	r2 = MAX(r0, t2); \
+	r0 = MIN(r0, t2); \
+	r3 = MAX(r1, t3); \
+	r1 = MIN(r1, t3); \
+	t2 = MIN(r0, r1); \
+	r1 = MAX(r0, r1); \
+	r0 = t2; \
+	t3 = MIN(r2, r3); \
+	r3 = MAX(r2, r3); \
+	r2 = t3; \
+	SORT_NET_CLEAN8(r0, MIN, MAX); \
+	SORT_NET_CLEAN8(r1, MIN, MAX); \
+	SORT_NET_CLEAN8(r2, MIN, MAX); \
+	SORT_NET_CLEAN8(r3, MIN, MAX); \
+	_mm256_storeu_si256(v, r0); \
+	_mm256_storeu_si256(v + 1, r1); \
+	_mm256_storeu_si256(v + 2, r2); \
+	_mm256_storeu_si256(v + 3, r3); \
+}
+
+#define SORT_NET_MIN_F32(a, b) _mm256_castps_si256(_mm256_min_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)))
+#define SORT_NET_MAX_F32(a, b) _mm256_castps_si256(_mm256_max_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)))
+
+GEN_SORT_NET_AVX2(i32, int32_t, _mm256_min_epi32, _mm256_max_epi32)
+GEN_SORT_NET_AVX2(u32, uint32_t, _mm256_min_epu32, _mm256_max_epu32)
+GEN_SORT_NET_AVX2(f32, float, SORT_NET_MIN_F32, SORT_NET_MAX_F32)
+#endif
+
+// The same network as the AVX2 path, one comparator at a time. size must be a power of two.
+#define GEN_SORT_NET(sfx, type) \
+static inline void sort_net_cmpex_##sfx(type *a, type *b) { \
+	type lo = *a < *b ? *a : *b; \
+	type hi = *a < *b ? *b : *a; \
+	*a = lo; \
+	*b = hi; \
+} \
+\
+static void sort_net_scalar_##sfx(type *buf, size_t size) { \
+	for (size_t k = 2 ; k <= size ; k *= 2) { \
+		for (size_t b = 0 ; b < size ; b += k) { \
+			for (size_t i = 0 ; i < k / 2 ; ++i) \
+				sort_net_cmpex_##sfx(&buf[b + i], &buf[b + k - 1 - i]); \
+		} \
+		for (size_t d = k / 4 ; d > 0 ; d /= 2) { \
+			for (size_t b = 0 ; b < size ; b += 2 * d) { \
+				for (size_t i = 0 ; i < d ; ++i) \
+					sort_net_cmpex_##sfx(&buf[b + i], &buf[b + i + d]); \
+			} \
+		} \
+	} \
+}
+
+GEN_SORT_NET(i32, int32_t)
+GEN_SORT_NET(u32, uint32_t)
+GEN_SORT_NET(f32, float)
+
+#ifdef EUTILS_X86_SIMD
+#define SORT_NET_DISPATCH(sfx, buf, size) \
+	(cpu_level() >= CPU_AVX2 ? sort_net_avx2_##sfx(buf, size) : sort_net_scalar_##sfx(buf, size))
+#else
+#define SORT_NET_DISPATCH(sfx, buf, size) sort_net_scalar_##sfx(buf, size)
+#endif
+
+#define GEN_SORT_SMALL(sfx, type, pad) \
+GEN_SORT(sort_large_##sfx, type, SORT_ARRAY_CMP_GT) \
+\
+void sort_small_##sfx(type *arr, size_t n) { \
+	if (n > SORT_NET_MAX) { \
+		sort_large_##sfx(arr, n); \
+		return; \
+	} \
+	if (n < 2) \
+		return; \
+	type buf[SORT_NET_MAX]; \
+	size_t size = n <= 8 ? 8 : n <= 16 ? 16 : 32; \
+	memcpy(buf, arr, n * sizeof(*arr)); \
+	for (size_t i = n ; i < size ; ++i) \
+		buf[i] = pad; \
+	SORT_NET_DISPATCH(sfx, buf, size); \
+	memcpy(arr, buf, n * sizeof(*arr)); \
+}
+
+GEN_SORT_SMALL(i32, int32_t, INT32_MAX)
+GEN_SORT_SMALL(u32, uint32_t, UINT32_MAX)
+GEN_SORT_SMALL(f32, float, INFINITY)
 #endif
 
 #ifdef __cplusplus
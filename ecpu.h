@@ -0,0 +1,84 @@
+#pragma once
+/*
+	Runtime CPU Feature Dispatch
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+
+	The SIMD paths of the other headers are compiled for their instruction set with target
+	attributes, whatever -march is, and chosen at runtime by comparing against cpu_level().
+	This way one binary runs on any x86-64, and uses SSE4.2, AVX2 or AVX-512 where available.
+
+	The level is detected once. Setting the environment variable EUTILS_CPU to 'baseline',
+	'sse42', 'avx2' or 'avx512' lowers it, so every path can be exercised on one machine.
+
+	Define EUTILS_NO_SIMD to compile only the portable paths.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+enum cpu_level {
+	CPU_BASELINE,	// Portable C, plus whatever -march allows the compiler.
+	CPU_SSE42,	// SSE4.2 and PCLMUL.
+	CPU_AVX2,
+	CPU_AVX512,	// F, BW and VL.
+	CPU_LEVELS
+};
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(EUTILS_NO_SIMD)
+#define EUTILS_X86_SIMD
+#define EUTILS_TARGET_SSE42 __attribute__((target("sse4.2,pclmul")))
+#define EUTILS_TARGET_AVX2 __attribute__((target("avx2")))
+#define EUTILS_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw,avx512vl")))
+#endif
+
+static inline const char *cpu_level_name(int level) {
+	static const char *const names[CPU_LEVELS] = { "baseline", "sse42", "avx2", "avx512" };
+	return level >= 0 && level < CPU_LEVELS ? names[level] : "unknown";
+}
+
+// Returns the highest level supported by the CPU and OS, lowered to EUTILS_CPU if that's set.
+// Kept out of line, so the callers of cpu_level() don't pay for it on every call.
+__attribute__((cold, noinline, unused)) static int cpu_detect_level(void) {
+	int level = CPU_BASELINE;
+#ifdef EUTILS_X86_SIMD
+	__builtin_cpu_init();
+	// These also check that the OS saves the wider registers.
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul")) {
+		level = CPU_SSE42;
+		if (__builtin_cpu_supports("avx2")) {
+			level = CPU_AVX2;
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+				level = CPU_AVX512;
+		}
+	}
+#endif
+	const char *env = getenv("EUTILS_CPU");
+	if (env) {
+		for (int i = 0 ; i < level ; ++i) {
+			if (strcmp(env, cpu_level_name(i)) == 0)
+				return i;
+		}
+	}
+	return level;
+}
+
+// Cached cpu_detect_level(). Each translation unit keeps its own copy, which is one int.
+static inline int cpu_level(void) {
+	static _Atomic int level = -1;
+	int l = atomic_load_explicit(&level, memory_order_relaxed);
+	if (l < 0) {
+		l = cpu_detect_level();
+		atomic_store_explicit(&level, l, memory_order_relaxed);
+	}
+	return l;
+}
+
+#ifdef __cplusplus
+}
+#endif
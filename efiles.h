@@ -0,0 +1,567 @@
+#pragma once
+/*
+	Batched File Loading
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+
+	Requires POSIX threads (link with -pthread) and _GNU_SOURCE; without the latter
+	only the thread pool backend is available, and _XOPEN_SOURCE >= 500 is needed instead.
+	The implementation uses read_entire_fd() from estrings.h.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+struct file_blob {
+	char *data;	// Zero-terminated contents, NULL on error.
+	size_t len;
+	int err;	// Zero, or an errno value on error.
+	void *alloc;	// Internal: allocation released by read_files_free().
+};
+
+enum read_files_flags {
+	READFILES_SLAB = 1,		// Allocate the buffers of all regular files from one contiguous block.
+	READFILES_NO_URING = 2,		// Use the thread pool even when io_uring is available.
+};
+
+// Number of threads used by the fallback thread pool, including the calling thread.
+#ifndef READFILES_THREADS
+#define READFILES_THREADS 8
+#endif
+
+size_t read_files(const char **names, size_t n, struct file_blob *out, int flags);
+void read_files_free(struct file_blob *out, size_t n);
+
+#ifdef EUTILS_IMPLEMENTATION
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "estrings.h"
+
+#if defined(__linux__) && defined(_GNU_SOURCE) && !defined(EUTILS_NO_URING)
+#if __has_include(<linux/io_uring.h>)
+#define EFILES_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+struct rf_file {
+	int fd;
+	int stream;	// Size unknown, read with read_entire_fd().
+	int in_slab;
+	int opened;	// Open has been attempted.
+	int busy;	// Operation in flight.
+	size_t size;
+	size_t done;
+};
+
+struct rf_state {
+	const char **names;
+	struct file_blob *out;
+	struct rf_file *files;
+	size_t n;
+	atomic_size_t next;
+	void (*fn)(struct rf_state *st, size_t i);
+};
+
+static void rf_fail(struct rf_state *st, size_t i, int err) {
+	struct file_blob *blob = &st->out[i];
+	// Slab space is simply left unused, and the owner of the slab keeps it.
+	if (!st->files[i].in_slab) {
+		free(blob->alloc);
+		blob->alloc = NULL;
+	}
+	blob->data = NULL;
+	blob->len = 0;
+	blob->err = err;
+}
+
+// Determine how to read an opened file.
+static void rf_size(struct rf_state *st, size_t i) {
+	struct rf_file *f = &st->files[i];
+	struct stat sb;
+
+	if (fstat(f->fd, &sb) != 0) {
+		rf_fail(st, i, errno);
+	} else if ((uintmax_t)sb.st_size >= SIZE_MAX) {
+		rf_fail(st, i, EFBIG);
+	} else if (!S_ISREG(sb.st_mode) || sb.st_size == 0) {
+		// Zero means unknown, procfs and sysfs report that.
+		f->stream = 1;
+	} else {
+		f->size = sb.st_size;
+	}
+}
+
+static void rf_open_one(struct rf_state *st, size_t i) {
+	st->files[i].fd = open(st->names[i], O_RDONLY);
+	if (st->files[i].fd < 0) {
+		rf_fail(st, i, errno);
+		return;
+	}
+	rf_size(st, i);
+}
+
+static void rf_read_stream(struct rf_state *st, size_t i) {
+	struct file_blob *blob = &st->out[i];
+	int err;
+	blob->data = read_entire_fd(st->files[i].fd, &blob->len, 0, &err);
+	blob->alloc = blob->data;
+	if (!blob->data)
+		rf_fail(st, i, err);
+}
+
+static void rf_read_one(struct rf_state *st, size_t i) {
+	struct rf_file *f = &st->files[i];
+	if (f->fd < 0)
+		return;
+
+	if (f->stream) {
+		rf_read_stream(st, i);
+	} else if (st->out[i].data) {
+		while (f->done < f->size) {
+			ssize_t res = pread(f->fd, st->out[i].data + f->done, f->size - f->done, f->done);
+			if (res < 0) {
+				if (errno == EINTR)
+					continue;
+				rf_fail(st, i, errno);
+				break;
+			}
+			if (res == 0)
+				break;
+			f->done += res;
+		}
+	}
+	close(f->fd);
+	f->fd = -1;
+}
+
+static void *rf_worker(void *arg) {
+	struct rf_state *st = arg;
+	size_t i;
+	while ((i = atomic_fetch_add(&st->next, 1)) < st->n) {
+		st->fn(st, i);
+	}
+	return NULL;
+}
+
+// Run fn for every file, spread over the pool. The calling thread participates.
+static void rf_pool_run(struct rf_state *st, void (*fn)(struct rf_state *st, size_t i)) {
+	pthread_t threads[READFILES_THREADS];
+	size_t num_threads = 0;
+
+	st->fn = fn;
+	atomic_store(&st->next, 0);
+	while (num_threads + 1 < READFILES_THREADS && num_threads + 1 < st->n) {
+		if (pthread_create(&threads[num_threads], NULL, rf_worker, st) != 0)
+			break;
+		++num_threads;
+	}
+	rf_worker(st);
+	for (size_t t = 0 ; t < num_threads ; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+}
+
+// Give every regular file a buffer, either separately or carved from one slab.
+static void rf_allocate(struct rf_state *st, int slab) {
+	size_t total = 0;
+	char *base = NULL;
+
+	if (slab) {
+		for (size_t i = 0 ; i < st->n ; ++i) {
+			const struct rf_file *f = &st->files[i];
+			if (st->out[i].err == 0 && !f->stream && __builtin_add_overflow(total, (f->size + 16) & ~(size_t)15, &total)) {
+				total = SIZE_MAX;
+				break;
+			}
+		}
+		if (total > 0 && total != SIZE_MAX)
+			base = malloc(total);
+	}
+
+	size_t offset = 0;
+	for (size_t i = 0 ; i < st->n ; ++i) {
+		const struct rf_file *f = &st->files[i];
+		struct file_blob *blob = &st->out[i];
+		if (blob->err || f->stream)
+			continue;
+		if (base) {
+			st->files[i].in_slab = 1;
+			blob->data = base + offset;
+			// The first file in the slab owns it, and keeps owning it if its read fails.
+			blob->alloc = offset == 0 ? base : NULL;
+			offset += (f->size + 16) & ~(size_t)15;
+		} else {
+			blob->data = blob->alloc = malloc(f->size + 1);
+			if (!blob->data)
+				rf_fail(st, i, ENOMEM);
+		}
+	}
+}
+
+#ifdef EFILES_URING
+#define RF_RING_ENTRIES 256
+
+struct rf_ring {
+	int fd;
+	unsigned queued;	// Pushed, not yet submitted.
+	unsigned inflight;	// Submitted, not yet completed.
+	unsigned *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size, sqes_size;
+};
+
+static void rf_ring_free(struct rf_ring *r) {
+	if (r->sqes)
+		munmap(r->sqes, r->sqes_size);
+	if (r->cq_ring && r->cq_ring != r->sq_ring)
+		munmap(r->cq_ring, r->cq_ring_size);
+	if (r->sq_ring)
+		munmap(r->sq_ring, r->sq_ring_size);
+	close(r->fd);
+}
+
+static int rf_ring_supports(int fd, const int *ops, size_t num_ops) {
+	size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+	struct io_uring_probe *probe = calloc(1, size);
+	int ok = probe && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+	for (size_t i = 0 ; ok && i < num_ops ; ++i) {
+		ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+	}
+	free(probe);
+	return ok;
+}
+
+// Set up a ring, returns zero on success. Fails if io_uring or the operations we need are unavailable.
+static int rf_ring_init(struct rf_ring *r) {
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	memset(r, 0, sizeof(*r));
+
+	r->fd = syscall(__NR_io_uring_setup, RF_RING_ENTRIES, &p);
+	if (r->fd < 0)
+		return -1;
+
+	const int ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+	if (!rf_ring_supports(r->fd, ops, sizeof(ops)/sizeof(ops[0]))) {
+		close(r->fd);
+		return -1;
+	}
+
+	r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_ring_size > r->sq_ring_size)
+			r->sq_ring_size = r->cq_ring_size;
+		r->cq_ring_size = r->sq_ring_size;
+	}
+
+	r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ring == MAP_FAILED) {
+		r->sq_ring = NULL;
+		rf_ring_free(r);
+		return -1;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ring = r->sq_ring;
+	} else {
+		r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ring == MAP_FAILED) {
+			r->cq_ring = NULL;
+			rf_ring_free(r);
+			return -1;
+		}
+	}
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		r->sqes = NULL;
+		rf_ring_free(r);
+		return -1;
+	}
+
+	char *sq = r->sq_ring;
+	char *cq = r->cq_ring;
+	r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned*)(sq + p.sq_off.array);
+	r->cq_head = (unsigned*)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	return 0;
+}
+
+// Returns the next free entry, cleared. Fill it in, then queue it with rf_ring_push().
+static struct io_uring_sqe *rf_ring_sqe(struct rf_ring *r, uint64_t user_data) {
+	struct io_uring_sqe *sqe = &r->sqes[*r->sq_tail & *r->sq_mask];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = user_data;
+	return sqe;
+}
+
+// Publish the entry from rf_ring_sqe(). The tail is advanced last, so the kernel never sees a partial entry.
+static void rf_ring_push(struct rf_ring *r) {
+	unsigned tail = *r->sq_tail;
+	unsigned idx = tail & *r->sq_mask;
+
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	++r->queued;
+}
+
+// Submit the queued operations and wait for all of them, passing each result to fn.
+static int rf_ring_run(struct rf_ring *r, struct rf_state *st, void (*fn)(struct rf_state *st, size_t i, int res)) {
+	unsigned to_submit = r->queued;
+
+	r->queued = 0;
+	while (to_submit > 0 || r->inflight > 0) {
+		int res = syscall(__NR_io_uring_enter, r->fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		to_submit -= res;
+		r->inflight += res;
+
+		unsigned head = *r->cq_head;
+		unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+		for ( ; head != tail ; ++head, --r->inflight) {
+			const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+			st->files[cqe->user_data].busy = 0;
+			fn(st, cqe->user_data, cqe->res);
+		}
+		__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	}
+	return 0;
+}
+
+// After rf_ring_run() failed, wait for what the kernel already has, which may still use our buffers
+// and descriptors. Entries that were never submitted are dropped with the ring, so on success no file
+// is busy. If this fails too, r->inflight stays non-zero and the busy files may still be in flight.
+static void rf_ring_drain(struct rf_ring *r, struct rf_state *st, void (*fn)(struct rf_state *st, size_t i, int res)) {
+	r->queued = 0;
+	if (rf_ring_run(r, st, fn) == 0) {
+		for (size_t i = 0 ; i < st->n ; ++i)
+			st->files[i].busy = 0;
+	}
+}
+
+// Leak the buffers of reads that may still be in flight, rather than free them under the kernel.
+static void rf_ring_abandon_reads(struct rf_state *st) {
+	int slab_busy = 0;
+	for (size_t i = 0 ; i < st->n ; ++i) {
+		if (st->files[i].busy) {
+			slab_busy |= st->files[i].in_slab;
+			st->out[i].alloc = NULL;
+		}
+	}
+	for (size_t i = 0 ; i < st->n && slab_busy ; ++i) {
+		if (st->files[i].in_slab)
+			st->out[i].alloc = NULL;
+	}
+}
+
+static void rf_on_open(struct rf_state *st, size_t i, int res) {
+	if (res < 0) {
+		rf_fail(st, i, -res);
+	} else {
+		st->files[i].fd = res;
+		rf_size(st, i);
+	}
+}
+
+static void rf_on_read(struct rf_state *st, size_t i, int res) {
+	struct rf_file *f = &st->files[i];
+	if (res < 0) {
+		if (res != -EINTR && res != -EAGAIN)
+			rf_fail(st, i, -res);
+	} else if (res == 0) {
+		f->size = f->done; // file shrunk
+	} else {
+		f->done += res;
+	}
+}
+
+static void rf_on_close(struct rf_state *st, size_t i, int res) {
+	(void)res;
+	st->files[i].fd = -1;
+}
+
+enum rf_op { RF_OPEN, RF_READ, RF_CLOSE };
+
+static int rf_wants(const struct rf_state *st, size_t i, enum rf_op op) {
+	const struct rf_file *f = &st->files[i];
+	switch (op) {
+		case RF_OPEN:
+			return !f->opened;
+		case RF_READ:
+			return f->fd >= 0 && !f->stream && st->out[i].data && f->done < f->size;
+		case RF_CLOSE:
+			return f->fd >= 0;
+	}
+	return 0;
+}
+
+// Run one kind of operation for all files that want it, a ring-full at a time, until none do.
+// Every round makes progress, since each completion opens, closes, reads or fails a file.
+static int rf_ring_phase(struct rf_ring *r, struct rf_state *st, enum rf_op op) {
+	void (*fn)(struct rf_state *st, size_t i, int res) = op == RF_OPEN ? rf_on_open : op == RF_READ ? rf_on_read : rf_on_close;
+
+	while (1) {
+		for (size_t i = 0 ; i < st->n && r->queued < RF_RING_ENTRIES ; ++i) {
+			if (!rf_wants(st, i, op))
+				continue;
+			struct rf_file *f = &st->files[i];
+			struct io_uring_sqe *sqe = rf_ring_sqe(r, i);
+			f->busy = 1;
+			switch (op) {
+				case RF_OPEN:
+					f->opened = 1;
+					sqe->opcode = IORING_OP_OPENAT;
+					sqe->fd = AT_FDCWD;
+					sqe->addr = (uintptr_t)st->names[i];
+					sqe->open_flags = O_RDONLY;
+					break;
+				case RF_READ: {
+					size_t left = f->size - f->done;
+					sqe->opcode = IORING_OP_READ;
+					sqe->fd = f->fd;
+					sqe->addr = (uintptr_t)(st->out[i].data + f->done);
+					sqe->len = left > (1U << 30) ? (1U << 30) : left;
+					sqe->off = f->done;
+					break;
+				}
+				case RF_CLOSE:
+					sqe->opcode = IORING_OP_CLOSE;
+					sqe->fd = f->fd;
+					break;
+			}
+			rf_ring_push(r);
+		}
+		if (r->queued == 0)
+			break;
+		int err = rf_ring_run(r, st, fn);
+		if (err) {
+			rf_ring_drain(r, st, fn);
+			return err;
+		}
+	}
+	return 0;
+}
+#endif
+
+// Load many files at once. Uses io_uring when available, otherwise a pool of READFILES_THREADS threads.
+//
+// Each out[i] receives the zero-terminated contents of names[i], or an errno value in err.
+// Files of unknown size, e.g pipes or procfs files, are read with read_entire_fd().
+// With READFILES_SLAB, regular files share one allocation. Release with read_files_free().
+//
+// Returns number of files that failed to load.
+size_t read_files(const char **names, size_t n, struct file_blob *out, int flags) {
+	struct rf_state st = { .names = names, .out = out, .n = n };
+	size_t failed = 0;
+
+	memset(out, 0, n * sizeof(*out));
+	if (n == 0)
+		return 0;
+
+	st.files = calloc(n, sizeof(*st.files));
+	if (!st.files) {
+		for (size_t i = 0 ; i < n ; ++i) {
+			out[i].err = ENOMEM;
+		}
+		return n;
+	}
+	for (size_t i = 0 ; i < n ; ++i) {
+		st.files[i].fd = -1;
+	}
+
+	int done = 0;
+#ifdef EFILES_URING
+	struct rf_ring ring;
+	if (!(flags & READFILES_NO_URING) && rf_ring_init(&ring) == 0) {
+		enum rf_op phase = RF_OPEN;
+		int err = rf_ring_phase(&ring, &st, phase);
+		if (!err) {
+			rf_allocate(&st, flags & READFILES_SLAB);
+			phase = RF_READ;
+			err = rf_ring_phase(&ring, &st, phase);
+		}
+		for (size_t i = 0 ; i < n && !err ; ++i) {
+			if (st.files[i].fd >= 0 && st.files[i].stream)
+				rf_read_stream(&st, i);
+		}
+		if (!err) {
+			phase = RF_CLOSE;
+			err = rf_ring_phase(&ring, &st, phase);
+		}
+		// The ring failed. rf_ring_phase() drained it, so normally nothing is in flight any more.
+		// If draining failed too, busy files may still be: the buffers of busy reads are leaked,
+		// the descriptors of busy closes are left alone, and a late open leaks its descriptor.
+		if (err && ring.inflight > 0 && phase == RF_READ)
+			rf_ring_abandon_reads(&st);
+		rf_ring_free(&ring);
+		if (err) {
+			// Anything that didn't complete failed with the ring. Open descriptors are closed here,
+			// except those whose close may still be in flight.
+			for (size_t i = 0 ; i < n ; ++i) {
+				const struct rf_file *f = &st.files[i];
+				if (out[i].err == 0 && (f->busy || !out[i].data || (!f->stream && f->done < f->size)))
+					rf_fail(&st, i, err);
+				if (f->fd >= 0 && !(f->busy && phase == RF_CLOSE))
+					close(f->fd);
+			}
+		}
+		done = 1;
+	}
+#endif
+	if (!done) {
+		rf_pool_run(&st, rf_open_one);
+		rf_allocate(&st, flags & READFILES_SLAB);
+		rf_pool_run(&st, rf_read_one);
+	}
+
+	for (size_t i = 0 ; i < n ; ++i) {
+		if (out[i].data && !st.files[i].stream) {
+			out[i].len = st.files[i].done;
+			out[i].data[out[i].len] = 0;
+		}
+		failed += out[i].err != 0;
+	}
+	free(st.files);
+
+	return failed;
+}
+
+void read_files_free(struct file_blob *out, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		free(out[i].alloc);
+		memset(&out[i], 0, sizeof(out[i]));
+	}
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,296 @@
+#pragma once
+/*
+	Checksums and Hashing
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+
+	crc32c() is the CRC-32C (Castagnoli) checksum used by iSCSI, ext4 and others. It uses the
+	SSE4.2 crc32 instruction on x86-64 when cpu_level() from ecpu.h allows, else slicing-by-8 tables.
+
+	hash64() is a fast non-cryptographic hash for hash tables and deduplication, built on
+	128-bit multiply-mixing after wyhash. It's no substitute for a keyed hash such as SipHash
+	where an attacker may choose the input.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Returns the CRC-32C of len bytes of data, continuing from crc, which is zero to start.
+	crc32c(crc32c(0, a, alen), b, blen) is the checksum of a followed by b.
+*/
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+// The portable implementation, with the same results.
+uint32_t crc32c_sw(uint32_t crc, const void *data, size_t len);
+// Returns the CRC-32C of a followed by b, from crc1 of a and crc2 of len2 bytes b, e.g computed in parallel.
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+
+#ifdef EUTILS_IMPLEMENTATION
+#include <stdatomic.h>
+#include <string.h>
+
+#include "ecpu.h"
+#ifdef EUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// The 64-bit crc32 instruction and moves from xmm registers only exist on x86-64.
+#if defined(EUTILS_X86_SIMD) && defined(__x86_64__)
+#define EHASH_CRC32C_SSE42
+#endif
+
+#define CRC32C_POLY 0x82F63B78	// Bit-reflected.
+
+static uint32_t crc32c_table[8][256];
+static _Atomic int crc32c_table_state;	// 0: empty, 1: being built, 2: ready.
+
+// Build the tables on first use. Returns zero if another thread is building them.
+static int crc32c_tables_ready(void) {
+	int state = atomic_load_explicit(&crc32c_table_state, memory_order_acquire);
+	if (state == 2)
+		return 1;
+	if (state != 0 || !atomic_compare_exchange_strong(&crc32c_table_state, &state, 1))
+		return 0;
+	for (uint32_t i = 0 ; i < 256 ; ++i) {
+		uint32_t c = i;
+		for (int k = 0 ; k < 8 ; ++k)
+			c = (c >> 1) ^ (CRC32C_POLY & -(c & 1));
+		crc32c_table[0][i] = c;
+	}
+	for (uint32_t i = 0 ; i < 256 ; ++i) {
+		for (int t = 1 ; t < 8 ; ++t)
+			crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[t - 1][i] & 0xFF];
+	}
+	atomic_store_explicit(&crc32c_table_state, 2, memory_order_release);
+	return 1;
+}
+
+static inline uint64_t hash_read64(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// Updates the raw register, without the pre- and post-inversion.
+static uint32_t crc32c_update_sw(uint32_t c, const uint8_t *p, size_t len) {
+	if (!crc32c_tables_ready()) {
+		while (len--) {
+			c ^= *p++;
+			for (int k = 0 ; k < 8 ; ++k)
+				c = (c >> 1) ^ (CRC32C_POLY & -(c & 1));
+		}
+		return c;
+	}
+	const uint32_t (*t)[256] = crc32c_table;
+	for ( ; len >= 8 ; len -= 8, p += 8) {
+		// Assumes little-endian.
+		uint64_t v = hash_read64(p) ^ c;
+		c = t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^ t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF] ^
+			t[3][(v >> 32) & 0xFF] ^ t[2][(v >> 40) & 0xFF] ^ t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56];
+	}
+	while (len--)
+		c = (c >> 8) ^ t[0][(c ^ *p++) & 0xFF];
+	return c;
+}
+
+#ifdef EHASH_CRC32C_SSE42
+/*
+	The crc32 instruction has a latency of three cycles but a throughput of one, so large
+	inputs are checksummed as three independent streams over adjacent blocks. The streams
+	are merged by multiplying the first two by x^(8*block size) modulo the polynomial with
+	pclmul, where the constants are x^(8*n-33), since the product gains a factor of x and
+	the final crc32 of it another x^32.
+*/
+#define CRC32C_LONG 2048
+#define CRC32C_LONG_K1 0xa51b6135	// x^(8*LONG-33) mod P
+#define CRC32C_LONG_K2 0x82f89c77	// x^(16*LONG-33) mod P
+#define CRC32C_SHORT 128
+#define CRC32C_SHORT_K1 0x0d3b6092
+#define CRC32C_SHORT_K2 0xb9e02b86
+
+EUTILS_TARGET_SSE42 static inline uint64_t crc32c_shift(uint32_t c, uint32_t k) {
+	return _mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_cvtsi32_si128((int)c), _mm_cvtsi32_si128((int)k), 0));
+}
+
+#define CRC32C_3WAY(block, k1, k2) \
+	while (len >= 3 * (block)) { \
+		uint64_t c1 = 0, c2 = 0; \
+		for (size_t i = 0 ; i < (block) ; i += 8) { \
+			c0 = _mm_crc32_u64(c0, hash_read64(p + i)); \
+			c1 = _mm_crc32_u64(c1, hash_read64(p + (block) + i)); \
+			c2 = _mm_crc32_u64(c2, hash_read64(p + 2 * (block) + i)); \
+		} \
+		c0 = _mm_crc32_u64(0, crc32c_shift(c0, k2) ^ crc32c_shift(c1, k1)) ^ c2; \
+		p += 3 * (block); \
+		len -= 3 * (block); \
+	}
+
+EUTILS_TARGET_SSE42 static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t len) {
+	uint64_t c0 = ~crc;
+	CRC32C_3WAY(CRC32C_LONG, CRC32C_LONG_K1, CRC32C_LONG_K2);
+	CRC32C_3WAY(CRC32C_SHORT, CRC32C_SHORT_K1, CRC32C_SHORT_K2);
+	for ( ; len >= 8 ; len -= 8, p += 8)
+		c0 = _mm_crc32_u64(c0, hash_read64(p));
+	uint32_t c32 = c0;
+	while (len--)
+		c32 = _mm_crc32_u8(c32, *p++);
+	return ~c32;
+}
+#undef CRC32C_3WAY
+
+#define CRC32C_BYTE_K 0xbf818109	// x^(8-33) mod P
+
+/*
+	Multiplies c by x^(8*len) modulo the polynomial, by square-and-multiply as crc32c_shift_bytes_sw(),
+	but with one pclmul and crc32 per step. Every factor is kept as x^(8*n-33), which the x^33 of the
+	product cancels, so squaring k keeps it in that form.
+*/
+EUTILS_TARGET_SSE42 static uint32_t crc32c_shift_bytes_sse42(uint32_t c, size_t len) {
+	uint32_t k = CRC32C_BYTE_K;
+	for ( ; len ; len >>= 1) {
+		if (len & 1)
+			c = _mm_crc32_u64(0, crc32c_shift(c, k));
+		k = _mm_crc32_u64(0, crc32c_shift(k, k));
+	}
+	return c;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+#ifdef EHASH_CRC32C_SSE42
+	if (cpu_level() >= CPU_SSE42)
+		return crc32c_sse42(crc, data, len);
+#endif
+	return ~crc32c_update_sw(~crc, data, len);
+}
+
+uint32_t crc32c_sw(uint32_t crc, const void *data, size_t len) {
+	return ~crc32c_update_sw(~crc, data, len);
+}
+
+// Returns a*b modulo the polynomial, both bit-reflected.
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b) {
+	uint32_t m = (uint32_t)1 << 31;
+	uint32_t p = 0;
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = (b >> 1) ^ (CRC32C_POLY & -(b & 1));
+	}
+	return p;
+}
+
+// Multiplies c by x^(8*len) modulo the polynomial.
+static uint32_t crc32c_shift_bytes_sw(uint32_t c, size_t len) {
+	uint32_t xn = (uint32_t)1 << 31;	// x^0
+	uint32_t sq = (uint32_t)1 << 23;	// x^8, one byte.
+	for ( ; len ; len >>= 1) {
+		if (len & 1)
+			xn = crc32c_multmodp(sq, xn);
+		sq = crc32c_multmodp(sq, sq);
+	}
+	return crc32c_multmodp(xn, c);
+}
+
+// The pre- and post-inversions cancel, so this is the same as for the raw register.
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2) {
+#ifdef EHASH_CRC32C_SSE42
+	if (cpu_level() >= CPU_SSE42)
+		return crc32c_shift_bytes_sse42(crc1, len2) ^ crc2;
+#endif
+	return crc32c_shift_bytes_sw(crc1, len2) ^ crc2;
+}
+
+static const uint64_t hash64_secret[4] = {
+	0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static inline void hash64_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	// The same product from four 32x32-bit multiplies, as wyhash does without 128-bit integers.
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t hash64_mix(uint64_t a, uint64_t b) {
+	hash64_mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t hash_read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed) {
+	const uint64_t *s = hash64_secret;
+	const uint8_t *p = data;
+	uint64_t a, b;
+
+	seed ^= hash64_mix(seed ^ s[0], s[1]);
+	if (len <= 16) {
+		if (len >= 4) {
+			// Two overlapping reads from each end cover 4 to 16 bytes without branching on the length.
+			size_t mid = (len >> 3) << 2;
+			a = hash_read32(p) << 32 | hash_read32(p + mid);
+			b = hash_read32(p + len - 4) << 32 | hash_read32(p + len - 4 - mid);
+		} else if (len > 0) {
+			a = (uint64_t)p[0] << 16 | (uint64_t)p[len >> 1] << 8 | p[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		if (i > 48) {
+			// Three independent lanes, for the same reason as crc32c().
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = hash64_mix(hash_read64(p) ^ s[1], hash_read64(p + 8) ^ seed);
+				see1 = hash64_mix(hash_read64(p + 16) ^ s[2], hash_read64(p + 24) ^ see1);
+				see2 = hash64_mix(hash_read64(p + 32) ^ s[3], hash_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = hash64_mix(hash_read64(p) ^ s[1], hash_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = hash_read64(p + i - 16);
+		b = hash_read64(p + i - 8);
+	}
+	a ^= s[1];
+	b ^= seed;
+	hash64_mum(&a, &b);
+	return hash64_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
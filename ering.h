@@ -0,0 +1,231 @@
+#pragma once
+/*
+	Single-Producer Single-Consumer Ring Buffer
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+
+	The buffer is mapped twice back-to-back using memfd_create(), so every read or write
+	window up to the capacity is contiguous in memory, with no wrap-around to handle.
+	This needs Linux and _GNU_SOURCE. Otherwise, or if the mapping fails, windows that
+	would wrap are served from a linear scratch buffer and copied in or out.
+
+	One thread may write and another read concurrently without locking.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+enum ring_flags {
+	RING_NO_MIRROR = 1,	// Use the copying fallback even when the double mapping is available.
+};
+
+struct ring {
+	uint8_t *buf;
+	size_t cap;		// Power of two, and a multiple of the page size when mirrored.
+	int mirrored;
+	uint8_t *wscratch;	// Fallback only: staging for wrapped write windows.
+	uint8_t *rscratch;	// Fallback only: copy of wrapped read windows.
+	int wpending;		// Fallback only: the current write window is wscratch.
+	// Free-running byte counts, on separate cache lines for the two threads.
+	_Alignas(64) _Atomic size_t head;	// Written by the producer.
+	_Alignas(64) _Atomic size_t tail;	// Written by the consumer.
+};
+
+/*
+	Initialize a ring of at least min_capacity bytes, rounded up to a power of two.
+
+	Returns 0 on success, or -1 on error with errno set.
+*/
+int ring_init(struct ring *r, size_t min_capacity, int flags);
+void ring_free(struct ring *r);
+
+/*
+	Producer side. Returns a contiguous window of *avail free bytes to write into,
+	which is published with ring_write_commit() of up to *avail bytes.
+*/
+void *ring_write_begin(struct ring *r, size_t *avail);
+void ring_write_commit(struct ring *r, size_t n);
+
+/*
+	Consumer side. Returns a contiguous window of the *avail readable bytes,
+	which are released with ring_read_commit() of up to *avail bytes.
+*/
+const void *ring_read_begin(struct ring *r, size_t *avail);
+void ring_read_commit(struct ring *r, size_t n);
+
+// Copy up to len bytes in or out of the ring. Returns the number of bytes copied.
+size_t ring_write(struct ring *r, const void *src, size_t len);
+size_t ring_read(struct ring *r, void *dest, size_t len);
+
+#ifdef EUTILS_IMPLEMENTATION
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__linux__) && defined(_GNU_SOURCE) && !defined(EUTILS_NO_MEMFD)
+#define ERING_MEMFD
+#endif
+
+#ifdef ERING_MEMFD
+// Map the same pages at buf and buf + cap. Returns NULL on failure.
+static uint8_t *ring_map_mirror(size_t cap) {
+	int fd = memfd_create("ring", MFD_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	uint8_t *base = NULL;
+	if (ftruncate(fd, cap) == 0) {
+		// Reserve the address range first, so both halves can be placed with MAP_FIXED.
+		base = mmap(NULL, 2 * cap, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED) {
+			base = NULL;
+		} else if (mmap(base, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+			mmap(base + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(base, 2 * cap);
+			base = NULL;
+		}
+	}
+	close(fd);
+	return base;
+}
+#endif
+
+int ring_init(struct ring *r, size_t min_capacity, int flags) {
+	memset(r, 0, sizeof(*r));
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+
+	size_t cap = 1;
+	while (cap < min_capacity) {
+		if (cap > SIZE_MAX / 4) {
+			errno = EINVAL;
+			return -1;
+		}
+		cap <<= 1;
+	}
+
+#ifdef ERING_MEMFD
+	if (!(flags & RING_NO_MIRROR)) {
+		long page = sysconf(_SC_PAGESIZE);
+		size_t mcap = cap;
+		while (page > 0 && mcap < (size_t)page)
+			mcap <<= 1;
+		r->buf = ring_map_mirror(mcap);
+		if (r->buf) {
+			r->cap = mcap;
+			r->mirrored = 1;
+			return 0;
+		}
+	}
+#else
+	(void)flags;
+#endif
+
+	r->cap = cap;
+	r->buf = malloc(cap);
+	r->wscratch = malloc(cap);
+	r->rscratch = malloc(cap);
+	if (!r->buf || !r->wscratch || !r->rscratch) {
+		ring_free(r);
+		errno = ENOMEM;
+		return -1;
+	}
+	return 0;
+}
+
+void ring_free(struct ring *r) {
+	if (r->mirrored) {
+		munmap(r->buf, 2 * r->cap);
+	} else {
+		free(r->buf);
+		free(r->wscratch);
+		free(r->rscratch);
+	}
+	memset(r, 0, sizeof(*r));
+}
+
+void *ring_write_begin(struct ring *r, size_t *avail) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	size_t off = head & (r->cap - 1);
+	*avail = r->cap - (head - tail);
+	r->wpending = !r->mirrored && off + *avail > r->cap;
+	return r->wpending ? r->wscratch : r->buf + off;
+}
+
+void ring_write_commit(struct ring *r, size_t n) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	assert(n <= r->cap - (head - atomic_load_explicit(&r->tail, memory_order_relaxed)));
+	if (r->wpending) {
+		size_t off = head & (r->cap - 1);
+		size_t first = n < r->cap - off ? n : r->cap - off;
+		memcpy(r->buf + off, r->wscratch, first);
+		memcpy(r->buf, r->wscratch + first, n - first);
+		r->wpending = 0;
+	}
+	atomic_store_explicit(&r->head, head + n, memory_order_release);
+}
+
+const void *ring_read_begin(struct ring *r, size_t *avail) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+	size_t off = tail & (r->cap - 1);
+	*avail = head - tail;
+	if (r->mirrored || off + *avail <= r->cap)
+		return r->buf + off;
+	size_t first = r->cap - off;
+	memcpy(r->rscratch, r->buf + off, first);
+	memcpy(r->rscratch + first, r->buf, *avail - first);
+	return r->rscratch;
+}
+
+void ring_read_commit(struct ring *r, size_t n) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	assert(n <= atomic_load_explicit(&r->head, memory_order_relaxed) - tail);
+	atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+}
+
+// The copying calls handle the wrap themselves, so the fallback needs no scratch round-trip.
+size_t ring_write(struct ring *r, const void *src, size_t len) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	size_t n = r->cap - (head - tail);
+	if (n > len)
+		n = len;
+	if (n == 0)
+		return 0;
+	size_t off = head & (r->cap - 1);
+	size_t first = (r->mirrored || n < r->cap - off) ? n : r->cap - off;
+	memcpy(r->buf + off, src, first);
+	memcpy(r->buf, (const uint8_t*)src + first, n - first);
+	atomic_store_explicit(&r->head, head + n, memory_order_release);
+	return n;
+}
+
+size_t ring_read(struct ring *r, void *dest, size_t len) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+	size_t n = head - tail;
+	if (n > len)
+		n = len;
+	if (n == 0)
+		return 0;
+	size_t off = tail & (r->cap - 1);
+	size_t first = (r->mirrored || n < r->cap - off) ? n : r->cap - off;
+	memcpy(dest, r->buf + off, first);
+	memcpy((uint8_t*)dest + first, r->buf, n - first);
+	atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+	return n;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,10 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "earena.h"
 
 enum escape_err {
 	NO_ERROR,
@@ -21,44 +25,670 @@ enum escape_err {
 	ESC_ERROR_DEC,
 };
 
-void fprint_hex(FILE *stream, const uint8_t *data, size_t len, int width, const char *indent, int show_offset);
+// Flags for fprint_hex(). HEX_OFFSET has the value of the old 'show_offset' boolean.
+enum fprint_hex_flags {
+	HEX_OFFSET = 1,
+	HEX_ASCII = 2,
+};
+
+size_t hex_encode(const uint8_t *data, size_t len, char *dest);
+
+void fprint_hex(FILE *stream, const uint8_t *data, size_t len, int width, const char *indent, int flags);
+
+size_t hex_decode(const char *in, size_t len, uint8_t *out, int *err);
+size_t hex_decode_dump(const char *in, size_t len, uint8_t *out, int *err, int flags);
 
 size_t expand_escapes(const char *input, size_t slen, char *dest, size_t dlen, int *err);
 
+// State for expanding escape codes from a stream of chunks. Initialize with escape_stream_init().
+struct escape_stream {
+	size_t offset; // Stream position of the next input byte, or of the error.
+	int err;
+	unsigned pending_len;
+	char pending[4];
+};
+
+void escape_stream_init(struct escape_stream *es);
+size_t escape_stream_feed(struct escape_stream *es, const char *input, size_t slen, size_t *consumed, char *dest, size_t dlen, int *err);
+size_t escape_stream_finish(struct escape_stream *es, char *dest, size_t dlen, int *err);
+
+size_t escape_string(const char *input, size_t slen, char *dest, size_t dlen);
+
 size_t buf_printf(char *buf, size_t bufsize, size_t *wp, int *truncated, const char *format, ...);
 
+// Growable string builder. The string is always zero-terminated, but buf is NULL until the first append.
+// Initialize with strbuf_init() to grow on the heap, or strbuf_init_fixed() to write into
+// a caller-provided buffer, in which case output is truncated like buf_printf().
+struct strbuf {
+	char *buf;
+	size_t len;
+	size_t cap;
+	int fixed;
+	int truncated;
+};
+
+void strbuf_init(struct strbuf *sb);
+void strbuf_init_fixed(struct strbuf *sb, char *buf, size_t bufsize);
+void strbuf_free(struct strbuf *sb);
+void strbuf_reset(struct strbuf *sb);
+int strbuf_reserve(struct strbuf *sb, size_t n);
+size_t strbuf_append(struct strbuf *sb, const char *src, size_t n);
+size_t strbuf_append_str(struct strbuf *sb, const char *str);
+size_t strbuf_append_char(struct strbuf *sb, char c);
+size_t strbuf_append_u64(struct strbuf *sb, uint64_t v);
+size_t strbuf_append_i64(struct strbuf *sb, int64_t v);
+size_t strbuf_append_hex(struct strbuf *sb, uint64_t v);
+size_t strbuf_printf(struct strbuf *sb, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Flags for read_entire_file_ex(). These are hints, and are ignored where unsupported.
+enum read_file_flags {
+	READFILE_SEQUENTIAL = 1,	// posix_fadvise(POSIX_FADV_SEQUENTIAL), i.e larger readahead.
+	READFILE_WILLNEED = 2,		// posix_fadvise(POSIX_FADV_WILLNEED), start reading in the whole file now.
+};
+
 char *read_entire_file(const char *filename, size_t *len);
+char *read_entire_file_ex(const char *filename, size_t *len, int flags, int *err);
+char *read_entire_fd(int fd, size_t *len, int flags, int *err);
+
+// As above, but the buffer is allocated from an arena, see earena.h.
+char *read_entire_file_arena(struct arena *a, const char *filename, size_t *len, int flags, int *err);
+char *read_entire_fd_arena(struct arena *a, int fd, size_t *len, int flags, int *err);
+
+// Flags for map_entire_file(). These are hints, and are ignored where unsupported.
+enum file_map_flags {
+	FILEMAP_SEQUENTIAL = 1,	// Expect sequential access, i.e aggressive readahead.
+	FILEMAP_WILLNEED = 2,	// Start reading in the whole file now.
+	FILEMAP_POPULATE = 4,	// Populate the page tables up front (MAP_POPULATE).
+	FILEMAP_HUGEPAGE = 8,	// Ask for transparent huge pages (MADV_HUGEPAGE).
+};
+
+struct file_map {
+	const char *data;
+	size_t len;
+	size_t maplen; // Non-zero if data is mapped, zero if it was read into a heap buffer.
+};
+
+const char *map_entire_file(const char *filename, struct file_map *fm, int flags, int *err);
+void unmap_file(struct file_map *fm);
+
+// Flags for the record iterators.
+enum record_flags {
+	RECORD_CRLF = 1,	// Strip one '\r' from the end of each record.
+};
+
+// A view of one record, excluding the delimiter. Not zero-terminated.
+struct record {
+	const char *ptr;
+	size_t len;
+};
+
+// Iterator over the records in a buffer. Initialize with record_iter_init().
+struct record_iter {
+	const char *data;
+	size_t len;
+	size_t pos;		// Start of the next record.
+	size_t next_block;	// Offset of the next block to scan for delimiters.
+	uint64_t mask;		// Unconsumed delimiters in the block before next_block.
+	char delim;
+	int flags;
+};
+
+void record_iter_init(struct record_iter *it, const char *data, size_t len, char delim, int flags);
+int record_next(struct record_iter *it, struct record *rec);
+
+// Iterator over the records read from a file descriptor, through two alternating buffers.
+// Initialize with record_stream_init(), release with record_stream_free().
+struct record_stream {
+	struct record_iter it;
+	int fd;
+	int eof;
+	int err;
+	int cur;
+	size_t bufsize;
+	char *buf[2];
+	size_t cap[2];
+};
+
+void record_stream_init(struct record_stream *rs, int fd, size_t bufsize, char delim, int flags);
+int record_stream_next(struct record_stream *rs, struct record *rec);
+void record_stream_free(struct record_stream *rs);
+
+// A view of len bytes at ptr. Not necessarily zero-terminated.
+struct strview {
+	const char *ptr;
+	size_t len;
+};
+
+// A view of a string literal, or char array, without its terminator.
+#define STRVIEW(s) ((struct strview){ (s), sizeof(s) - 1 })
+
+static inline struct strview strview_cstr(const char *s) {
+	return (struct strview){ s, strlen(s) };
+}
+
+static inline int strview_eq(struct strview a, struct strview b) {
+	return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+}
+
+// Compares like strcmp(), with a proper prefix ordered first.
+static inline int strview_cmp(struct strview a, struct strview b) {
+	int res = memcmp(a.ptr, b.ptr, a.len < b.len ? a.len : b.len);
+	return res ? res : (a.len > b.len) - (a.len < b.len);
+}
+
+/*
+	String interning table. Each distinct string is stored once, zero-terminated, and strintern()
+	returns the same pointer for equal strings, so they compare equal by pointer, e.g with
+	SORT_ARRAY_CMP_INTERNED_ASC from earrays.h. The strings live until strintern_free().
+
+	An open-addressing hash set of hash64() values and string pointers, kept at most half full,
+	whose strings and tables are appended to an arena. Growing never moves a string nor frees the
+	old table, so one thread may call strintern() while any number call strintern_find() without
+	locking. A find concurrent with the insertion of the same string may miss it. With several
+	interning threads, try strintern_find() first and serialize only the strintern() calls.
+*/
+struct strintern_slot {
+	_Atomic uint64_t hash;
+	_Atomic(const char *) str;	// NULL if empty.
+};
+
+struct strintern_table {
+	size_t mask;
+	struct strintern_slot slots[];
+};
+
+struct strintern {
+	_Atomic(struct strintern_table *) table;
+	size_t count;
+	struct arena arena;
+};
+
+// Initialize for about expected strings. Returns 0 on success, or -1 on error with errno set.
+int strintern_init(struct strintern *si, size_t expected);
+void strintern_free(struct strintern *si);
+// Returns the interned copy of s, adding it if new, or NULL if out of memory.
+const char *strintern(struct strintern *si, struct strview s);
+// Returns the interned copy of s, or NULL if it hasn't been interned.
+const char *strintern_find(struct strintern *si, struct strview s);
+
+// Returns the length of an interned string, without scanning for the terminator.
+static inline size_t strintern_len(const char *interned) {
+	size_t len;
+	memcpy(&len, interned - sizeof(len), sizeof(len));
+	return len;
+}
 
 #ifdef EUTILS_IMPLEMENTATION
 #include <assert.h>
-#include <ctype.h> // for isxdigit()
+#include <ctype.h> // for isdigit()
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ecpu.h"
+#include "ehash.h"
+#ifdef EUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+static const char hex_pairs[513] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
-void fprint_hex(FILE *f, const uint8_t *data, size_t len, int width, const char *indent, int show_offset) {
-	for (size_t i = 0 ; i < len ; ++i) {
-		if (show_offset && (i % width == 0)) fprintf(f, "%08zx: ", i);
-		fprintf(f, "%02x", data[i]);
-		if (i < len -1) {
-			if (indent && *indent && ((i+1) % width == 0)) {
-				fprintf(f, "%s", indent);
-			} else {
-				fprintf(f, " ");
+#ifdef EUTILS_X86_SIMD
+// Encodes whole 32 byte blocks, returns the number of bytes done.
+EUTILS_TARGET_AVX2 static size_t hex_encode_avx2(const uint8_t *data, size_t len, char *dest) {
+	size_t i = 0;
+	const __m256i lut = _mm256_setr_epi8(
+		'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f',
+		'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+	const __m256i lo_mask = _mm256_set1_epi8(0x0f);
+	for ( ; i + 32 <= len ; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), lo_mask));
+		__m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, lo_mask));
+		// unpack works per 128-bit lane, so a = {0..7, 16..23}, b = {8..15, 24..31}
+		__m256i a = _mm256_unpacklo_epi8(hi, lo);
+		__m256i b = _mm256_unpackhi_epi8(hi, lo);
+		_mm256_storeu_si256((__m256i*)(dest + 2*i), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i*)(dest + 2*i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+	return i;
+}
+#endif
+
+// Encode len bytes as lowercase hex into dest, which must have room for 2*len chars.
+// No zero-termination is performed. Returns number of chars written.
+size_t hex_encode(const uint8_t *data, size_t len, char *dest) {
+	size_t i = 0;
+#ifdef EUTILS_X86_SIMD
+	if (cpu_level() >= CPU_AVX2)
+		i = hex_encode_avx2(data, len, dest);
+#endif
+	for ( ; i < len ; ++i) {
+		memcpy(dest + 2*i, &hex_pairs[2*data[i]], 2);
+	}
+	return 2*len;
+}
+
+#define HEXFMT_BUFSIZE 4096
+
+static void hexfmt_flush(FILE *f, char *buf, size_t *wp) {
+	if (*wp)
+		fwrite(buf, 1, *wp, f);
+	*wp = 0;
+}
+
+static void hexfmt_put(FILE *f, char *buf, size_t *wp, const char *src, size_t n) {
+	if (*wp + n > HEXFMT_BUFSIZE) {
+		hexfmt_flush(f, buf, wp);
+		if (n > HEXFMT_BUFSIZE) {
+			fwrite(src, 1, n, f);
+			return;
+		}
+	}
+	memcpy(buf + *wp, src, n);
+	*wp += n;
+}
+
+// Same output as "%08zx: ". Returns number of chars written, at most 18.
+static size_t hexfmt_offset(char *dest, size_t offset) {
+	size_t digits = 8;
+	while (digits < 2*sizeof(offset) && (offset >> (4*digits)) != 0)
+		++digits;
+	for (size_t i = digits ; i > 0 ; --i, offset >>= 4) {
+		dest[i-1] = hex_pairs[2*(offset & 0xf) + 1];
+	}
+	dest[digits] = ':';
+	dest[digits+1] = ' ';
+	return digits + 2;
+}
+
+// Print data as rows of width hex bytes. Rows are separated by indent, or a space if indent is NULL or empty.
+// Output is formatted into a local buffer and handed to stdio in large blocks.
+void fprint_hex(FILE *f, const uint8_t *data, size_t len, int width, const char *indent, int flags) {
+	char buf[HEXFMT_BUFSIZE];
+	size_t wp = 0;
+	size_t indent_len = indent ? strlen(indent) : 0;
+
+	assert(width > 0);
+	size_t w = width;
+
+	for (size_t i = 0 ; i < len ; i += w) {
+		const uint8_t *row = data + i;
+		size_t n = (len - i) < w ? (len - i) : w;
+
+		if (flags & HEX_OFFSET) {
+			if (wp + 18 > HEXFMT_BUFSIZE)
+				hexfmt_flush(f, buf, &wp);
+			wp += hexfmt_offset(buf + wp, i);
+		}
+
+		for (size_t j = 0 ; j < n ; ) {
+			if (wp + 3 > HEXFMT_BUFSIZE)
+				hexfmt_flush(f, buf, &wp);
+			size_t end = j + (HEXFMT_BUFSIZE - wp) / 3;
+			if (end > n)
+				end = n;
+			char *p = buf + wp;
+			for ( ; j < end ; ++j, p += 3) {
+				memcpy(p, &hex_pairs[2*row[j]], 2);
+				p[2] = ' ';
+			}
+			wp = p - buf;
+		}
+		// Drop the space following the last byte of the row; it's only kept as the row separator.
+		int last_row = (i + n == len);
+		if (last_row || (flags & HEX_ASCII) || indent_len)
+			--wp;
+
+		if (flags & HEX_ASCII) {
+			for (size_t j = n ; j < w ; ++j)
+				hexfmt_put(f, buf, &wp, "   ", 3);
+			hexfmt_put(f, buf, &wp, "  |", 3);
+			for (size_t j = 0 ; j < n ; ) {
+				if (wp == HEXFMT_BUFSIZE)
+					hexfmt_flush(f, buf, &wp);
+				size_t end = j + (HEXFMT_BUFSIZE - wp);
+				if (end > n)
+					end = n;
+				char *p = buf + wp;
+				for ( ; j < end ; ++j) {
+					*p++ = (row[j] >= 0x20 && row[j] < 0x7f) ? (char)row[j] : '.';
+				}
+				wp = p - buf;
 			}
+			hexfmt_put(f, buf, &wp, "|", 1);
+			if (!last_row && !indent_len)
+				hexfmt_put(f, buf, &wp, " ", 1);
 		}
+
+		if (!last_row && indent_len)
+			hexfmt_put(f, buf, &wp, indent, indent_len);
 	}
+	hexfmt_flush(f, buf, &wp);
+}
+#undef HEXFMT_BUFSIZE
+
+// Returns the value of hex digit c, or -1 if not a hex digit.
+static inline int hex_digit_value(const char c) {
+	unsigned d = (unsigned char)c - '0';
+	if (d < 10)
+		return d;
+	d = ((unsigned char)c | 0x20) - 'a';
+	if (d < 6)
+		return d + 10;
+	return -1;
 }
 
-static uint8_t nibble(const char c) {
-	// return c + '0' + (((unsigned)(9 - c) >> 4) & 0x27);
-	if (c >= '0' && c <= '9') {
-		return c - '0';
-	} else if (c >= 'a' && c <= 'f') {
-		return 10 + c - 'a';
-	} else if (c >= 'A' && c <= 'F') {
-		return 10 + c - 'A';
+#ifdef EUTILS_X86_SIMD
+// Decodes whole 32 digit blocks from in + i, adding the bytes written to *wp. Returns where it stopped.
+EUTILS_TARGET_AVX2 static size_t hex_decode_avx2(const char *in, size_t len, uint8_t *out, size_t i, size_t *wp) {
+	const __m256i digit_max = _mm256_set1_epi8(9);
+	const __m256i alpha_max = _mm256_set1_epi8(5);
+	const __m256i pair_weights = _mm256_set1_epi16(0x0110); // hi*16 + lo*1
+	for ( ; i + 32 <= len ; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+		__m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+		__m256i a = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+		__m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, digit_max), d);
+		__m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(a, alpha_max), a);
+		if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != 0xFFFFFFFF)
+			break; // let the scalar code find the exact stop position.
+		if (out) {
+			__m256i nibbles = _mm256_blendv_epi8(_mm256_add_epi8(a, _mm256_set1_epi8(10)), d, is_digit);
+			__m256i words = _mm256_maddubs_epi16(nibbles, pair_weights);
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+			_mm_storeu_si128((__m128i*)(out + *wp), _mm256_castsi256_si128(packed));
+		}
+		*wp += 16;
 	}
-	return 0;
+	return i;
+}
+#endif
+
+// Decode hex digit pairs from in until the first pair that isn't valid, or the end.
+// Returns number of bytes decoded, and sets *rp to the position where decoding stopped.
+static size_t hex_decode_run(const char *in, size_t len, uint8_t *out, size_t *rp) {
+	size_t i = *rp;
+	size_t wp = 0;
+#ifdef EUTILS_X86_SIMD
+	if (cpu_level() >= CPU_AVX2)
+		i = hex_decode_avx2(in, len, out, i, &wp);
+#endif
+	for ( ; i + 1 < len ; i += 2) {
+		int hi = hex_digit_value(in[i]);
+		int lo = hex_digit_value(in[i+1]);
+		if ((hi | lo) < 0)
+			break;
+		if (out)
+			out[wp] = (hi << 4) | lo;
+		++wp;
+	}
+	*rp = i;
+	return wp;
+}
+
+// Decode a string of hex digit pairs, e.g. the output of hex_encode(). Upper and lower case are accepted.
+//
+// Returns
+//   If out is NULL, then returns number of bytes that WOULD be written. Otherwise out must have room for len/2 bytes.
+//   On success:
+//   	Returns number of bytes written.
+//   On error:
+//   	Sets err, and returns position of error in input.
+//   	ESC_ERROR_HEX for an invalid character, ESC_ERROR for an unpaired trailing digit.
+size_t hex_decode(const char *in, size_t len, uint8_t *out, int *err) {
+	size_t rp = 0;
+	assert(err != NULL);
+
+	size_t wp = hex_decode_run(in, len, out, &rp);
+	if (rp < len) {
+		if (hex_digit_value(in[rp]) < 0) {
+			*err = ESC_ERROR_HEX;
+		} else if (rp + 1 < len) {
+			*err = ESC_ERROR_HEX;
+			++rp;
+		} else {
+			*err = ESC_ERROR;
+		}
+		return rp;
+	}
+
+	*err = 0;
+	return wp;
+}
+
+static inline int hexdump_is_space(const char c) {
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Decode the output of fprint_hex(), so that dumps round-trip.
+//
+// Whitespace between digit pairs is skipped, which covers the default separator and any whitespace indent.
+// The flags should match those given to fprint_hex(): with HEX_OFFSET, runs of hex digits terminated
+// by ':' are skipped as offsets. With HEX_ASCII, the '|'-delimited column after each row is skipped.
+//
+// Returns as hex_decode().
+size_t hex_decode_dump(const char *in, size_t len, uint8_t *out, int *err, int flags) {
+	size_t rp = 0;
+	size_t wp = 0;
+	size_t row_bytes = 0;
+	assert(err != NULL);
+
+#define RETURN_ERR(err_enum, pos) do { *err = err_enum; return pos; } while (0)
+	while (rp < len) {
+		const char c = in[rp];
+		if (hexdump_is_space(c)) {
+			++rp;
+			continue;
+		}
+
+		if ((flags & HEX_ASCII) && c == '|') {
+			// The column holds exactly one character per byte in the row, and those may include '|'.
+			if (rp + 1 + row_bytes >= len || in[rp + 1 + row_bytes] != '|')
+				RETURN_ERR(ESC_ERROR, rp);
+			rp += row_bytes + 2;
+			row_bytes = 0;
+			continue;
+		}
+
+		size_t run_start = rp;
+		size_t n = hex_decode_run(in, len, out ? out + wp : NULL, &rp);
+		size_t run_end = rp;
+		if (run_end < len && hex_digit_value(in[run_end]) >= 0)
+			++run_end; // odd number of digits, possibly an offset.
+
+		if ((flags & HEX_OFFSET) && run_end < len && in[run_end] == ':' && run_end > run_start) {
+			// Discard the offset; anything written for it will be overwritten.
+			rp = run_end + 1;
+			row_bytes = 0;
+			continue;
+		}
+
+		if (run_end != rp) {
+			// Unpaired digit, report the character following it if that's what broke the pair.
+			if (run_end < len && !hexdump_is_space(in[run_end]) && in[run_end] != '|')
+				RETURN_ERR(ESC_ERROR_HEX, run_end);
+			RETURN_ERR(ESC_ERROR, rp);
+		}
+		if (n == 0)
+			RETURN_ERR(ESC_ERROR_HEX, rp);
+
+		wp += n;
+		row_bytes += n;
+	}
+#undef RETURN_ERR
+
+	*err = 0;
+	return wp;
+}
+
+#ifdef EUTILS_X86_SIMD
+// The vector loops of scan_for_byte() and copy_until_byte(). These return the index of c, or
+// where they stopped before it or the tail, for the scalar loop to continue from.
+EUTILS_TARGET_AVX2 static size_t scan_for_byte_avx2(const char *s, size_t len, char c) {
+	const __m256i needle = _mm256_set1_epi8(c);
+	size_t i = 0;
+	for ( ; i + 32 <= len ; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i;
+}
+
+EUTILS_TARGET_AVX512 static size_t scan_for_byte_avx512(const char *s, size_t len, char c) {
+	const __m512i needle = _mm512_set1_epi8(c);
+	size_t i = 0;
+	for ( ; i + 64 <= len ; i += 64) {
+		uint64_t mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(s + i), needle);
+		if (mask)
+			return i + __builtin_ctzll(mask);
+	}
+	return i;
+}
+
+EUTILS_TARGET_AVX2 static size_t copy_until_byte_avx2(char *dest, const char *src, size_t len, char c) {
+	const __m256i needle = _mm256_set1_epi8(c);
+	size_t i = 0;
+	for ( ; i + 32 <= len ; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+		if (mask) {
+			// Store the whole dwords ahead of c, and leave the last few bytes to the scalar loop.
+			int dwords = __builtin_ctz(mask) >> 2;
+			__m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(dwords), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			_mm256_maskstore_epi32((int*)(dest + i), lanes, v);
+			return i + 4 * dwords;
+		}
+		_mm256_storeu_si256((__m256i*)(dest + i), v);
+	}
+	return i;
+}
+
+EUTILS_TARGET_AVX512 static size_t copy_until_byte_avx512(char *dest, const char *src, size_t len, char c) {
+	const __m512i needle = _mm512_set1_epi8(c);
+	size_t i = 0;
+	for ( ; i + 64 <= len ; i += 64) {
+		__m512i v = _mm512_loadu_si512(src + i);
+		uint64_t mask = _mm512_cmpeq_epi8_mask(v, needle);
+		if (mask) {
+			// Store only the bytes ahead of c.
+			_mm512_mask_storeu_epi8(dest + i, (mask & -mask) - 1, v);
+			return i + __builtin_ctzll(mask);
+		}
+		_mm512_storeu_si512(dest + i, v);
+	}
+	return i;
+}
+#endif
+
+// Returns the index of the first occurrence of c in s, or len if not found.
+static inline size_t scan_for_byte(const char *s, size_t len, char c) {
+	size_t i = 0;
+#ifdef EUTILS_X86_SIMD
+	int level = cpu_level();
+	if (level >= CPU_AVX512)
+		i = scan_for_byte_avx512(s, len, c);
+	else if (level >= CPU_AVX2)
+		i = scan_for_byte_avx2(s, len, c);
+#endif
+	for ( ; i < len ; ++i) {
+		if (s[i] == c)
+			return i;
+	}
+	return len;
+}
+
+// Copy from src to dest until c is found, or len bytes have been copied. Returns number of bytes copied.
+static inline size_t copy_until_byte(char *dest, const char *src, size_t len, char c) {
+	size_t i = 0;
+#ifdef EUTILS_X86_SIMD
+	int level = cpu_level();
+	if (level >= CPU_AVX512)
+		i = copy_until_byte_avx512(dest, src, len, c);
+	else if (level >= CPU_AVX2)
+		i = copy_until_byte_avx2(dest, src, len, c);
+#endif
+	for ( ; i < len && src[i] != c ; ++i) {
+		dest[i] = src[i];
+	}
+	return i;
+}
+
+// Internal: returned by decode_escape() when the sequence may continue past the end of input.
+#define ESC_INCOMPLETE (-1)
+
+// Decode the escape sequence starting with the backslash at in[*rp] into *c, and advance *rp past it.
+// If final is zero, returns ESC_INCOMPLETE when the sequence may continue past len.
+static int decode_escape(const char *in, size_t len, size_t *rp, char *c, int final) {
+	size_t p = *rp + 1;
+
+	// Check if dangling escape
+	if (p >= len)
+		return final ? ESC_ERROR : ESC_INCOMPLETE;
+
+	if (in[p] == 'x') {
+		// HEX escape
+		for (size_t i = p + 1 ; i < p + 3 ; ++i) {
+			if (i >= len)
+				return final ? ESC_ERROR_HEX : ESC_INCOMPLETE;
+			if (hex_digit_value(in[i]) < 0)
+				return ESC_ERROR_HEX;
+		}
+		*c = (hex_digit_value(in[p+1]) << 4) | hex_digit_value(in[p+2]);
+		p += 3;
+	} else if (isdigit(in[p])) {
+		// DECimal escape
+		int decval = in[p++] - '0';
+		for (int i = 0 ; i < 2 ; ++i) {
+			if (p >= len) {
+				if (!final)
+					return ESC_INCOMPLETE;
+				break;
+			}
+			if (!isdigit(in[p]))
+				break;
+			decval *= 10;
+			decval += in[p++] - '0';
+		}
+		if (decval > 255) {
+			return ESC_ERROR_DEC;
+		}
+		*c = decval;
+	} else {
+		// Standard escape character
+		// We don't support \? because that is a trigraphs legacy.
+		switch (in[p++]) {
+			case 'a': *c = '\a'; break;
+			case 'b': *c = '\b'; break;
+			case 'f': *c = '\f'; break;
+			case 'n': *c = '\n'; break;
+			case 'r': *c = '\r'; break;
+			case 't': *c = '\t'; break;
+			case 'v': *c = '\v'; break;
+			case '"': *c = '"';  break;
+			case '\\': *c = '\\';break;
+			default:
+				return ESC_ERROR_CHAR;
+		}
+	}
+
+	*rp = p;
+	return NO_ERROR;
 }
 
 // Expand escape codes. Not compatible with stdlib!
@@ -69,6 +699,8 @@ static uint8_t nibble(const char c) {
 //  - Decimal escapes: \0 - \255
 //  No support of octal.
 //
+// Runs of plain characters between escapes are located with a SIMD scan and copied in bulk.
+//
 // Returns
 //   If dest is NULL, then returns number of bytes that WOULD be written.
 //   On success:
@@ -83,61 +715,25 @@ size_t expand_escapes(const char *input, size_t slen, char *dest, size_t dlen, i
 	assert(err != NULL);
 
 	while (rp < slen && (wp < dlen || dest == NULL)) {
+		// Bulk-copy the run of plain characters up to the next escape.
+		size_t run = slen - rp;
+		if (dest && run > dlen - wp)
+			run = dlen - wp;
+		run = dest ? copy_until_byte(dest + wp, input + rp, run, '\\') : scan_for_byte(input + rp, run, '\\');
+		rp += run;
+		wp += run;
+		if (rp >= slen || (dest && wp >= dlen))
+			break;
+
 		// Use start of scan as return value on error.
 		size_t rp_start = rp;
-		char c = input[rp++];
-		if (c == '\\') {
-			// Check if dangling escape
-			if (rp >= slen)
-				RETURN_ERR(ESC_ERROR);
-
-			if (input[rp] == 'x') {
-				// HEX escape
-				if (rp + 2 < slen && isxdigit(input[rp+1]) && isxdigit(input[rp+2])) {
-					c = (nibble(input[rp+1]) << 4) | nibble(input[rp+2]);
-					rp += 3;
-				} else {
-					RETURN_ERR(ESC_ERROR_HEX);
-				}
-			} else if (isdigit(input[rp])) {
-				// DECimal escape
-				int decval = input[rp++] - '0';
-				if (rp < slen && isdigit(input[rp])) {
-					decval *= 10;
-					decval += input[rp++] - '0';
-				}
-				if (rp < slen && isdigit(input[rp])) {
-					decval *= 10;
-					decval += input[rp++] - '0';
-				}
-				if (decval > 255) {
-					RETURN_ERR(ESC_ERROR_DEC);
-				}
-				c = decval;
-			} else {
-				// Standard escape character
-				// We don't support \? because that is a trigraphs legacy.
-				switch (input[rp++]) {
-					case 'a': c = '\a'; break;
-					case 'b': c = '\b'; break;
-					case 'f': c = '\f'; break;
-					case 'n': c = '\n'; break;
-					case 'r': c = '\r'; break;
-					case 't': c = '\t'; break;
-					case 'v': c = '\v'; break;
-					case '"': c = '"';  break;
-					case '\\': c = '\\';break;
-					default:
-						RETURN_ERR(ESC_ERROR_CHAR);
-				}
-			}
-		}
+		char c;
+		int res = decode_escape(input, slen, &rp, &c, 1);
+		if (res != NO_ERROR)
+			RETURN_ERR(res);
 
-		if (dest && dlen) {
-			if (wp < dlen) {
-				dest[wp] = c;
-			}
-		}
+		if (dest)
+			dest[wp] = c;
 		++wp;
 	}
 	if (err)
@@ -146,11 +742,278 @@ size_t expand_escapes(const char *input, size_t slen, char *dest, size_t dlen, i
 #undef RETURN_ERR
 }
 
+// Returns the letter of the standard escape for c, e.g 'n' for '\n', or 0 if there is none.
+static inline char escape_std_char(const char c) {
+	switch (c) {
+		case '\a': return 'a';
+		case '\b': return 'b';
+		case '\f': return 'f';
+		case '\n': return 'n';
+		case '\r': return 'r';
+		case '\t': return 't';
+		case '\v': return 'v';
+		case '"': return '"';
+		case '\\': return '\\';
+	}
+	return 0;
+}
+
+static inline int escape_needed(const char c) {
+	return (unsigned char)c < 0x20 || (unsigned char)c > 0x7e || c == '"' || c == '\\';
+}
+
+#ifdef EUTILS_X86_SIMD
+// Returns bitmask of the bytes in v that must be escaped.
+EUTILS_TARGET_AVX2 static inline uint32_t escape_needed_mask(__m256i v) {
+	__m256i printable = _mm256_and_si256(
+		_mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(0x20)), v),
+		_mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x7e)), v));
+	__m256i special = _mm256_or_si256(
+		_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+		_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+	return ~(uint32_t)_mm256_movemask_epi8(_mm256_andnot_si256(special, printable));
+}
+
+// Returns bitmask of the bytes in v that have a standard (two character) escape.
+EUTILS_TARGET_AVX2 static inline uint32_t escape_std_mask(__m256i v) {
+	__m256i ctrl = _mm256_sub_epi8(v, _mm256_set1_epi8('\a'));
+	__m256i is_ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, _mm256_set1_epi8('\r' - '\a')), ctrl);
+	__m256i special = _mm256_or_si256(
+		_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+		_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+	return _mm256_movemask_epi8(_mm256_or_si256(is_ctrl, special));
+}
+
+// The vector loop of copy_until_escape(), returning as copy_until_byte_avx2().
+EUTILS_TARGET_AVX2 static size_t copy_until_escape_avx2(char *dest, const char *src, size_t len) {
+	size_t i = 0;
+	for ( ; i + 32 <= len ; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		_mm256_storeu_si256((__m256i*)(dest + i), v);
+		uint32_t mask = escape_needed_mask(v);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i;
+}
+
+// Adds the escaped length of whole 32 byte blocks to *len, returns the number of bytes done.
+EUTILS_TARGET_AVX2 static size_t escape_string_length_avx2(const char *input, size_t slen, size_t *len) {
+	size_t i = 0;
+	for ( ; i + 32 <= slen ; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(input + i));
+		uint32_t mask = escape_needed_mask(v);
+		if (mask) {
+			// One extra byte per escape, and another two for hex escapes.
+			*len += __builtin_popcount(mask) + 2 * __builtin_popcount(mask & ~escape_std_mask(v));
+		}
+	}
+	return i;
+}
+#endif
+
+// Copy from src to dest until a character that must be escaped is found, or len bytes
+// have been copied. Returns number of bytes copied. Whole blocks are stored before they're
+// checked, so this may write past the returned length, but never past len.
+static inline size_t copy_until_escape(char *dest, const char *src, size_t len) {
+	size_t i = 0;
+#ifdef EUTILS_X86_SIMD
+	if (cpu_level() >= CPU_AVX2)
+		i = copy_until_escape_avx2(dest, src, len);
+#endif
+	for ( ; i < len && !escape_needed(src[i]) ; ++i) {
+		dest[i] = src[i];
+	}
+	return i;
+}
+
+static size_t escape_string_length(const char *input, size_t slen) {
+	size_t len = slen;
+	size_t i = 0;
+#ifdef EUTILS_X86_SIMD
+	if (cpu_level() >= CPU_AVX2)
+		i = escape_string_length_avx2(input, slen, &len);
+#endif
+	for ( ; i < slen ; ++i) {
+		if (escape_needed(input[i]))
+			len += escape_std_char(input[i]) ? 1 : 3;
+	}
+	return len;
+}
+
+// Escape a string so that expand_escapes() restores it.
+//
+// Printable ASCII is copied as-is, except for '"' and '\' which are escaped along with the other
+// characters that have standard escapes (\a\b\f\n\r\t\v). Anything else is hex escaped as \xHH.
+//
+// Output is not zero-terminated. If dest is too small, output stops before the first character
+// or escape sequence that doesn't fit. Bytes in dest past the returned length, but within dlen,
+// may be clobbered.
+//
+// Returns
+//   If dest is NULL, then returns number of bytes that WOULD be written.
+//   Otherwise returns number of bytes written.
+size_t escape_string(const char *input, size_t slen, char *dest, size_t dlen) {
+	size_t rp = 0;
+	size_t wp = 0;
+
+	if (!dest)
+		return escape_string_length(input, slen);
+
+	while (rp < slen && wp < dlen) {
+		size_t run = slen - rp;
+		if (run > dlen - wp)
+			run = dlen - wp;
+		run = copy_until_escape(dest + wp, input + rp, run);
+		rp += run;
+		wp += run;
+		if (rp >= slen || wp >= dlen)
+			break;
+
+		const char c = input[rp++];
+		const char e = escape_std_char(c);
+		if (e) {
+			if (dlen - wp < 2)
+				break;
+			dest[wp++] = '\\';
+			dest[wp++] = e;
+		} else {
+			if (dlen - wp < 4)
+				break;
+			dest[wp++] = '\\';
+			dest[wp++] = 'x';
+			memcpy(dest + wp, &hex_pairs[2*(unsigned char)c], 2);
+			wp += 2;
+		}
+	}
+
+	return wp;
+}
+
+void escape_stream_init(struct escape_stream *es) {
+	memset(es, 0, sizeof(*es));
+}
+
+// Expand escape codes from a chunk of a stream, see expand_escapes().
+//
+// An escape sequence that is cut off at the end of the chunk is kept in the stream state, and
+// completed by the next call. Input is consumed until it's exhausted or dest is full; *consumed
+// is set to the number of input bytes used, and the remainder should be fed again.
+//
+// Returns
+//   If dest is NULL, then returns number of bytes that WOULD be written.
+//   On success:
+//   	Returns number of bytes written.
+//   On error:
+//   	Sets err, and returns position of error in the stream. The error is sticky.
+size_t escape_stream_feed(struct escape_stream *es, const char *input, size_t slen, size_t *consumed, char *dest, size_t dlen, int *err) {
+	size_t rp = 0;
+	size_t wp = 0;
+
+#define RETURN_ERR(err_enum, pos) { size_t err_pos = pos; es->err = err_enum; es->offset = err_pos; *err = err_enum; *consumed = rp; return err_pos; } while (0)
+	assert(err != NULL);
+	assert(consumed != NULL);
+
+	if (es->err)
+		RETURN_ERR(es->err, es->offset);
+
+	// Complete the escape carried over from the previous chunk, one character at a time.
+	while (es->pending_len > 0 && rp < slen && (wp < dlen || dest == NULL)) {
+		size_t prp = 0;
+		char c;
+		es->pending[es->pending_len++] = input[rp++];
+		int res = decode_escape(es->pending, es->pending_len, &prp, &c, 0);
+		if (res == ESC_INCOMPLETE)
+			continue;
+		if (res != NO_ERROR)
+			RETURN_ERR(res, es->offset - (es->pending_len - rp));
+
+		// A decimal escape may be terminated by the character after it; give that back.
+		rp -= es->pending_len - prp;
+		es->pending_len = 0;
+		if (dest)
+			dest[wp] = c;
+		++wp;
+	}
+
+	while (es->pending_len == 0 && rp < slen && (wp < dlen || dest == NULL)) {
+		size_t run = slen - rp;
+		if (dest && run > dlen - wp)
+			run = dlen - wp;
+		run = dest ? copy_until_byte(dest + wp, input + rp, run, '\\') : scan_for_byte(input + rp, run, '\\');
+		rp += run;
+		wp += run;
+		if (rp >= slen || (dest && wp >= dlen))
+			break;
+
+		size_t rp_start = rp;
+		char c;
+		int res = decode_escape(input, slen, &rp, &c, 0);
+		if (res == ESC_INCOMPLETE) {
+			// At most three characters, e.g '\x4' or '\25'.
+			assert(slen - rp < sizeof(es->pending));
+			es->pending_len = slen - rp;
+			memcpy(es->pending, input + rp, es->pending_len);
+			rp = slen;
+			break;
+		}
+		if (res != NO_ERROR)
+			RETURN_ERR(res, es->offset + rp_start);
+
+		if (dest)
+			dest[wp] = c;
+		++wp;
+	}
+
+	es->offset += rp;
+	*consumed = rp;
+	*err = 0;
+	return wp;
+#undef RETURN_ERR
+}
+
+// Flush the escape carried over at the end of the stream, if any. dest must have room for one byte.
+//
+// Returns as escape_stream_feed(). A sequence that is still incomplete is an error.
+size_t escape_stream_finish(struct escape_stream *es, char *dest, size_t dlen, int *err) {
+	assert(err != NULL);
+
+	if (es->err) {
+		*err = es->err;
+		return es->offset;
+	}
+
+	size_t wp = 0;
+	if (es->pending_len > 0) {
+		size_t prp = 0;
+		char c;
+		size_t pos = es->offset - es->pending_len;
+		int res = decode_escape(es->pending, es->pending_len, &prp, &c, 1);
+		if (res != NO_ERROR) {
+			es->err = *err = res;
+			es->offset = pos;
+			return pos;
+		}
+		if (dest && dlen == 0) {
+			*err = 0;
+			return 0;
+		}
+		if (dest)
+			dest[wp] = c;
+		++wp;
+		es->pending_len = 0;
+	}
+
+	*err = 0;
+	return wp;
+}
+#undef ESC_INCOMPLETE
+
 // Helper for safe but slow string concatenation. Result is always zero-terminated.
 // Returns bytes actually written, updates wp to next write position.
 size_t buf_printf(char *buf, size_t bufsize, size_t *wp, int *truncated, const char *format, ...) {
 	size_t written = 0;
-	int left = 0;
+	size_t left = 0;
 
 	if (!__builtin_sub_overflow(bufsize, *wp, &left) && left > 0) {
 		va_list args;
@@ -158,7 +1021,7 @@ size_t buf_printf(char *buf, size_t bufsize, size_t *wp, int *truncated, const c
 		int res = vsnprintf(buf + *wp, left, format, args);
 		va_end(args);
 		if (res >= 0) {
-			if (res >= left) {
+			if ((size_t)res >= left) {
 				// Output was truncated, return actual number of bytes written.
 				res = left;
 				if (truncated)
@@ -173,46 +1036,665 @@ size_t buf_printf(char *buf, size_t bufsize, size_t *wp, int *truncated, const c
 	return written;
 }
 
-#endif
 
-static_assert(sizeof(size_t) >= sizeof(long), "size_t < long"); // Never truncate ftell. PS. You have a weird platform.
+void strbuf_init(struct strbuf *sb) {
+	memset(sb, 0, sizeof(*sb));
+}
 
-char *read_entire_file(const char *filename, size_t *len) {
-	FILE *f = fopen(filename, "rb");
+void strbuf_init_fixed(struct strbuf *sb, char *buf, size_t bufsize) {
+	assert(bufsize > 0);
+	memset(sb, 0, sizeof(*sb));
+	sb->buf = buf;
+	sb->cap = bufsize;
+	sb->fixed = 1;
+	buf[0] = 0;
+}
 
-	if (!f)
-		return NULL;
+void strbuf_free(struct strbuf *sb) {
+	if (!sb->fixed)
+		free(sb->buf);
+	memset(sb, 0, sizeof(*sb));
+}
 
-	fseek(f, 0, SEEK_END);
-	long bytes = ftell(f);
-	if (bytes < 0) {
-		fclose(f);
+// Empty the string, keeping the allocation.
+void strbuf_reset(struct strbuf *sb) {
+	sb->len = 0;
+	sb->truncated = 0;
+	if (sb->buf)
+		sb->buf[0] = 0;
+}
+
+// Make room for n more bytes plus the zero-terminator, growing geometrically.
+// Returns zero on success, or non-zero if the buffer is fixed or allocation failed.
+int strbuf_reserve(struct strbuf *sb, size_t n) {
+	if (sb->cap - sb->len > n)
+		return 0;
+	if (sb->fixed)
+		return -1;
+
+	size_t need;
+	if (__builtin_add_overflow(sb->len, n + 1, &need))
+		return -1;
+	size_t cap = sb->cap ? sb->cap : 64;
+	while (cap < need) {
+		if (__builtin_mul_overflow(cap, 2, &cap))
+			cap = need;
+	}
+
+	char *buf = realloc(sb->buf, cap);
+	if (!buf)
+		return -1;
+	sb->buf = buf;
+	sb->cap = cap;
+	return 0;
+}
+
+// Append n bytes from src. Returns bytes actually appended, which is less than n on truncation.
+size_t strbuf_append(struct strbuf *sb, const char *src, size_t n) {
+	if (strbuf_reserve(sb, n) != 0) {
+		if (sb->cap == 0)
+			return 0; // allocation of initial buffer failed
+		n = sb->cap - sb->len - 1;
+		sb->truncated = 1;
+	}
+	memcpy(sb->buf + sb->len, src, n);
+	sb->len += n;
+	sb->buf[sb->len] = 0;
+	return n;
+}
+
+size_t strbuf_append_str(struct strbuf *sb, const char *str) {
+	return strbuf_append(sb, str, strlen(str));
+}
+
+size_t strbuf_append_char(struct strbuf *sb, char c) {
+	if (sb->cap - sb->len > 1) {
+		sb->buf[sb->len++] = c;
+		sb->buf[sb->len] = 0;
+		return 1;
+	}
+	return strbuf_append(sb, &c, 1);
+}
+
+static const char dec_pairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Format v in decimal, right-aligned to end. Returns pointer to the first digit.
+static char *format_u64(char *end, uint64_t v) {
+	char *p = end;
+	while (v >= 100) {
+		p -= 2;
+		memcpy(p, &dec_pairs[2*(v % 100)], 2);
+		v /= 100;
+	}
+	if (v >= 10) {
+		p -= 2;
+		memcpy(p, &dec_pairs[2*v], 2);
+	} else {
+		*--p = '0' + v;
+	}
+	return p;
+}
+
+size_t strbuf_append_u64(struct strbuf *sb, uint64_t v) {
+	char tmp[20];
+	char *p = format_u64(tmp + sizeof(tmp), v);
+	return strbuf_append(sb, p, tmp + sizeof(tmp) - p);
+}
+
+size_t strbuf_append_i64(struct strbuf *sb, int64_t v) {
+	char tmp[21];
+	char *p = format_u64(tmp + sizeof(tmp), v < 0 ? -(uint64_t)v : (uint64_t)v);
+	if (v < 0)
+		*--p = '-';
+	return strbuf_append(sb, p, tmp + sizeof(tmp) - p);
+}
+
+// Append v as lowercase hex without leading zeros, like "%" PRIx64.
+size_t strbuf_append_hex(struct strbuf *sb, uint64_t v) {
+	char tmp[16];
+	char *p = tmp + sizeof(tmp);
+	do {
+		*--p = hex_pairs[2*(v & 0xf) + 1];
+		v >>= 4;
+	} while (v);
+	return strbuf_append(sb, p, tmp + sizeof(tmp) - p);
+}
+
+// Append formatted output. Prefer the typed append functions, this is the slow path.
+size_t strbuf_printf(struct strbuf *sb, const char *format, ...) {
+	size_t left = sb->cap - sb->len;
+	va_list args;
+
+	va_start(args, format);
+	int res = vsnprintf(left ? sb->buf + sb->len : NULL, left, format, args);
+	va_end(args);
+	if (res < 0)
+		return 0;
+
+	if ((size_t)res >= left) {
+		if (strbuf_reserve(sb, res) == 0) {
+			va_start(args, format);
+			vsnprintf(sb->buf + sb->len, res + 1, format, args);
+			va_end(args);
+		} else if (left > 0) {
+			res = left - 1; // truncated output is already in place.
+			sb->truncated = 1;
+		} else {
+			return 0;
+		}
+	}
+	sb->len += res;
+	return res;
+}
+
+
+// Map a file read-only into memory, without copying it.
+//
+// The data is always followed by a readable zero-terminator. Where the file size is a multiple
+// of the page size, this is provided by mapping the file in front of an anonymous zero page.
+// Files that can't be mapped, e.g pipes, are read with read_entire_fd() instead.
+//
+// Requires POSIX; the access hints need _POSIX_C_SOURCE >= 200112L. Release with unmap_file().
+//
+// Returns data pointer. On error, returns NULL and sets *err to an errno value.
+const char *map_entire_file(const char *filename, struct file_map *fm, int flags, int *err) {
+	assert(err != NULL);
+	// The hints are ignored where unsupported.
+	(void)flags;
+	memset(fm, 0, sizeof(*fm));
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		*err = errno;
 		return NULL;
 	}
-	rewind(f);
 
-	char *buf = malloc(bytes + 1);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || (uintmax_t)st.st_size >= SIZE_MAX)
+		goto fallback;
+
+	size_t len = st.st_size;
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+	size_t maplen = (len / pagesize + 1) * pagesize; // always room for the terminator.
+	int mflags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	if (flags & FILEMAP_POPULATE)
+		mflags |= MAP_POPULATE;
+#endif
+
+	void *base;
+	if (len % pagesize != 0) {
+		// The tail of the last page is zero-filled by mmap.
+		base = mmap(NULL, len, PROT_READ, mflags, fd, 0);
+	} else {
+#ifdef MAP_ANONYMOUS
+		base = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base != MAP_FAILED && mmap(base, len, PROT_READ, mflags | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(base, maplen);
+			base = MAP_FAILED;
+		}
+#else
+		base = MAP_FAILED;
+#endif
+	}
+
+	if (base == MAP_FAILED)
+		goto fallback;
+	close(fd);
+
+#ifdef POSIX_MADV_SEQUENTIAL
+	if (flags & FILEMAP_SEQUENTIAL)
+		posix_madvise(base, len, POSIX_MADV_SEQUENTIAL);
+	if (flags & FILEMAP_WILLNEED)
+		posix_madvise(base, len, POSIX_MADV_WILLNEED);
+#endif
+#ifdef MADV_HUGEPAGE
+	if (flags & FILEMAP_HUGEPAGE)
+		madvise(base, len, MADV_HUGEPAGE);
+#endif
+
+	fm->data = base;
+	fm->len = len;
+	fm->maplen = maplen;
+	*err = 0;
+	return fm->data;
+
+fallback:
+	fm->data = read_entire_fd(fd, &fm->len, 0, err);
+	close(fd);
+	return fm->data;
+}
+
+void unmap_file(struct file_map *fm) {
+	if (fm->maplen) {
+		munmap((void*)(uintptr_t)fm->data, fm->maplen);
+	} else {
+		free((void*)(uintptr_t)fm->data);
+	}
+	memset(fm, 0, sizeof(*fm));
+}
+
+// Reads into the heap if a is NULL, else into the arena, which is rewound on error.
+static char *read_fd_into(struct arena *a, int fd, size_t *len, int flags, int *err) {
+	struct stat st;
+	size_t cap = 16384;
+	size_t rp = 0;
+	int exact = 0;
+	struct arena_pos pos = {0};
+
+	assert(err != NULL);
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		// Zero means unknown, procfs and sysfs report that.
+		if ((uintmax_t)st.st_size >= SIZE_MAX) {
+			*err = EFBIG;
+			return NULL;
+		}
+		cap = st.st_size + 1;
+		exact = 1;
+#ifdef POSIX_FADV_SEQUENTIAL
+		if (flags & READFILE_SEQUENTIAL)
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		if (flags & READFILE_WILLNEED)
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+	}
+	(void)flags;
+
+	char *buf;
+	if (a) {
+		pos = arena_mark(a);
+		buf = arena_alloc_aligned(a, cap, 1);
+	} else {
+		buf = malloc(cap);
+	}
 	if (!buf) {
-		fclose(f);
+		*err = ENOMEM;
 		return NULL;
 	}
 
-	size_t rnum = fread(buf, bytes, 1, f);
-	fclose(f);
+	while (1) {
+		if (rp == cap - 1) {
+			if (exact)
+				break; // Don't chase a file that's growing.
+			size_t new_cap;
+			char *new_buf;
+			if (__builtin_mul_overflow(cap, 2, &new_cap) ||
+				(new_buf = a ? arena_realloc(a, buf, cap, new_cap) : realloc(buf, new_cap)) == NULL) {
+				if (a)
+					arena_reset_to(a, pos);
+				else
+					free(buf);
+				*err = ENOMEM;
+				return NULL;
+			}
+			buf = new_buf;
+			cap = new_cap;
+		}
 
-	if (bytes && rnum != 1) {
-		free(buf);
-		return NULL;
+		ssize_t res = read(fd, buf + rp, cap - 1 - rp);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			*err = errno;
+			if (a)
+				arena_reset_to(a, pos);
+			else
+				free(buf);
+			return NULL;
+		}
+		if (res == 0)
+			break;
+		rp += res;
 	}
 
-	buf[bytes] = 0; // always zero-terminate.
+	buf[rp] = 0; // always zero-terminate.
+	if (a)
+		arena_realloc(a, buf, cap, rp + 1);
 
 	if (len)
-		*len = bytes;
+		*len = rp;
 
+	*err = 0;
 	return buf;
 }
 
+static char *read_file_into(struct arena *a, const char *filename, size_t *len, int flags, int *err) {
+	assert(err != NULL);
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		*err = errno;
+		return NULL;
+	}
+	char *buf = read_fd_into(a, fd, len, flags, err);
+	close(fd);
+
+	return buf;
+}
+
+// Read everything from fd into a zero-terminated heap buffer.
+//
+// Regular files are read with exactly-sized reads, based on their reported size. Anything else,
+// e.g pipes, sockets and procfs files, is read into a buffer that grows geometrically.
+//
+// Requires POSIX; the hints need _POSIX_C_SOURCE >= 200112L.
+//
+// Returns buffer, which the caller must free(), and sets *len. On error, returns NULL and sets *err to an errno value.
+char *read_entire_fd(int fd, size_t *len, int flags, int *err) {
+	return read_fd_into(NULL, fd, len, flags, err);
+}
+
+// Read an entire file, see read_entire_fd().
+char *read_entire_file_ex(const char *filename, size_t *len, int flags, int *err) {
+	return read_file_into(NULL, filename, len, flags, err);
+}
+
+// As read_entire_fd(), but the buffer lives until the arena is reset. The buffer for a stream of
+// unknown size grows in place within the current chunk, and the unused rest is given back.
+char *read_entire_fd_arena(struct arena *a, int fd, size_t *len, int flags, int *err) {
+	return read_fd_into(a, fd, len, flags, err);
+}
+
+char *read_entire_file_arena(struct arena *a, const char *filename, size_t *len, int flags, int *err) {
+	return read_file_into(a, filename, len, flags, err);
+}
+
+char *read_entire_file(const char *filename, size_t *len) {
+	int err;
+	return read_entire_file_ex(filename, len, 0, &err);
+}
+
+#ifdef EUTILS_X86_SIMD
+EUTILS_TARGET_AVX2 static uint64_t byte_mask64_avx2(const char *s, char c) {
+	const __m256i needle = _mm256_set1_epi8(c);
+	__m256i lo = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)s), needle);
+	__m256i hi = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(s + 32)), needle);
+	return (uint32_t)_mm256_movemask_epi8(lo) | (uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32;
+}
+
+EUTILS_TARGET_AVX512 static uint64_t byte_mask64_avx512(const char *s, char c) {
+	return _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(s), _mm512_set1_epi8(c));
+}
+#endif
+
+// Returns a bitmask of the positions of c in the 64 bytes at s.
+static inline uint64_t byte_mask64(const char *s, char c) {
+#ifdef EUTILS_X86_SIMD
+	int level = cpu_level();
+	if (level >= CPU_AVX512)
+		return byte_mask64_avx512(s, c);
+	if (level >= CPU_AVX2)
+		return byte_mask64_avx2(s, c);
+#endif
+	uint64_t mask = 0;
+	for (size_t i = 0 ; i < 64 ; ++i) {
+		mask |= (uint64_t)(s[i] == c) << i;
+	}
+	return mask;
+}
+
+// As byte_mask64(), for the last len < 64 bytes of the data. Kept out of line, it's rarely called.
+static __attribute__((noinline)) uint64_t byte_mask64_tail(const char *s, size_t len, char c) {
+	char block[64];
+	memset(block, ~c, sizeof(block));
+	memcpy(block, s, len);
+	return byte_mask64(block, c);
+}
+
+// Find the delimiter ending the record at it->pos. The delimiters of each 64-byte block are found
+// up front, and handed out of the mask one by one, so short records don't rescan.
+// Returns 1 and sets *end if found, else 0.
+static inline int record_find(struct record_iter *it, size_t *end) {
+	while (it->mask == 0) {
+		if (it->next_block >= it->len)
+			return 0;
+		size_t left = it->len - it->next_block;
+		const char *block = it->data + it->next_block;
+		it->mask = left >= 64 ? byte_mask64(block, it->delim) : byte_mask64_tail(block, left, it->delim);
+		it->next_block += 64;
+	}
+	*end = it->next_block - 64 + __builtin_ctzll(it->mask);
+	it->mask &= it->mask - 1;
+	return 1;
+}
+
+static inline void record_set(const struct record_iter *it, struct record *rec, size_t end) {
+	if ((it->flags & RECORD_CRLF) && end > it->pos && it->data[end - 1] == '\r')
+		--end;
+	rec->ptr = it->data + it->pos;
+	rec->len = end - it->pos;
+}
+
+void record_iter_init(struct record_iter *it, const char *data, size_t len, char delim, int flags) {
+	memset(it, 0, sizeof(*it));
+	it->data = data;
+	it->len = len;
+	it->delim = delim;
+	it->flags = flags;
+}
+
+// Get the next record. A delimiter at the very end of the data does not start another, empty, record.
+//
+// Returns 1 and sets *rec, or 0 when there are no more records.
+int record_next(struct record_iter *it, struct record *rec) {
+	size_t end;
+	if (it->pos >= it->len)
+		return 0;
+	if (record_find(it, &end)) {
+		record_set(it, rec, end);
+		it->pos = end + 1;
+	} else {
+		record_set(it, rec, it->len);
+		it->pos = it->len;
+	}
+	return 1;
+}
+
+// bufsize is the initial size of each of the two buffers, which grow to hold longer records.
+void record_stream_init(struct record_stream *rs, int fd, size_t bufsize, char delim, int flags) {
+	memset(rs, 0, sizeof(*rs));
+	record_iter_init(&rs->it, NULL, 0, delim, flags);
+	rs->fd = fd;
+	rs->bufsize = bufsize < 64 ? 64 : bufsize;
+}
+
+// Move the incomplete record at the end of the current buffer to the front of the other one,
+// and fill the rest of it from the file. The current buffer is left intact, unless in_place is
+// set, which is used when the current buffer holds no returned record yet.
+static void record_stream_fill(struct record_stream *rs, int in_place) {
+	struct record_iter *it = &rs->it;
+	size_t tail = it->len - it->pos;
+	int next = in_place ? rs->cur : !rs->cur;
+	size_t want = rs->bufsize;
+
+	while (want < tail * 2) {
+		if (__builtin_mul_overflow(want, 2, &want)) {
+			rs->err = ENOMEM;
+			return;
+		}
+	}
+	if (rs->cap[next] < want) {
+		char *buf = in_place ? realloc(rs->buf[next], want) : malloc(want);
+		if (!buf) {
+			rs->err = ENOMEM;
+			return;
+		}
+		if (!in_place)
+			free(rs->buf[next]);
+		rs->buf[next] = buf;
+		rs->cap[next] = want;
+	}
+	if (in_place) {
+		memmove(rs->buf[next], rs->buf[next] + it->pos, tail);
+	} else if (tail) {
+		memcpy(rs->buf[next], it->data + it->pos, tail);
+	}
+
+	ssize_t res;
+	do {
+		res = read(rs->fd, rs->buf[next] + tail, rs->cap[next] - tail);
+	} while (res < 0 && errno == EINTR);
+	if (res < 0) {
+		rs->err = errno;
+		return;
+	}
+	if (res == 0)
+		rs->eof = 1;
+
+	// The tail is known not to contain a delimiter, so scanning resumes after it.
+	it->data = rs->buf[next];
+	it->len = tail + res;
+	it->pos = 0;
+	it->next_block = tail;
+	it->mask = 0;
+	rs->cur = next;
+}
+
+// Get the next record from the stream. The record stays valid until the second call after this one,
+// so the previous record can be used together with the current one.
+//
+// Returns 1 and sets *rec, or 0 at end of file or on error. On error, sets rs->err to an errno value.
+int record_stream_next(struct record_stream *rs, struct record *rec) {
+	struct record_iter *it = &rs->it;
+	size_t end;
+	int filled = !rs->buf[rs->cur];
+
+	while (!record_find(it, &end)) {
+		if (rs->eof) {
+			if (it->pos >= it->len)
+				return 0;
+			record_set(it, rec, it->len);
+			it->pos = it->len;
+			return 1;
+		}
+		// Keep the previous record, and grow the new buffer if the record doesn't fit.
+		record_stream_fill(rs, filled);
+		filled = 1;
+		if (rs->err)
+			return 0;
+	}
+	record_set(it, rec, end);
+	it->pos = end + 1;
+	return 1;
+}
+
+void record_stream_free(struct record_stream *rs) {
+	free(rs->buf[0]);
+	free(rs->buf[1]);
+	memset(rs, 0, sizeof(*rs));
+}
+
+#define STRINTERN_MIN_SLOTS 16
+
+// Returns the string equal to s, or NULL and the empty slot where it would go.
+static const char *strintern_probe(struct strintern_table *t, struct strview s, uint64_t hash, size_t *slot) {
+	for (size_t i = hash & t->mask ; ; i = (i + 1) & t->mask) {
+		const char *str = atomic_load_explicit(&t->slots[i].str, memory_order_acquire);
+		if (!str) {
+			*slot = i;
+			return NULL;
+		}
+		// The hash was stored before the release of str, so it's visible here.
+		if (atomic_load_explicit(&t->slots[i].hash, memory_order_relaxed) == hash &&
+			strintern_len(str) == s.len && memcmp(str, s.ptr, s.len) == 0)
+			return str;
+	}
+}
+
+static struct strintern_table *strintern_table_new(struct arena *a, size_t nslots) {
+	struct strintern_table *t = arena_alloc(a, sizeof(*t) + nslots * sizeof(t->slots[0]));
+	if (!t)
+		return NULL;
+	t->mask = nslots - 1;
+	for (size_t i = 0 ; i < nslots ; ++i) {
+		atomic_init(&t->slots[i].hash, 0);
+		atomic_init(&t->slots[i].str, NULL);
+	}
+	return t;
+}
+
+int strintern_init(struct strintern *si, size_t expected) {
+	size_t nslots = STRINTERN_MIN_SLOTS;
+	while (nslots < 2 * expected) {
+		if (nslots > SIZE_MAX / 4 / sizeof(struct strintern_slot)) {
+			errno = EINVAL;
+			return -1;
+		}
+		nslots <<= 1;
+	}
+	si->count = 0;
+	arena_init(&si->arena, 0);
+	struct strintern_table *t = strintern_table_new(&si->arena, nslots);
+	if (!t) {
+		arena_free(&si->arena);
+		errno = ENOMEM;
+		return -1;
+	}
+	atomic_init(&si->table, t);
+	return 0;
+}
+
+void strintern_free(struct strintern *si) {
+	arena_free(&si->arena);
+	memset(si, 0, sizeof(*si));
+}
+
+const char *strintern_find(struct strintern *si, struct strview s) {
+	size_t slot;
+	uint64_t hash = hash64(s.ptr, s.len, 0);
+	return strintern_probe(atomic_load_explicit(&si->table, memory_order_acquire), s, hash, &slot);
+}
+
+const char *strintern(struct strintern *si, struct strview s) {
+	size_t slot;
+	uint64_t hash = hash64(s.ptr, s.len, 0);
+	struct strintern_table *t = atomic_load_explicit(&si->table, memory_order_relaxed);
+	const char *str = strintern_probe(t, s, hash, &slot);
+	if (str)
+		return str;
+
+	if (2 * (si->count + 1) > t->mask + 1) {
+		// Rehash from the stored hashes into a table twice the size, then publish it.
+		struct strintern_table *nt = strintern_table_new(&si->arena, 2 * (t->mask + 1));
+		if (!nt)
+			return NULL;
+		for (size_t i = 0 ; i <= t->mask ; ++i) {
+			const char *old = atomic_load_explicit(&t->slots[i].str, memory_order_relaxed);
+			if (!old)
+				continue;
+			uint64_t h = atomic_load_explicit(&t->slots[i].hash, memory_order_relaxed);
+			size_t j = h & nt->mask;
+			while (atomic_load_explicit(&nt->slots[j].str, memory_order_relaxed))
+				j = (j + 1) & nt->mask;
+			atomic_store_explicit(&nt->slots[j].hash, h, memory_order_relaxed);
+			atomic_store_explicit(&nt->slots[j].str, old, memory_order_relaxed);
+		}
+		atomic_store_explicit(&si->table, nt, memory_order_release);
+		t = nt;
+		strintern_probe(t, s, hash, &slot);
+	}
+
+	// The length, then the zero-terminated bytes.
+	char *p = arena_alloc_aligned(&si->arena, sizeof(size_t) + s.len + 1, _Alignof(size_t));
+	if (!p)
+		return NULL;
+	memcpy(p, &s.len, sizeof(size_t));
+	p += sizeof(size_t);
+	memcpy(p, s.ptr, s.len);
+	p[s.len] = 0;
+
+	atomic_store_explicit(&t->slots[slot].hash, hash, memory_order_relaxed);
+	atomic_store_explicit(&t->slots[slot].str, p, memory_order_release);
+	++si->count;
+	return p;
+}
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <time.h>
+
+#define BENCH_YELLOW "\e[1;33m"
+#define BENCH_NC "\e[0m"
+
+// Requires _POSIX_C_SOURCE >= 199309L for clock_gettime().
+static inline double bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+#define BENCH_START(name) \
+	const char *benchname = STRINGIFY(name); \
+	printf(BENCH_YELLOW "Benchmark '%s'" BENCH_NC "\n", benchname);
+
+// Run 'stmt' 'reps' times and report the best time and the throughput over 'bytes' bytes.
+#define BENCH_RUN(label, reps, bytes, stmt) do { \
+	double best = 1e30; \
+	for (int r_ = 0 ; r_ < (reps) ; ++r_) { \
+		double t0_ = bench_now(); \
+		stmt; \
+		double t_ = bench_now() - t0_; \
+		if (t_ < best) best = t_; \
+	} \
+	printf("  %-40s %10.3f ms %10.1f MB/s\n", (label), best * 1e3, (double)(bytes) / best / 1e6); \
+} while (0)
+
+// Keep the optimizer from discarding a result.
+#define BENCH_SINK(x) __asm__ volatile("" : : "g"(x) : "memory")
@@ -0,0 +1,231 @@
+/*
+	Arena and Pool Allocator Tests
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "earena.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+
+static size_t count_chunks(const struct arena *a) {
+	size_t n = 0;
+	for (const struct arena_chunk *c = a->head ; c ; c = c->next)
+		++n;
+	return n;
+}
+
+static int test_arena_alloc(void) {
+	TEST_START(arena_alloc);
+
+	struct arena a;
+	arena_init(&a, 1024);
+	fails += a.head != NULL;
+
+	// Alignment, and no overlap: fill each allocation and check them all afterwards.
+	uint8_t *ptrs[200];
+	size_t sizes[200];
+	for (size_t i = 0 ; i < ARRAY_SIZE(ptrs) ; ++i) {
+		size_t align = (size_t)1 << (i % 7);
+		sizes[i] = i * 37 % 300;
+		ptrs[i] = arena_alloc_aligned(&a, sizes[i], align);
+		if (!ptrs[i] || (uintptr_t)ptrs[i] % align != 0) {
+			TEST_ERRMSG("allocation %zu of %zu bytes misaligned or NULL", i, sizes[i]);
+			++fails;
+			break;
+		}
+		memset(ptrs[i], (int)i, sizes[i]);
+	}
+	for (size_t i = 0 ; i < ARRAY_SIZE(ptrs) && fails == 0 ; ++i) {
+		for (size_t j = 0 ; j < sizes[i] ; ++j) {
+			if (ptrs[i][j] != (uint8_t)i) {
+				TEST_ERRMSG("allocation %zu was overwritten", i);
+				++fails;
+				break;
+			}
+		}
+	}
+	fails += (uintptr_t)arena_alloc(&a, 3) % ARENA_ALIGN != 0;
+
+	// Zero bytes gives distinct pointers.
+	void *z0 = arena_alloc(&a, 0);
+	void *z1 = arena_alloc(&a, 0);
+	fails += z0 == NULL || z0 == z1;
+
+	// Larger than the chunk size.
+	uint8_t *big = arena_alloc(&a, 100000);
+	fails += big == NULL;
+	if (big)
+		memset(big, 0xAA, 100000);
+
+	// A reset reuses the chunks, without allocating more.
+	size_t chunks = count_chunks(&a);
+	for (int r = 0 ; r < 3 ; ++r) {
+		arena_reset(&a);
+		for (size_t i = 0 ; i < ARRAY_SIZE(ptrs) ; ++i)
+			arena_alloc_aligned(&a, i * 37 % 300, (size_t)1 << (i % 7));
+		arena_alloc(&a, 100000);
+	}
+	if (count_chunks(&a) != chunks) {
+		TEST_ERRMSG("reset didn't reuse chunks, %zu before, %zu after", chunks, count_chunks(&a));
+		++fails;
+	}
+
+	arena_free(&a);
+	fails += a.head != NULL;
+
+	TEST_END();
+}
+
+static int test_arena_mark(void) {
+	TEST_START(arena_mark);
+
+	struct arena a;
+	arena_init(&a, 256);
+
+	// Marks taken before the first chunk exists.
+	struct arena_pos empty = arena_mark(&a);
+	char *first = arena_alloc(&a, 10);
+	arena_reset_to(&a, empty);
+	fails += arena_alloc(&a, 10) != first;
+
+	struct arena_pos pos = arena_mark(&a);
+	char *p = arena_alloc(&a, 100);
+	for (int i = 0 ; i < 20 ; ++i)
+		arena_alloc(&a, 100);
+	arena_reset_to(&a, pos);
+	fails += arena_alloc(&a, 100) != p;
+
+	// realloc of the latest allocation grows and shrinks in place.
+	char *s = arena_strndup(&a, "hello, world", 5);
+	fails += strcmp(s, "hello") != 0;
+	char *g = arena_realloc(&a, s, 6, 40);
+	fails += g != s;
+	char *after = arena_alloc_aligned(&a, 1, 1);
+	fails += after != s + 40;
+	// Not the latest allocation, so it's copied.
+	g = arena_realloc(&a, s, 6, 60);
+	fails += g == s || strcmp(g, "hello") != 0;
+	g = arena_realloc(&a, g, 60, 10);
+	fails += arena_alloc_aligned(&a, 1, 1) != g + 10;
+	// Outgrowing the chunk copies.
+	char *h = arena_realloc(&a, g, 10, 10000);
+	fails += h == NULL || h == g || strcmp(h, "hello") != 0;
+
+	arena_free(&a);
+
+	TEST_END();
+}
+
+static int test_arena_reserve(void) {
+	TEST_START(arena_reserve);
+
+	struct arena a;
+	const size_t size = 1 << 20;
+	if (arena_init_reserve(&a, size) != 0) {
+		TEST_ERRMSG("arena_init_reserve failed");
+		return 1;
+	}
+
+	size_t total = 0;
+	char *prev = NULL;
+	char *p;
+	while ((p = arena_alloc(&a, 1000)) != NULL) {
+		// Consecutive in one range.
+		if (prev && p != prev + 1008) {
+			TEST_ERRMSG("allocations not consecutive");
+			++fails;
+			break;
+		}
+		p[0] = p[999] = 1;
+		prev = p;
+		total += 1000;
+	}
+	// Full, with no room left for one more.
+	size_t n = total / 1000;
+	fails += n == 0 || sizeof(struct arena_chunk) + n * 1008 + 1000 <= size;
+	fails += count_chunks(&a) != 1;
+
+	arena_reset(&a);
+	fails += arena_alloc(&a, size / 2) == NULL;
+
+	arena_free(&a);
+
+	TEST_END();
+}
+
+struct pool_obj {
+	uint64_t id;
+	char name[16];
+};
+
+static int test_pool(void) {
+	TEST_START(pool);
+
+	struct pool p;
+	pool_init(&p, sizeof(struct pool_obj), 16);
+	fails += p.align != 8;
+
+	struct pool_obj *objs[100];
+	for (size_t i = 0 ; i < ARRAY_SIZE(objs) ; ++i) {
+		objs[i] = pool_get(&p);
+		if ((uintptr_t)objs[i] % _Alignof(struct pool_obj) != 0) {
+			TEST_ERRMSG("object %zu misaligned", i);
+			++fails;
+		}
+		objs[i]->id = i;
+		memset(objs[i]->name, 'a' + i % 26, sizeof(objs[i]->name));
+	}
+	for (size_t i = 0 ; i < ARRAY_SIZE(objs) ; ++i)
+		fails += objs[i]->id != i || objs[i]->name[15] != (char)('a' + i % 26);
+
+	// Freed objects are handed out again, most recent first.
+	pool_put(&p, objs[10]);
+	pool_put(&p, objs[20]);
+	fails += pool_get(&p) != (void*)objs[20];
+	fails += pool_get(&p) != (void*)objs[10];
+
+	size_t chunks = count_chunks(&p.arena);
+	pool_reset(&p);
+	for (size_t i = 0 ; i < ARRAY_SIZE(objs) ; ++i)
+		pool_get(&p);
+	fails += count_chunks(&p.arena) != chunks;
+
+	pool_free(&p);
+
+	// Tiny objects still fit the free list link.
+	pool_init(&p, 1, 0);
+	fails += p.size != sizeof(void*);
+	char *a = pool_get(&p);
+	char *b = pool_get(&p);
+	fails += a == NULL || b == NULL || a == b;
+	pool_free(&p);
+
+	TEST_END();
+}
+
+int main(int UNUSED(argc), char UNUSED(*argv[])) {
+	size_t failed = 0;
+
+	failed += test_arena_alloc();
+	failed += test_arena_mark();
+	failed += test_arena_reserve();
+	failed += test_pool();
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
 
 #include "emacros.h"
 #include "internal/tests.h"
@@ -36,6 +37,135 @@ static int test_reverse_array(void) {
 	reverse_array(arr + 1, n - 3);
 	fails += CHECK_ARRAY(arr, 8,3,4,5,6,7,2,1);
 
+	// Typed versions against the generic one, across the vector width and tail handling.
+	uint8_t b[300], b_ref[300];
+	uint16_t w[300], w_ref[300];
+	uint32_t d[300], d_ref[300];
+	for (size_t len = 0 ; len <= ARRAY_SIZE(b) ; ++len) {
+		for (size_t i = 0 ; i < len ; ++i) {
+			b[i] = b_ref[i] = i * 7;
+			w[i] = w_ref[i] = i * 263;
+			d[i] = d_ref[i] = i * 65599;
+		}
+		reverse_array(b_ref, len);
+		reverse_array(w_ref, len);
+		reverse_array(d_ref, len);
+		reverse_array_u8(b, len);
+		reverse_array_u16(w, len);
+		reverse_array_u32(d, len);
+		if (memcmp(b, b_ref, len) != 0 || memcmp(w, w_ref, len * sizeof(w[0])) != 0 || memcmp(d, d_ref, len * sizeof(d[0])) != 0) {
+			TEST_ERRMSG("typed reverse mismatch for length %zu", len);
+			++fails;
+		}
+	}
+
+	TEST_END();
+}
+
+static int test_array_kernels(void) {
+	TEST_START(array_kernels);
+
+	static float f[1000], f2[1000], fout[1000], fref[1000];
+	static int32_t d[1000], dout[1000], dref[1000];
+	static uint8_t b[1000], bout[1000], bref[1000];
+	uint32_t x = 0xC1A4;
+
+	// Lengths across the vector widths and tails, with specials among the floats.
+	for (size_t len = 0 ; len <= ARRAY_SIZE(f) ; len += len < 100 ? 1 : 450) {
+		for (size_t i = 0 ; i < len ; ++i) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			f[i] = (float)(int32_t)x / 1e9f;
+			f2[i] = (float)(x >> 8) / 1e6f;
+			d[i] = (int32_t)x;
+			b[i] = x >> 24;
+		}
+		const float special[] = { NAN, -0.0f, 0.0f, INFINITY, -INFINITY, 1.0f };
+		for (size_t i = 0 ; i < len && i < ARRAY_SIZE(special) ; ++i)
+			f[len - 1 - i] = special[i];
+
+		// Including an empty and an inverted range.
+		const float flim[][2] = { { -1.0f, 1.0f }, { 0.0f, 0.0f }, { 0.5f, -0.5f } };
+		const int32_t dlim[][2] = { { -1000000, 1000000 }, { INT32_MIN, INT32_MAX }, { 10, -10 } };
+		const uint8_t blim[][2] = { { 16, 235 }, { 0, 255 }, { 200, 100 } };
+		for (size_t r = 0 ; r < ARRAY_SIZE(flim) ; ++r) {
+			for (size_t i = 0 ; i < len ; ++i) {
+				fref[i] = CLAMP(f[i], flim[r][0], flim[r][1]);
+				dref[i] = CLAMP(d[i], dlim[r][0], dlim[r][1]);
+				bref[i] = CLAMP(b[i], blim[r][0], blim[r][1]);
+			}
+			clamp_f32(fout, f, len, flim[r][0], flim[r][1]);
+			clamp_i32(dout, d, len, dlim[r][0], dlim[r][1]);
+			clamp_u8(bout, b, len, blim[r][0], blim[r][1]);
+			if (memcmp(fout, fref, len * sizeof(float)) != 0 || memcmp(dout, dref, len * sizeof(int32_t)) != 0 || memcmp(bout, bref, len) != 0) {
+				TEST_ERRMSG("clamp mismatch for length %zu, range %zu", len, r);
+				++fails;
+			}
+		}
+
+		// Order doesn't matter without the specials.
+		size_t plain = len > ARRAY_SIZE(special) ? len - ARRAY_SIZE(special) : 0;
+		if (plain > 0) {
+			float fmin, fmax, fmin_ref = f[0], fmax_ref = f[0];
+			int32_t dmin, dmax, dmin_ref = d[0], dmax_ref = d[0];
+			uint8_t bmin, bmax, bmin_ref = b[0], bmax_ref = b[0];
+			for (size_t i = 1 ; i < plain ; ++i) {
+				fmin_ref = MIN(fmin_ref, f[i]);
+				fmax_ref = MAX(fmax_ref, f[i]);
+				dmin_ref = MIN(dmin_ref, d[i]);
+				dmax_ref = MAX(dmax_ref, d[i]);
+				bmin_ref = MIN(bmin_ref, b[i]);
+				bmax_ref = MAX(bmax_ref, b[i]);
+			}
+			minmax_reduce_f32(f, plain, &fmin, &fmax);
+			minmax_reduce_i32(d, plain, &dmin, &dmax);
+			minmax_reduce_u8(b, plain, &bmin, &bmax);
+			if (memcmp(&fmin, &fmin_ref, sizeof(float)) != 0 || memcmp(&fmax, &fmax_ref, sizeof(float)) != 0 ||
+				dmin != dmin_ref || dmax != dmax_ref || bmin != bmin_ref || bmax != bmax_ref) {
+				TEST_ERRMSG("minmax_reduce mismatch for length %zu", plain);
+				++fails;
+			}
+		}
+
+		for (size_t i = 0 ; i < len ; ++i)
+			fref[i] = LERP(f[i], f2[i], 0.3f);
+		lerp_f32(fout, f, f2, len, 0.3f);
+		if (memcmp(fout, fref, len * sizeof(float)) != 0) {
+			TEST_ERRMSG("lerp_f32 mismatch for length %zu", len);
+			++fails;
+		}
+	}
+
+	// A lone infinity is both the min and the max, and n = 0 leaves the outputs alone.
+	float fmin = 0.0f, fmax = 0.0f;
+	const float inf = INFINITY;
+	minmax_reduce_f32(&inf, 1, &fmin, &fmax);
+	fails += !(fmin > 1e38f) || !(fmax > 1e38f);
+	int32_t dmin = 1, dmax = 2;
+	minmax_reduce_i32(d, 0, &dmin, &dmax);
+	fails += dmin != 1 || dmax != 2;
+
+	// Every input of lerp_u8 against the exact rounding, t = 128 first, where LERP(0, 255, 0.5f) gives 127.
+	static uint8_t v0[65536], v1[65536], out[65536];
+	for (size_t i = 0 ; i < ARRAY_SIZE(v0) ; ++i) {
+		v0[i] = i;
+		v1[i] = i >> 8;
+	}
+	lerp_u8(out, v0 + 0xFF00, v1 + 0xFF00, 1, 128);
+	fails += out[0] != 128;
+	for (unsigned t = 0 ; t <= 255 ; ++t) {
+		lerp_u8(out, v0, v1, ARRAY_SIZE(v0), t);
+		for (size_t i = 0 ; i < ARRAY_SIZE(v0) ; ++i) {
+			unsigned num = v0[i] * (255 - t) + v1[i] * t;
+			if (out[i] != (2 * num + 255) / 510) {
+				TEST_ERRMSG("lerp_u8(%d, %d, %u) returned %d, expected %u", v0[i], v1[i], t, out[i], (2 * num + 255) / 510);
+				++fails;
+				break;
+			}
+		}
+	}
+
 	TEST_END();
 }
 
@@ -110,6 +240,713 @@ static int test_sort_array_cmp_data(void) {
 	TEST_END();
 }
 
+GEN_SORT(sort_ints, int, SORT_ARRAY_CMP_GT);
+GEN_SORT(sort_ints_desc, int, SORT_ARRAY_CMP_LT);
+GEN_SORT(sort_names, const char *, SORT_ARRAY_CMP_CSTR_ASC);
+GEN_SORT(sort_names_desc, const char *, SORT_ARRAY_CMP_CSTR_DESC);
+GEN_SORT(sort_interned, const char *, SORT_ARRAY_CMP_INTERNED_ASC);
+GEN_SORT(sort_interned_desc, const char *, SORT_ARRAY_CMP_INTERNED_DESC);
+GEN_SORT_DATA(sort_perm, int, SORT_ARRAY_CMP_PERM_GT, const int *);
+// Evaluates its arguments twice, like SORT_ARRAY_CMP_INTERNED_*.
+#define CMP_TWICE_GT(a,b,cmp_data) ((a) != (b) && (a) > (b))
+GEN_SORT(sort_ints_twice, int, CMP_TWICE_GT);
+
+static int cmp_int_qsort(const void *a, const void *b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+// Fill arr with one of several patterns that are known to trip up quicksorts.
+static void fill_pattern(int *arr, size_t n, int pattern, uint32_t *x) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		*x ^= *x << 13;
+		*x ^= *x >> 17;
+		*x ^= *x << 5;
+		switch (pattern) {
+			case 0: arr[i] = (int)*x; break;		// random
+			case 1: arr[i] = i; break;			// ascending
+			case 2: arr[i] = n - i; break;			// descending
+			case 3: arr[i] = 7; break;			// all equal
+			case 4: arr[i] = *x % 4; break;			// few unique
+			case 5: arr[i] = i < n / 2 ? i : n - i; break;	// organ pipe
+			case 6: arr[i] = i % 2 ? (int)*x : (int)i; break; // half sorted
+			default: arr[i] = (i * 31) % 17; break;		// sawtooth
+		}
+	}
+}
+
+static int test_gen_sort(void) {
+	TEST_START(gen_sort);
+
+	static int arr[20000];
+	static int ref[20000];
+	const size_t sizes[] = { 0, 1, 2, 3, 23, 24, 25, 128, 129, 1000, ARRAY_SIZE(arr) };
+	uint32_t x = 0xDEADBEEF;
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		for (int pattern = 0 ; pattern < 8 ; ++pattern) {
+			fill_pattern(arr, n, pattern, &x);
+			memcpy(ref, arr, n * sizeof(arr[0]));
+			qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+
+			sort_ints(arr, n);
+			if (memcmp(arr, ref, n * sizeof(arr[0])) != 0) {
+				TEST_ERRMSG("n=%zu, pattern %d: ascending sort mismatch", n, pattern);
+				++fails;
+			}
+			sort_ints_desc(arr, n);
+			for (size_t i = 0 ; i < n ; ++i) {
+				if (arr[i] != ref[n - 1 - i]) {
+					TEST_ERRMSG("n=%zu, pattern %d: descending sort mismatch at %zu", n, pattern, i);
+					++fails;
+					break;
+				}
+			}
+		}
+	}
+
+	// The worst-case fallback is hard to trigger, so exercise it directly.
+	fill_pattern(arr, 1000, 0, &x);
+	memcpy(ref, arr, 1000 * sizeof(arr[0]));
+	qsort(ref, 1000, sizeof(ref[0]), cmp_int_qsort);
+	sort_ints_heapsort(arr, 1000, NULL);
+	if (memcmp(arr, ref, 1000 * sizeof(arr[0])) != 0) {
+		TEST_ERRMSG("heapsort mismatch");
+		++fails;
+	}
+
+	// The sort must not pass expressions with side effects to the comparator.
+	for (int pattern = 0 ; pattern < 8 ; ++pattern) {
+		fill_pattern(arr, ARRAY_SIZE(arr), pattern, &x);
+		memcpy(ref, arr, sizeof(arr));
+		qsort(ref, ARRAY_SIZE(ref), sizeof(ref[0]), cmp_int_qsort);
+		sort_ints_twice(arr, ARRAY_SIZE(arr));
+		if (memcmp(arr, ref, sizeof(arr)) != 0) {
+			TEST_ERRMSG("pattern %d: mismatch with a comparator that evaluates its arguments twice", pattern);
+			++fails;
+		}
+	}
+
+	const char *names[] = { "emma", "amanda", "julie", "ellie", "sarah", "emma" };
+	const char *names_expected[] = { "amanda", "ellie", "emma", "emma", "julie", "sarah" };
+	sort_names(names, ARRAY_SIZE(names));
+	for (size_t i = 0 ; i < ARRAY_SIZE(names) ; ++i) {
+		fails += strcmp(names[i], names_expected[i]) == 0 ? 0 : 1;
+	}
+	sort_names_desc(names, ARRAY_SIZE(names));
+	for (size_t i = 0 ; i < ARRAY_SIZE(names) ; ++i) {
+		fails += strcmp(names[i], names_expected[ARRAY_SIZE(names) - 1 - i]) == 0 ? 0 : 1;
+	}
+
+	// Interned strings, i.e equal strings are the same pointer. Large enough to partition.
+	static const char *const uniq[] = { "amanda", "ellie", "emma", "julie", "sarah" };
+	static const char *syms[2000];
+	size_t counts[ARRAY_SIZE(uniq)] = { 0 };
+	for (size_t i = 0 ; i < ARRAY_SIZE(syms) ; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		syms[i] = uniq[x % ARRAY_SIZE(uniq)];
+		counts[x % ARRAY_SIZE(uniq)]++;
+	}
+	for (int dir = 0 ; dir < 2 ; ++dir) {
+		if (dir == 0)
+			sort_interned(syms, ARRAY_SIZE(syms));
+		else
+			sort_interned_desc(syms, ARRAY_SIZE(syms));
+		size_t seen[ARRAY_SIZE(uniq)] = { 0 };
+		for (size_t i = 0 ; i < ARRAY_SIZE(syms) ; ++i) {
+			for (size_t j = 0 ; j < ARRAY_SIZE(uniq) ; ++j)
+				seen[j] += syms[i] == uniq[j];
+			if (i > 0 && (dir ? -1 : 1) * strcmp(syms[i - 1], syms[i]) > 0) {
+				TEST_ERRMSG("interned strings out of order at %zu", i);
+				++fails;
+				break;
+			}
+		}
+		fails += memcmp(seen, counts, sizeof(seen)) != 0;
+	}
+
+	// Permutation over a large array with duplicates. Not stable, so only check the order.
+	static int perm[ARRAY_SIZE(arr)];
+	const size_t n = ARRAY_SIZE(arr);
+	fill_pattern(arr, n, 4, &x);
+	for (size_t i = 0 ; i < n ; ++i) {
+		perm[i] = i;
+	}
+	sort_perm(perm, n, arr);
+	memset(ref, 0, sizeof(ref));
+	for (size_t i = 0 ; i < n ; ++i) {
+		ref[perm[i]]++;
+		if (i > 0 && arr[perm[i - 1]] > arr[perm[i]]) {
+			TEST_ERRMSG("permutation out of order at %zu", i);
+			++fails;
+			break;
+		}
+	}
+	for (size_t i = 0 ; i < n ; ++i) {
+		if (ref[i] != 1) {
+			TEST_ERRMSG("not a permutation, index %zu occurs %d times", i, ref[i]);
+			++fails;
+			break;
+		}
+	}
+
+	// The keys directly following the permutation, where an empty partition at its end starts.
+	static int adjacent[2 * 1000];
+	int *keys = adjacent + 1000;
+	for (size_t i = 0 ; i < 1000 ; ++i) {
+		adjacent[i] = i;
+		keys[i] = (int)(i % 10);
+	}
+	sort_perm(adjacent, 1000, keys);
+	for (size_t i = 1 ; i < 1000 ; ++i) {
+		if (keys[adjacent[i - 1]] > keys[adjacent[i]]) {
+			TEST_ERRMSG("adjacent permutation out of order at %zu", i);
+			++fails;
+			break;
+		}
+	}
+
+	TEST_END();
+}
+
+GEN_SELECT(select_ints, int, SORT_ARRAY_CMP_GT);
+GEN_SELECT(select_ints_desc, int, SORT_ARRAY_CMP_LT);
+GEN_SELECT_DATA(select_perm, int, SORT_ARRAY_CMP_PERM_GT, const int *);
+
+// Check that arr[k] is ref[k] and arr is partitioned around it.
+static int check_nth(const int *arr, const int *ref, size_t n, size_t k) {
+	if (arr[k] != ref[k])
+		return 1;
+	for (size_t i = 0 ; i < n ; ++i) {
+		if ((i < k && arr[i] > arr[k]) || (i > k && arr[i] < arr[k]))
+			return 1;
+	}
+	return 0;
+}
+
+static int test_select(void) {
+	TEST_START(select);
+
+	static int arr[20000];
+	static int ref[20000];
+	const size_t sizes[] = { 1, 2, 3, 23, 24, 25, 128, 129, 1000, ARRAY_SIZE(arr) };
+	uint32_t x = 0x5E1EC7;
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		// Every k for the small arrays, the ends and a few percentiles for the large.
+		size_t ks[] = { 0, 1, n / 2, n * 99 / 100, n * 999 / 1000, n - 2, n - 1 };
+		for (int pattern = 0 ; pattern < 8 ; ++pattern) {
+			fill_pattern(arr, n, pattern, &x);
+			memcpy(ref, arr, n * sizeof(arr[0]));
+			qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+
+			size_t num_k = n <= 129 ? n : ARRAY_SIZE(ks);
+			for (size_t j = 0 ; j < num_k ; ++j) {
+				size_t k = n <= 129 ? j : ks[j];
+				if (k >= n)
+					continue;
+				select_ints_select_nth(arr, n, k);
+				if (check_nth(arr, ref, n, k)) {
+					TEST_ERRMSG("n=%zu, pattern %d: select_nth(%zu) gave %d, expected %d", n, pattern, k, arr[k], ref[k]);
+					++fails;
+					break;
+				}
+			}
+
+			size_t k = n / 10 + 1;
+			fill_pattern(arr, n, pattern, &x);
+			memcpy(ref, arr, n * sizeof(arr[0]));
+			qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+			select_ints_partial_sort(arr, n, k);
+			if (memcmp(arr, ref, MIN(k, n) * sizeof(arr[0])) != 0) {
+				TEST_ERRMSG("n=%zu, pattern %d: partial_sort(%zu) mismatch", n, pattern, k);
+				++fails;
+			}
+
+			// The k largest, by streaming through a heap with the reverse order.
+			int heap[64];
+			size_t count = 0;
+			k = MIN(ARRAY_SIZE(heap), n);
+			for (size_t i = 0 ; i < n ; ++i)
+				select_ints_desc_topk_push(heap, &count, k, arr[i]);
+			select_ints_desc_topk_sort(heap, count);
+			fails += count != k;
+			for (size_t i = 0 ; i < count ; ++i) {
+				if (heap[i] != ref[n - 1 - i]) {
+					TEST_ERRMSG("n=%zu, pattern %d: top-k mismatch at %zu", n, pattern, i);
+					++fails;
+					break;
+				}
+			}
+		}
+	}
+
+	// Out of range and empty requests leave the array alone.
+	int small[] = { 3, 1, 2 };
+	select_ints_select_nth(small, ARRAY_SIZE(small), 3);
+	select_ints_partial_sort(small, ARRAY_SIZE(small), 0);
+	fails += small[0] != 3 || small[1] != 1 || small[2] != 2;
+	size_t count = 0;
+	select_ints_topk_push(small, &count, 0, 1);
+	fails += count != 0;
+
+	// Median of a permutation.
+	static int perm[ARRAY_SIZE(arr)];
+	const size_t n = ARRAY_SIZE(arr);
+	fill_pattern(arr, n, 0, &x);
+	for (size_t i = 0 ; i < n ; ++i)
+		perm[i] = i;
+	memcpy(ref, arr, sizeof(ref));
+	qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+	select_perm_select_nth(perm, n, n / 2, arr);
+	fails += arr[perm[n / 2]] != ref[n / 2];
+	select_perm_partial_sort(perm, n, 10, arr);
+	for (size_t i = 0 ; i < 10 ; ++i)
+		fails += arr[perm[i]] != ref[i];
+
+	TEST_END();
+}
+
+static int cmp_u64_qsort(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+static int cmp_float_qsort(const void *a, const void *b) {
+	float x = *(const float*)a;
+	float y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+
+static int test_radix_sort(void) {
+	TEST_START(radix_sort);
+
+	static int32_t arr[20000];
+	static int32_t ref[20000];
+	static uint64_t arr64[20000];
+	static uint64_t ref64[20000];
+	static float arrf[20000];
+	static float reff[20000];
+	static float tmpf[20000];
+	static uint32_t perm[20000];
+	static int refperm[20000];
+	const size_t sizes[] = { 0, 1, 2, 64, 65, 1000, ARRAY_SIZE(arr) };
+	uint32_t x = 0xC0FFEE;
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		for (int pattern = 0 ; pattern < 8 ; ++pattern) {
+			fill_pattern(arr, n, pattern, &x);
+			for (size_t i = 0 ; i < n ; ++i) {
+				arr64[i] = (uint64_t)(uint32_t)arr[i] << (i % 33) ^ (uint64_t)arr[i];
+				arrf[i] = (float)arr[i] / 1024.0f;
+			}
+			memcpy(ref, arr, n * sizeof(arr[0]));
+			memcpy(ref64, arr64, n * sizeof(arr64[0]));
+			memcpy(reff, arrf, n * sizeof(arrf[0]));
+			qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+			qsort(ref64, n, sizeof(ref64[0]), cmp_u64_qsort);
+			qsort(reff, n, sizeof(reff[0]), cmp_float_qsort);
+
+			// The argsort must match the stable insertion sort, which is too slow for the largest size.
+			if (n <= 1000) {
+				for (size_t i = 0 ; i < n ; ++i) {
+					refperm[i] = i;
+				}
+				sort_array_cmp_data(refperm, n, SORT_ARRAY_CMP_PERM_GT, arr);
+				fails += radix_argsort_i32(arr, n, perm) != 0;
+				for (size_t i = 0 ; i < n ; ++i) {
+					if (perm[i] != (uint32_t)refperm[i]) {
+						TEST_ERRMSG("n=%zu, pattern %d: argsort mismatch at %zu", n, pattern, i);
+						++fails;
+						break;
+					}
+				}
+			}
+			fails += radix_argsort_f32(arrf, n, perm) != 0;
+			for (size_t i = 1 ; i < n ; ++i) {
+				if (arrf[perm[i - 1]] > arrf[perm[i]] || (!(arrf[perm[i - 1]] < arrf[perm[i]]) && perm[i - 1] > perm[i])) {
+					TEST_ERRMSG("n=%zu, pattern %d: float argsort out of order at %zu", n, pattern, i);
+					++fails;
+					break;
+				}
+			}
+
+			fails += radix_sort_i32(arr, n, NULL) != 0;
+			if (memcmp(arr, ref, n * sizeof(arr[0])) != 0) {
+				TEST_ERRMSG("n=%zu, pattern %d: i32 sort mismatch", n, pattern);
+				++fails;
+			}
+			fails += radix_sort_u64(arr64, n, NULL) != 0;
+			if (memcmp(arr64, ref64, n * sizeof(arr64[0])) != 0) {
+				TEST_ERRMSG("n=%zu, pattern %d: u64 sort mismatch", n, pattern);
+				++fails;
+			}
+			fails += radix_sort_f32(arrf, n, tmpf) != 0;
+			if (memcmp(arrf, reff, n * sizeof(arrf[0])) != 0) {
+				TEST_ERRMSG("n=%zu, pattern %d: f32 sort mismatch", n, pattern);
+				++fails;
+			}
+		}
+	}
+
+	// Unsigned keys with a caller-provided buffer, and the float edge cases.
+	uint32_t keys[] = { 0xFFFFFFFF, 0, 0x80000000, 0x7FFFFFFF, 1, 0xFFFFFFFE };
+	uint32_t tmp[ARRAY_SIZE(keys)];
+	fails += radix_sort_u32(keys, ARRAY_SIZE(keys), tmp) != 0;
+	fails += CHECK_ARRAY(keys, 0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF);
+
+	float fl[] = { 0.0f, -1.5f, 3.25f, -0.0f, -1e30f, 1e30f };
+	fails += radix_sort_f32(fl, ARRAY_SIZE(fl), NULL) != 0;
+	const float fl_expected[] = { -1e30f, -1.5f, -0.0f, 0.0f, 3.25f, 1e30f };
+	fails += memcmp(fl, fl_expected, sizeof(fl)) != 0;
+
+	const int32_t ex[] = { 42, 3, -1, 0, 0, 512, 1, 128, 2, 0 };
+	uint32_t exp[ARRAY_SIZE(ex)];
+	fails += radix_argsort_i32(ex, ARRAY_SIZE(ex), exp) != 0;
+	fails += CHECK_ARRAY(exp, 2, 3, 4, 9, 6, 8, 1, 0, 7, 5);
+
+	TEST_END();
+}
+
+static int test_sort_small(void) {
+	TEST_START(sort_small);
+
+	int32_t arr[SORT_NET_MAX + 8];
+	int32_t ref[SORT_NET_MAX + 8];
+	uint32_t arru[SORT_NET_MAX + 8];
+	float arrf[SORT_NET_MAX + 8];
+	float reff[SORT_NET_MAX + 8];
+	uint32_t x = 0xABCDEF;
+
+	for (size_t n = 0 ; n <= ARRAY_SIZE(arr) ; ++n) {
+		for (int pattern = 0 ; pattern < 8 ; ++pattern) {
+			for (int round = 0 ; round < 16 ; ++round) {
+				fill_pattern(arr, n, pattern, &x);
+				for (size_t i = 0 ; i < n ; ++i) {
+					// Include the extremes, which collide with the padding.
+					if (round == 1 && i % 3 == 0)
+						arr[i] = i % 2 ? INT32_MIN : INT32_MAX;
+					arru[i] = (uint32_t)arr[i];
+					arrf[i] = (float)arr[i] / 256.0f;
+				}
+				if (round == 2 && n > 1) {
+					arrf[0] = INFINITY;
+					arrf[n - 1] = -INFINITY;
+				}
+				memcpy(ref, arr, n * sizeof(arr[0]));
+				memcpy(reff, arrf, n * sizeof(arrf[0]));
+				qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+				qsort(reff, n, sizeof(reff[0]), cmp_float_qsort);
+
+				sort_small_i32(arr, n);
+				if (memcmp(arr, ref, n * sizeof(arr[0])) != 0) {
+					TEST_ERRMSG("n=%zu, pattern %d: i32 mismatch", n, pattern);
+					++fails;
+				}
+				sort_small_f32(arrf, n);
+				if (memcmp(arrf, reff, n * sizeof(arrf[0])) != 0) {
+					TEST_ERRMSG("n=%zu, pattern %d: f32 mismatch", n, pattern);
+					++fails;
+				}
+				sort_small_u32(arru, n);
+				for (size_t i = 1 ; i < n ; ++i) {
+					if (arru[i - 1] > arru[i]) {
+						TEST_ERRMSG("n=%zu, pattern %d: u32 out of order at %zu", n, pattern, i);
+						++fails;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	TEST_END();
+}
+
+GEN_PARALLEL_SORT(psort_ints, int, SORT_ARRAY_CMP_GT);
+GEN_PARALLEL_SORT(psort_ints_desc, int, SORT_ARRAY_CMP_LT);
+GEN_PARALLEL_SORT_DATA(psort_perm, int, SORT_ARRAY_CMP_PERM_GT, const int *);
+
+static int test_parallel_sort(void) {
+	TEST_START(parallel_sort);
+
+	static int arr[9 * PSORT_CUTOFF + 17];
+	static int ref[ARRAY_SIZE(arr)];
+	const size_t sizes[] = { 0, 1, 1000, 2 * PSORT_CUTOFF, 3 * PSORT_CUTOFF + 1, ARRAY_SIZE(arr) };
+	const int threads[] = { 0, 1, 2, 3, 4, 7, 8, PSORT_MAX_THREADS + 1 };
+	uint32_t x = 0x5EED;
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		for (size_t t = 0 ; t < ARRAY_SIZE(threads) ; ++t) {
+			int pattern = (int)((s + t) % 8);
+			fill_pattern(arr, n, pattern, &x);
+			memcpy(ref, arr, n * sizeof(arr[0]));
+			qsort(ref, n, sizeof(ref[0]), cmp_int_qsort);
+
+			psort_ints(arr, n, threads[t]);
+			if (memcmp(arr, ref, n * sizeof(arr[0])) != 0) {
+				TEST_ERRMSG("n=%zu, %d threads, pattern %d: ascending sort mismatch", n, threads[t], pattern);
+				++fails;
+			}
+			psort_ints_desc(arr, n, threads[t]);
+			for (size_t i = 0 ; i < n ; ++i) {
+				if (arr[i] != ref[n - 1 - i]) {
+					TEST_ERRMSG("n=%zu, %d threads, pattern %d: descending sort mismatch at %zu", n, threads[t], pattern, i);
+					++fails;
+					break;
+				}
+			}
+		}
+	}
+
+	// A small cutoff at runtime, with more rounds than threads would get by default, sorting a permutation.
+	static int keys[5000];
+	static int perm[ARRAY_SIZE(keys)];
+	const size_t cutoffs[] = { 1, 7, 100, 1000 };
+	for (size_t c = 0 ; c < ARRAY_SIZE(cutoffs) ; ++c) {
+		fill_pattern(keys, ARRAY_SIZE(keys), (int)c, &x);
+		for (size_t i = 0 ; i < ARRAY_SIZE(perm) ; ++i)
+			perm[i] = (int)i;
+		psort_perm_ex(perm, ARRAY_SIZE(perm), 13, cutoffs[c], keys);
+		for (size_t i = 1 ; i < ARRAY_SIZE(perm) ; ++i) {
+			if (keys[perm[i - 1]] > keys[perm[i]]) {
+				TEST_ERRMSG("cutoff %zu: permutation out of order at %zu", cutoffs[c], i);
+				++fails;
+				break;
+			}
+		}
+		// The keys in permutation order are the keys sorted.
+		for (size_t i = 0 ; i < ARRAY_SIZE(perm) ; ++i)
+			perm[i] = keys[perm[i]];
+		psort_ints_ex(keys, ARRAY_SIZE(keys), 0, cutoffs[c]);
+		fails += memcmp(perm, keys, sizeof(keys)) != 0;
+	}
+
+	TEST_END();
+}
+
+static int cmp_cstr_qsort(const void *a, const void *b) {
+	return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int test_sort_cstr(void) {
+	TEST_START(sort_cstr);
+
+	static char pool[5000][40];
+	static const char *strs[ARRAY_SIZE(pool)];
+	static const char *ref[ARRAY_SIZE(pool)];
+	static uint32_t perm[ARRAY_SIZE(pool)];
+	const char *prefixes[] = { "", "a", "sym_", "namespace::detail::", "namespace::detail::impl_" };
+	const size_t sizes[] = { 0, 1, 2, 15, 16, 17, 100, 1025, ARRAY_SIZE(pool) };
+	uint32_t x = 0x1234567;
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		for (size_t i = 0 ; i < n ; ++i) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			// Few distinct suffixes, so there are plenty of duplicates and shared prefixes.
+			snprintf(pool[i], sizeof(pool[i]), "%s%.*s", prefixes[x % ARRAY_SIZE(prefixes)], (int)((x >> 8) % 4), &"\xE5zb\x01"[(x >> 12) % 3]);
+			strs[i] = pool[i];
+		}
+		memcpy(ref, strs, n * sizeof(strs[0]));
+		qsort(ref, n, sizeof(ref[0]), cmp_cstr_qsort);
+
+		fails += sort_cstr_perm(strs, n, perm, SORT_CSTR_ASC) != 0;
+		for (size_t i = 0 ; i < n ; ++i) {
+			if (strcmp(strs[perm[i]], ref[i]) != 0) {
+				TEST_ERRMSG("n=%zu: ascending permutation mismatch at %zu", n, i);
+				++fails;
+				break;
+			}
+		}
+		fails += sort_cstr_perm(strs, n, perm, SORT_CSTR_DESC) != 0;
+		for (size_t i = 0 ; i < n ; ++i) {
+			if (strcmp(strs[perm[i]], ref[n - 1 - i]) != 0) {
+				TEST_ERRMSG("n=%zu: descending permutation mismatch at %zu", n, i);
+				++fails;
+				break;
+			}
+		}
+
+		fails += sort_cstr(strs, n, SORT_CSTR_ASC) != 0;
+		for (size_t i = 0 ; i < n ; ++i) {
+			if (strcmp(strs[i], ref[i]) != 0) {
+				TEST_ERRMSG("n=%zu: ascending mismatch at %zu", n, i);
+				++fails;
+				break;
+			}
+		}
+		fails += sort_cstr(strs, n, SORT_CSTR_DESC) != 0;
+		for (size_t i = 0 ; i < n ; ++i) {
+			if (strcmp(strs[i], ref[n - 1 - i]) != 0) {
+				TEST_ERRMSG("n=%zu: descending mismatch at %zu", n, i);
+				++fails;
+				break;
+			}
+		}
+	}
+
+	// A pivot that only splits off two strings is a bad partition. With no more allowed, the
+	// rest is heapsorted, which must agree with the reference on strings sharing long prefixes.
+	static struct cstr_item items[1000];
+	const size_t n = ARRAY_SIZE(items);
+	for (size_t i = 0 ; i < n ; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		snprintf(pool[i], sizeof(pool[i]), "m%s%u", prefixes[x % ARRAY_SIZE(prefixes)], x % 500);
+	}
+	strcpy(pool[0], "a0");
+	strcpy(pool[n / 2], "a1");
+	strcpy(pool[n - 1], "zz");
+	for (size_t i = 0 ; i < n ; ++i) {
+		strs[i] = pool[i];
+		perm[i] = i;
+		items[i] = (struct cstr_item){ cstr_key(pool[i]), pool[i] };
+	}
+	memcpy(ref, strs, n * sizeof(strs[0]));
+	qsort(ref, n, sizeof(ref[0]), cmp_cstr_qsort);
+	cstr_mkqsort(items, perm, n, 0, 1);
+	for (size_t i = 0 ; i < n ; ++i) {
+		if (strcmp(items[i].str, ref[i]) != 0 || items[i].str != strs[perm[i]]) {
+			TEST_ERRMSG("heapsort fallback mismatch at %zu", i);
+			++fails;
+			break;
+		}
+	}
+
+	const char *names[] = { "emma", "amanda", "julie", "ellie", "sarah", "emma" };
+	const char *names_expected[] = { "amanda", "ellie", "emma", "emma", "julie", "sarah" };
+	fails += sort_cstr(names, ARRAY_SIZE(names), SORT_CSTR_ASC) != 0;
+	for (size_t i = 0 ; i < ARRAY_SIZE(names) ; ++i) {
+		fails += strcmp(names[i], names_expected[i]) == 0 ? 0 : 1;
+	}
+
+	TEST_END();
+}
+
+GEN_SEARCH(search_ints, int, SORT_ARRAY_CMP_GT);
+GEN_SEARCH(search_ints_desc, int, SORT_ARRAY_CMP_LT);
+GEN_SEARCH(search_names, const char *, SORT_ARRAY_CMP_CSTR_ASC);
+GEN_EYTZINGER(eyt_ints, int, SORT_ARRAY_CMP_GT);
+GEN_SEARCH_DATA(search_perm, int, SORT_ARRAY_CMP_PERM_GT, const int *);
+GEN_EYTZINGER_DATA(eyt_perm, int, SORT_ARRAY_CMP_PERM_GT, const int *);
+
+static int test_search(void) {
+	TEST_START(search);
+
+	static int arr[3000];
+	static int eyt[ARRAY_SIZE(arr) + 1];
+	const size_t sizes[] = { 0, 1, 2, 3, 7, 8, 9, 100, 1023, 1024, ARRAY_SIZE(arr) };
+	uint32_t x = 0xFEED;
+
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t n = sizes[s];
+		for (size_t i = 0 ; i < n ; ++i) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			arr[i] = (int)(x % (2 * n + 1));
+		}
+		sort_ints(arr, n);
+		eyt_ints_build(eyt, arr, n);
+
+		for (int key = -1 ; key <= (int)(2 * n + 1) ; ++key) {
+			size_t lb = 0, ub = 0;
+			while (lb < n && arr[lb] < key)
+				++lb;
+			ub = lb;
+			while (ub < n && arr[ub] <= key)
+				++ub;
+			size_t got_lb = search_ints_lower_bound(arr, n, key);
+			size_t got_ub = search_ints_upper_bound(arr, n, key);
+			size_t eyt_lb = eyt_ints_lower_bound(eyt, n, key);
+			size_t eyt_ub = eyt_ints_upper_bound(eyt, n, key);
+			if (got_lb != lb || got_ub != ub) {
+				TEST_ERRMSG("n=%zu, key %d: got [%zu, %zu), expected [%zu, %zu)", n, key, got_lb, got_ub, lb, ub);
+				++fails;
+				break;
+			}
+			// Eytzinger order loses the index, so compare what it points at.
+			if ((eyt_lb == 0) != (lb == n) || (eyt_lb && eyt[eyt_lb] != arr[lb]) ||
+				(eyt_ub == 0) != (ub == n) || (eyt_ub && eyt[eyt_ub] != arr[ub])) {
+				TEST_ERRMSG("n=%zu, key %d: Eytzinger search mismatch", n, key);
+				++fails;
+				break;
+			}
+		}
+
+		// The same array descending, searched with the reverse comparator.
+		reverse_array(arr, n);
+		for (int key = -1 ; key <= (int)(2 * n + 1) ; ++key) {
+			size_t lb = 0;
+			while (lb < n && arr[lb] > key)
+				++lb;
+			if (search_ints_desc_lower_bound(arr, n, key) != lb) {
+				TEST_ERRMSG("n=%zu, key %d: descending lower bound mismatch", n, key);
+				++fails;
+				break;
+			}
+		}
+	}
+
+	// A permutation sorted by its keys. The key searched for goes in the spare slot at keys[n].
+	static int keys[1000 + 1];
+	static int perm[ARRAY_SIZE(keys) - 1];
+	static int eyt_p[ARRAY_SIZE(perm) + 1];
+	const size_t n = ARRAY_SIZE(perm);
+	for (size_t i = 0 ; i < n ; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		keys[i] = (int)(x % 500);
+		perm[i] = (int)i;
+	}
+	sort_perm(perm, n, keys);
+	eyt_perm_build(eyt_p, perm, n);
+	for (int key = -1 ; key <= 501 ; ++key) {
+		keys[n] = key;
+		size_t lb = 0, ub = 0;
+		while (lb < n && keys[perm[lb]] < key)
+			++lb;
+		ub = lb;
+		while (ub < n && keys[perm[ub]] <= key)
+			++ub;
+		size_t got_lb = search_perm_lower_bound(perm, n, (int)n, keys);
+		size_t got_ub = search_perm_upper_bound(perm, n, (int)n, keys);
+		size_t eyt_lb = eyt_perm_lower_bound(eyt_p, n, (int)n, keys);
+		size_t eyt_ub = eyt_perm_upper_bound(eyt_p, n, (int)n, keys);
+		if (got_lb != lb || got_ub != ub) {
+			TEST_ERRMSG("permutation, key %d: got [%zu, %zu), expected [%zu, %zu)", key, got_lb, got_ub, lb, ub);
+			++fails;
+			break;
+		}
+		if ((eyt_lb == 0) != (lb == n) || (eyt_lb && keys[eyt_p[eyt_lb]] != keys[perm[lb]]) ||
+			(eyt_ub == 0) != (ub == n) || (eyt_ub && keys[eyt_p[eyt_ub]] != keys[perm[ub]])) {
+			TEST_ERRMSG("permutation, key %d: Eytzinger search mismatch", key);
+			++fails;
+			break;
+		}
+	}
+
+	const char *names[] = { "amanda", "ellie", "emma", "emma", "julie", "sarah" };
+	fails += search_names_lower_bound(names, ARRAY_SIZE(names), "emma") != 2;
+	fails += search_names_upper_bound(names, ARRAY_SIZE(names), "emma") != 4;
+	fails += search_names_lower_bound(names, ARRAY_SIZE(names), "a") != 0;
+	fails += search_names_lower_bound(names, ARRAY_SIZE(names), "zoe") != 6;
+
+	TEST_END();
+}
 
 GEN_ROTATE_ARRAY_CB(rotate_int_array_cb, int);
 GEN_ROTATE_ARRAY_CB(rotate_tile_array_cb, struct tile_t);
@@ -155,6 +992,107 @@ static int test_rotate_array(void) {
 	TEST_END();
 }
 
+static int test_rotate_array_mem(void) {
+	TEST_START(rotate_array_mem);
+
+	int arr[16] = { 0 };
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(rotate_array_tests) ; ++i) {
+		const struct re re = rotate_array_tests[i];
+		size_t size = re.n * sizeof(re.input[0]);
+		assert(size <= sizeof(arr));
+		memcpy(arr, re.input, size);
+		rotate_array_mem(arr + re.offset, re.n, sizeof(arr[0]), re.d);
+		if (memcmp(arr, re.expected, size) != 0) {
+			fprintf(stderr, "test %zu failed\n", i);
+			++fails;
+		}
+	}
+
+	// Sizes and shifts that need block swaps, including near-halves that take many steps.
+	static uint8_t buf[3 * ROTATE_BUFFER_SIZE * 12];
+	static uint8_t ref[sizeof(buf)];
+	const size_t sizes[] = { 1, 2, 4, 12 };
+	for (size_t s = 0 ; s < ARRAY_SIZE(sizes) ; ++s) {
+		size_t size = sizes[s];
+		size_t n = sizeof(buf) / size - 3;
+		const ptrdiff_t shifts[] = { 1, -1, 17, (ptrdiff_t)n / 2 - 1, (ptrdiff_t)n / 2 + 1, (ptrdiff_t)n / 3, -(ptrdiff_t)n / 3, (ptrdiff_t)n - 5, 3 * (ptrdiff_t)n + 2 };
+		for (size_t k = 0 ; k < ARRAY_SIZE(shifts) ; ++k) {
+			for (size_t i = 0 ; i < n * size ; ++i)
+				buf[i] = i % 251;
+			ptrdiff_t dir = shifts[k];
+			size_t d = dir < 0 ? n - ((size_t)-dir % n) : (size_t)dir % n;
+			for (size_t i = 0 ; i < n ; ++i)
+				memcpy(ref + i * size, buf + ((i + d) % n) * size, size);
+			rotate_array_mem(buf, n, size, dir);
+			if (memcmp(buf, ref, n * size) != 0) {
+				TEST_ERRMSG("n=%zu, size %zu, dir %td: rotate mismatch", n, size, dir);
+				++fails;
+			}
+		}
+	}
+
+	TEST_END();
+}
+
+GEN_ROTATE_ARRAY_RANGE_CB(rotate_int_range_cb, int);
+GEN_ROTATE_ARRAY_RANGE_CB(rotate_tile_range_cb, struct tile_t);
+
+static size_t range_cb_calls;
+
+static void counting_range_cb(void *arr, size_t src, size_t dst, size_t count, enum rotate_range_action action, void *ctx) {
+	++range_cb_calls;
+	rotate_tile_range_cb(arr, src, dst, count, action, ctx);
+}
+
+static int test_rotate_array_range_cb(void) {
+	TEST_START(rotate_array_range_cb);
+
+	int arr[16] = { 0 };
+	int tmp[4];
+
+	for (size_t buf_count = 0 ; buf_count <= ARRAY_SIZE(tmp) ; buf_count += 2) {
+		for (size_t i = 0 ; i < ARRAY_SIZE(rotate_array_tests) ; ++i) {
+			const struct re re = rotate_array_tests[i];
+			size_t size = re.n * sizeof(re.input[0]);
+			assert(size <= sizeof(arr));
+			memcpy(arr, re.input, size);
+			rotate_array_range_cb(arr + re.offset, re.n, re.d, buf_count, rotate_int_range_cb, tmp);
+			if (memcmp(arr, re.expected, size) != 0) {
+				TEST_ERRMSG("test %zu with buf_count %zu failed", i, buf_count);
+				++fails;
+			}
+		}
+	}
+
+	// Larger structures against the juggling version. Every swap puts more than buf_count
+	// elements in place, which bounds the number of callbacks.
+	static struct tile_t tiles[10007];
+	static struct tile_t ref[ARRAY_SIZE(tiles)];
+	static struct tile_t tile_tmp[64];
+	const size_t n = ARRAY_SIZE(tiles);
+	const ptrdiff_t shifts[] = { 1, -1, 64, 65, (ptrdiff_t)n / 2, -(ptrdiff_t)n / 3, (ptrdiff_t)n - 1 };
+	for (size_t k = 0 ; k < ARRAY_SIZE(shifts) ; ++k) {
+		for (size_t i = 0 ; i < n ; ++i) {
+			tiles[i] = ref[i] = (struct tile_t){ .dummy = i, .x = i % 128 };
+		}
+		struct tile_t ctx;
+		rotate_array_cb(ref, n, shifts[k], rotate_tile_array_cb, &ctx);
+		range_cb_calls = 0;
+		rotate_array_range_cb(tiles, n, shifts[k], ARRAY_SIZE(tile_tmp), counting_range_cb, tile_tmp);
+		if (memcmp(tiles, ref, sizeof(tiles)) != 0) {
+			TEST_ERRMSG("shift %td: mismatch against rotate_array_cb", shifts[k]);
+			++fails;
+		}
+		if (range_cb_calls > n / ARRAY_SIZE(tile_tmp) + 3) {
+			TEST_ERRMSG("shift %td: too many callbacks, %zu", shifts[k], range_cb_calls);
+			++fails;
+		}
+	}
+
+	TEST_END();
+}
+
 static int test_rotate_array_cb(void) {
 	TEST_START(rotate_array_cb);
 
@@ -180,10 +1118,20 @@ int main(int UNUSED(argc), char UNUSED(*argv[])) {
 	size_t failed = 0;
 
 	failed += test_reverse_array();
+	failed += test_array_kernels();
 	failed += test_sort_array();
 	failed += test_sort_array_cmp_data();
+	failed += test_gen_sort();
+	failed += test_select();
+	failed += test_radix_sort();
+	failed += test_sort_small();
+	failed += test_parallel_sort();
+	failed += test_sort_cstr();
+	failed += test_search();
 	failed += test_rotate_array();
+	failed += test_rotate_array_mem();
 	failed += test_rotate_array_cb();
+	failed += test_rotate_array_range_cb();
 
 	if (failed != 0) {
 		printf("Tests " RED "FAILED" NC "\n");
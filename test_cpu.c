@@ -0,0 +1,71 @@
+/*
+	Tests for CPU Feature Dispatch
+	Copyright (c) 2023, Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#include "ecpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+
+static int test_cpu_level(void) {
+	TEST_START(cpu_level);
+
+	// Whatever the cached level is, it's shown so runs forcing a level can be told apart.
+	int level = cpu_level();
+	printf("CPU level '%s'\n", cpu_level_name(level));
+	fails += level < CPU_BASELINE || level >= CPU_LEVELS;
+	fails += cpu_level() != level;
+
+	fails += strcmp(cpu_level_name(CPU_BASELINE), "baseline") != 0;
+	fails += strcmp(cpu_level_name(CPU_SSE42), "sse42") != 0;
+	fails += strcmp(cpu_level_name(CPU_AVX512), "avx512") != 0;
+	fails += strcmp(cpu_level_name(CPU_LEVELS), "unknown") != 0;
+	fails += strcmp(cpu_level_name(-1), "unknown") != 0;
+
+	// EUTILS_CPU can only lower the level, and unknown names are ignored.
+	const char *env = getenv("EUTILS_CPU");
+	char *saved = env ? strdup(env) : NULL;
+	unsetenv("EUTILS_CPU");
+	int hw = cpu_detect_level();
+	fails += level > hw;
+	for (int i = 0 ; i < CPU_LEVELS ; ++i) {
+		setenv("EUTILS_CPU", cpu_level_name(i), 1);
+		int forced = cpu_detect_level();
+		if (forced != (i < hw ? i : hw)) {
+			TEST_ERRMSG("EUTILS_CPU=%s gave level %d on a level %d CPU", cpu_level_name(i), forced, hw);
+			++fails;
+		}
+	}
+	setenv("EUTILS_CPU", "sse9", 1);
+	fails += cpu_detect_level() != hw;
+
+	if (saved) {
+		setenv("EUTILS_CPU", saved, 1);
+		free(saved);
+	} else {
+		unsetenv("EUTILS_CPU");
+	}
+
+	TEST_END();
+}
+
+int main(int UNUSED(argc), char UNUSED(*argv[])) {
+	size_t failed = 0;
+
+	failed += test_cpu_level();
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
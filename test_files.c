@@ -0,0 +1,174 @@
+/*
+	Batched File Loading Tests
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "estrings.h"
+#include "efiles.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+
+// More than fits in the ring at once, to exercise resubmission.
+#define NUM_SMALL 300
+#define BIG_SIZE (3 * 1024 * 1024 + 17)
+
+static int write_file(const char *filename, const char *data, size_t len) {
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return -1;
+	size_t written = fwrite(data, 1, len, f);
+	return (fclose(f) == 0 && written == len) ? 0 : -1;
+}
+
+static int test_read_files_flags(const char *dir, int flags) {
+	TEST_START(read_files);
+
+	enum { F_LICENSE, F_MISSING, F_PROC, F_EMPTY, F_BIG, F_SMALL, NUM_FILES = F_SMALL + NUM_SMALL };
+	static char paths[NUM_FILES][64];
+	const char *names[NUM_FILES];
+
+	names[F_LICENSE] = "LICENSE";
+	names[F_MISSING] = "this-file-does-not-exist";
+	names[F_PROC] = "/proc/self/status";
+	snprintf(paths[F_EMPTY], sizeof(paths[0]), "%s/empty", dir);
+	snprintf(paths[F_BIG], sizeof(paths[0]), "%s/big", dir);
+	names[F_EMPTY] = paths[F_EMPTY];
+	names[F_BIG] = paths[F_BIG];
+	for (size_t i = 0 ; i < NUM_SMALL ; ++i) {
+		snprintf(paths[F_SMALL + i], sizeof(paths[0]), "%s/small%zu", dir, i);
+		names[F_SMALL + i] = paths[F_SMALL + i];
+	}
+
+	struct file_blob out[NUM_FILES];
+	size_t failed = read_files(names, NUM_FILES, out, flags);
+
+	if (failed != 1) {
+		TEST_ERRMSG("Expected exactly one failure, got %zu", failed);
+		++fails;
+	}
+
+	if (!out[F_LICENSE].data || out[F_LICENSE].len != 1079 || strlen(out[F_LICENSE].data) != 1079 || !strstr(out[F_LICENSE].data, "SOFTWARE.")) {
+		TEST_ERRMSG("LICENSE contents mismatch");
+		++fails;
+	}
+
+	if (out[F_MISSING].data || out[F_MISSING].err != ENOENT) {
+		TEST_ERRMSG("Expected ENOENT for missing file, got err=%d", out[F_MISSING].err);
+		++fails;
+	}
+
+	if (!out[F_PROC].data || out[F_PROC].len == 0 || strstr(out[F_PROC].data, "Name:") != out[F_PROC].data) {
+		TEST_ERRMSG("Zero-sized procfs file not read");
+		++fails;
+	}
+
+	if (!out[F_EMPTY].data || out[F_EMPTY].len != 0 || out[F_EMPTY].data[0] != 0) {
+		TEST_ERRMSG("Empty file not read as empty string");
+		++fails;
+	}
+
+	const char *big = out[F_BIG].data;
+	if (!big || out[F_BIG].len != BIG_SIZE || big[BIG_SIZE] != 0) {
+		TEST_ERRMSG("Big file size mismatch, got %zu", out[F_BIG].len);
+		++fails;
+	} else {
+		for (size_t i = 0 ; i < BIG_SIZE ; ++i) {
+			if (big[i] != (char)('a' + i % 23)) {
+				TEST_ERRMSG("Big file contents mismatch at offset %zu", i);
+				++fails;
+				break;
+			}
+		}
+	}
+
+	for (size_t i = 0 ; i < NUM_SMALL ; ++i) {
+		char expected[32];
+		int len = snprintf(expected, sizeof(expected), "small file %zu\n", i);
+		const struct file_blob *blob = &out[F_SMALL + i];
+		if (blob->err || !blob->data || blob->len != (size_t)len || strcmp(blob->data, expected) != 0) {
+			TEST_ERRMSG("Small file %zu mismatch, err=%d", i, blob->err);
+			++fails;
+			break;
+		}
+	}
+
+	read_files_free(out, NUM_FILES);
+
+	TEST_END();
+}
+
+static int test_read_files(void) {
+	int fails = 0;
+
+	char dir[] = "/tmp/eutils_test_XXXXXX";
+	if (!mkdtemp(dir)) {
+		fprintf(stderr, "Creating temporary directory failed\n");
+		return 1;
+	}
+
+	char name[64];
+	char *big = malloc(BIG_SIZE);
+	for (size_t i = 0 ; i < BIG_SIZE ; ++i) {
+		big[i] = 'a' + i % 23;
+	}
+	snprintf(name, sizeof(name), "%s/big", dir);
+	fails += write_file(name, big, BIG_SIZE) != 0;
+	free(big);
+
+	snprintf(name, sizeof(name), "%s/empty", dir);
+	fails += write_file(name, "", 0) != 0;
+
+	for (size_t i = 0 ; i < NUM_SMALL ; ++i) {
+		char data[32];
+		int len = snprintf(data, sizeof(data), "small file %zu\n", i);
+		snprintf(name, sizeof(name), "%s/small%zu", dir, i);
+		fails += write_file(name, data, len) != 0;
+	}
+
+	if (fails == 0) {
+		fails += test_read_files_flags(dir, 0);
+		fails += test_read_files_flags(dir, READFILES_SLAB);
+		fails += test_read_files_flags(dir, READFILES_NO_URING);
+		fails += test_read_files_flags(dir, READFILES_NO_URING | READFILES_SLAB);
+	} else {
+		fprintf(stderr, "Creating test files failed\n");
+	}
+
+	snprintf(name, sizeof(name), "%s/big", dir);
+	unlink(name);
+	snprintf(name, sizeof(name), "%s/empty", dir);
+	unlink(name);
+	for (size_t i = 0 ; i < NUM_SMALL ; ++i) {
+		snprintf(name, sizeof(name), "%s/small%zu", dir, i);
+		unlink(name);
+	}
+	rmdir(dir);
+
+	return fails;
+}
+
+int main(int UNUSED(argc), char UNUSED(*argv[])) {
+	size_t failed = 0;
+
+	failed += test_read_files(); // Requires 'LICENSE' file to be available in current directory.
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
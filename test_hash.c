@@ -0,0 +1,156 @@
+/*
+	Checksum and Hashing Tests
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "ehash.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+
+static void fill_random(uint8_t *buf, size_t len, uint64_t seed) {
+	for (size_t i = 0 ; i < len ; ++i) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		buf[i] = seed >> 56;
+	}
+}
+
+// Bitwise reference.
+static uint32_t crc32c_ref(const uint8_t *p, size_t len) {
+	uint32_t c = ~0U;
+	for (size_t i = 0 ; i < len ; ++i) {
+		c ^= p[i];
+		for (int k = 0 ; k < 8 ; ++k)
+			c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+	}
+	return ~c;
+}
+
+static int test_crc32c(void) {
+	TEST_START(crc32c);
+
+	// Check value, and RFC 3720 B.4 vectors.
+	fails += crc32c(0, "123456789", 9) != 0xE3069283;
+	fails += crc32c_sw(0, "123456789", 9) != 0xE3069283;
+	uint8_t v[32];
+	memset(v, 0, sizeof(v));
+	fails += crc32c(0, v, sizeof(v)) != 0x8A9136AA;
+	memset(v, 0xFF, sizeof(v));
+	fails += crc32c(0, v, sizeof(v)) != 0x62A8AB43;
+	for (size_t i = 0 ; i < sizeof(v) ; ++i)
+		v[i] = i;
+	fails += crc32c(0, v, sizeof(v)) != 0x46DD794E;
+	fails += crc32c(0, NULL, 0) != 0;
+
+	// Every length and misalignment across the three-way block sizes.
+	const size_t max_len = 3 * 2048 * 2 + 3 * 128 + 100;
+	uint8_t *buf = malloc(max_len + 8);
+	fill_random(buf, max_len + 8, 0x5EED);
+	for (size_t len = 0 ; len <= max_len ; len += len < 1000 ? 1 : 37) {
+		const uint8_t *p = buf + len % 8;
+		uint32_t expected = crc32c_ref(p, len);
+		uint32_t hw = crc32c(0, p, len);
+		uint32_t sw = crc32c_sw(0, p, len);
+		if (hw != expected || sw != expected) {
+			TEST_ERRMSG("length %zu: got %08x and %08x, expected %08x", len, hw, sw, expected);
+			++fails;
+			break;
+		}
+	}
+
+	// Chaining, and combining separately computed parts.
+	size_t total = max_len;
+	uint32_t whole = crc32c(0, buf, total);
+	for (size_t split = 0 ; split <= total ; split += 1237) {
+		uint32_t a = crc32c(0, buf, split);
+		uint32_t b = crc32c(0, buf + split, total - split);
+		fails += crc32c(a, buf + split, total - split) != whole;
+		if (crc32c_combine(a, b, total - split) != whole) {
+			TEST_ERRMSG("combine at %zu failed", split);
+			++fails;
+		}
+	}
+
+	// Long runs of zeros, covering more bits of the length, and combining is associative.
+	const size_t zlen = (1 << 20) + 4093;
+	uint8_t *zeros = calloc(zlen, 1);
+	uint32_t a = crc32c(0, buf, 1000);
+	uint32_t z = crc32c(0, zeros, zlen);
+	fails += crc32c_combine(a, z, zlen) != crc32c(a, zeros, zlen);
+	uint32_t b = crc32c(0, buf + 1000, 1000);
+	size_t n1 = SIZE_MAX / 5 + 12345, n2 = SIZE_MAX / 7 + 777;
+	fails += crc32c_combine(crc32c_combine(a, b, n1), whole, n2) != crc32c_combine(a, crc32c_combine(b, whole, n2), n1 + n2);
+	free(zeros);
+	free(buf);
+
+	TEST_END();
+}
+
+static int test_hash64(void) {
+	TEST_START(hash64);
+
+	uint8_t buf[300];
+	fill_random(buf, sizeof(buf), 1);
+
+	fails += hash64(buf, 100, 0) != hash64(buf, 100, 0);
+	fails += hash64(buf, 100, 0) == hash64(buf, 100, 1);
+	fails += hash64(NULL, 0, 0) == hash64(NULL, 0, 1);
+
+	// Every prefix, including the ones only differing in length, hashes differently.
+	uint64_t h[sizeof(buf) + 1];
+	memset(buf + 100, 0, 100);
+	for (size_t len = 0 ; len <= sizeof(buf) ; ++len) {
+		h[len] = hash64(buf, len, 0);
+		for (size_t j = 0 ; j < len ; ++j) {
+			if (h[j] == h[len]) {
+				TEST_ERRMSG("prefixes of length %zu and %zu collide", j, len);
+				++fails;
+				break;
+			}
+		}
+	}
+
+	// Avalanche: flipping any input bit flips about half the output bits, for each size class.
+	static const size_t lens[] = { 3, 8, 16, 40, 100, 200 };
+	for (size_t l = 0 ; l < ARRAY_SIZE(lens) ; ++l) {
+		size_t len = lens[l];
+		uint64_t base = hash64(buf, len, 0);
+		size_t flipped = 0;
+		for (size_t bit = 0 ; bit < len * 8 ; ++bit) {
+			buf[bit / 8] ^= 1 << (bit % 8);
+			flipped += __builtin_popcountll(hash64(buf, len, 0) ^ base);
+			buf[bit / 8] ^= 1 << (bit % 8);
+		}
+		double avg = (double)flipped / (double)(len * 8);
+		if (avg < 28 || avg > 36) {
+			TEST_ERRMSG("length %zu: %.1f output bits flipped on average", len, avg);
+			++fails;
+		}
+	}
+
+	TEST_END();
+}
+
+int main(int UNUSED(argc), char UNUSED(*argv[])) {
+	size_t failed = 0;
+
+	failed += test_crc32c();
+	failed += test_hash64();
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
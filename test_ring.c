@@ -0,0 +1,196 @@
+/*
+	Ring Buffer Tests
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+*/
+#define _GNU_SOURCE
+#define EUTILS_IMPLEMENTATION
+#include "ering.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+
+#define SPSC_BYTES (8 * 1024 * 1024)
+
+static int test_ring_basic(int flags) {
+	TEST_START(ring_basic);
+
+	struct ring r;
+	if (ring_init(&r, 1000, flags) != 0) {
+		TEST_ERRMSG("ring_init failed");
+		return 1;
+	}
+	fails += r.cap < 1000 || (r.cap & (r.cap - 1)) != 0;
+	fails += (flags & RING_NO_MIRROR) && r.mirrored;
+
+	if (r.mirrored) {
+		// The second mapping aliases the first.
+		r.buf[r.cap + 5] = 'M';
+		fails += r.buf[5] != 'M';
+	}
+
+	// Move the cursors close to the end, so the next windows straddle it.
+	size_t avail;
+	uint8_t *w = ring_write_begin(&r, &avail);
+	fails += avail != r.cap;
+	ring_write_commit(&r, r.cap - 10);
+	ring_read_begin(&r, &avail);
+	fails += avail != r.cap - 10;
+	ring_read_commit(&r, avail);
+
+	w = ring_write_begin(&r, &avail);
+	fails += avail != r.cap;
+	for (size_t i = 0 ; i < 100 ; ++i)
+		w[i] = i;
+	ring_write_commit(&r, 100);
+
+	const uint8_t *rd = ring_read_begin(&r, &avail);
+	fails += avail != 100;
+	for (size_t i = 0 ; i < avail ; ++i) {
+		if (rd[i] != i) {
+			TEST_ERRMSG("wrapped window mismatch at %zu", i);
+			++fails;
+			break;
+		}
+	}
+	ring_read_commit(&r, 40);
+
+	// The copying interface, across the end again.
+	uint8_t src[300], dst[300];
+	for (size_t i = 0 ; i < sizeof(src) ; ++i)
+		src[i] = 255 - i;
+	fails += ring_write(&r, src, sizeof(src)) != sizeof(src);
+	fails += ring_read(&r, dst, 60) != 60;
+	for (size_t i = 0 ; i < 60 ; ++i)
+		fails += dst[i] != 40 + i;
+	fails += ring_read(&r, dst, sizeof(dst)) != sizeof(src);
+	fails += memcmp(dst, src, sizeof(src)) != 0;
+	fails += ring_read(&r, dst, sizeof(dst)) != 0;
+
+	// Full ring.
+	fails += ring_write(&r, NULL, 0) != 0;
+	ring_write_begin(&r, &avail);
+	ring_write_commit(&r, avail);
+	ring_write_begin(&r, &avail);
+	fails += avail != 0;
+
+	ring_free(&r);
+
+	TEST_END();
+}
+
+struct spsc {
+	struct ring *r;
+	int fails;
+};
+
+// Writes a byte sequence in chunks of varying size, through both interfaces.
+// Both sides yield when blocked, so this also runs well on a single CPU.
+static void *spsc_producer(void *arg) {
+	struct spsc *s = arg;
+	uint8_t chunk[777];
+	size_t sent = 0;
+	for (size_t k = 0 ; sent < SPSC_BYTES ; ++k) {
+		size_t want = MIN((size_t)(k * 131 % 777 + 1), (size_t)(SPSC_BYTES - sent));
+		if (k % 2) {
+			for (size_t i = 0 ; i < want ; ++i)
+				chunk[i] = (sent + i) % 251;
+			size_t n = ring_write(s->r, chunk, want);
+			if (n == 0)
+				sched_yield();
+			sent += n;
+		} else {
+			size_t avail;
+			uint8_t *w = ring_write_begin(s->r, &avail);
+			size_t n = MIN(want, avail);
+			for (size_t i = 0 ; i < n ; ++i)
+				w[i] = (sent + i) % 251;
+			ring_write_commit(s->r, n);
+			if (n == 0)
+				sched_yield();
+			sent += n;
+		}
+	}
+	return NULL;
+}
+
+static void *spsc_consumer(void *arg) {
+	struct spsc *s = arg;
+	uint8_t chunk[1000];
+	size_t received = 0;
+	for (size_t k = 0 ; received < SPSC_BYTES ; ++k) {
+		if (k % 2) {
+			size_t n = ring_read(s->r, chunk, k % sizeof(chunk) + 1);
+			for (size_t i = 0 ; i < n ; ++i)
+				s->fails += chunk[i] != (received + i) % 251;
+			if (n == 0)
+				sched_yield();
+			received += n;
+		} else {
+			size_t avail;
+			const uint8_t *rd = ring_read_begin(s->r, &avail);
+			for (size_t i = 0 ; i < avail ; ++i)
+				s->fails += rd[i] != (received + i) % 251;
+			ring_read_commit(s->r, avail);
+			if (avail == 0)
+				sched_yield();
+			received += avail;
+		}
+	}
+	return NULL;
+}
+
+static int test_ring_spsc(int flags) {
+	TEST_START(ring_spsc);
+
+	struct ring r;
+	if (ring_init(&r, 4096, flags) != 0) {
+		TEST_ERRMSG("ring_init failed");
+		return 1;
+	}
+
+	struct spsc s = { .r = &r };
+	pthread_t producer;
+	if (pthread_create(&producer, NULL, spsc_producer, &s) != 0) {
+		TEST_ERRMSG("pthread_create failed");
+		ring_free(&r);
+		return 1;
+	}
+	spsc_consumer(&s);
+	pthread_join(producer, NULL);
+
+	if (s.fails) {
+		TEST_ERRMSG("%d bytes out of sequence (mirrored=%d)", s.fails, r.mirrored);
+		++fails;
+	}
+
+	ring_free(&r);
+
+	TEST_END();
+}
+
+int main(int UNUSED(argc), char UNUSED(*argv[])) {
+	size_t failed = 0;
+
+	failed += test_ring_basic(0);
+	failed += test_ring_basic(RING_NO_MIRROR);
+	failed += test_ring_spsc(0);
+	failed += test_ring_spsc(RING_NO_MIRROR);
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
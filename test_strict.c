@@ -0,0 +1,85 @@
+/*
+	Strict Build Tests
+	Copyright (c) 2023 Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/eutils
+
+	Built with -std=c11 and without _GNU_SOURCE, to catch headers that depend on GNU or
+	BSD extensions without a fallback. The Makefile also checks that it compiles without
+	any feature test macros, in which case efiles.h, which needs POSIX, is left out.
+*/
+#define EUTILS_IMPLEMENTATION
+#include "ecpu.h"
+#include "earena.h"
+#include "earrays.h"
+#include "estrings.h"
+#include "ehash.h"
+#include "ering.h"
+#ifdef _XOPEN_SOURCE
+#include "efiles.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacros.h"
+#include "internal/tests.h"
+
+static int test_strict_build(void) {
+	TEST_START(strict_build);
+
+	printf("CPU level '%s'\n", cpu_level_name(cpu_level()));
+
+	// Anonymous mappings may not be available, which must fail cleanly.
+	struct arena a;
+	if (arena_init_reserve(&a, 1 << 20) == 0) {
+		fails += arena_alloc(&a, 100) == NULL;
+		arena_free(&a);
+	} else if (errno != ENOSYS) {
+		TEST_ERRMSG("arena_init_reserve failed: %s", strerror(errno));
+		++fails;
+	}
+
+	size_t len = 0;
+	char *data = read_entire_file("LICENSE", &len);
+	fails += data == NULL || len == 0;
+	free(data);
+
+	fails += crc32c(0, "123456789", 9) != 0xE3069283;
+
+	struct ring r;
+	char out[6];
+	if (ring_init(&r, 4096, 0) == 0) {
+		fails += ring_write(&r, "strict", 6) != 6;
+		fails += ring_read(&r, out, 6) != 6 || memcmp(out, "strict", 6) != 0;
+		ring_free(&r);
+	} else {
+		TEST_ERRMSG("ring_init failed: %s", strerror(errno));
+		++fails;
+	}
+
+#ifdef _XOPEN_SOURCE
+	const char *names[] = { "LICENSE" };
+	struct file_blob blob;
+	fails += read_files(names, 1, &blob, 0) != 0 || blob.len != len;
+	read_files_free(&blob, 1);
+#endif
+
+	TEST_END();
+}
+
+int main(int UNUSED(argc), char UNUSED(*argv[])) {
+	size_t failed = 0;
+
+	failed += test_strict_build();
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -4,6 +4,7 @@
 
 	See https://github.com/eloj/eutils
 */
+#define _GNU_SOURCE
 #define EUTILS_IMPLEMENTATION
 #include "estrings.h"
 
@@ -12,6 +13,10 @@
 #include <stddef.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
 
 #include "emacros.h"
 #include "internal/tests.h"
@@ -89,6 +94,393 @@ static int test_expand_escapes(void) {
 		}
 	}
 
+	// Escapes around the SIMD block boundaries, in otherwise long plain runs.
+	char input[256];
+	char expected[256];
+	const size_t positions[] = { 0, 1, 30, 31, 32, 33, 63, 64, 95 };
+	for (size_t i = 0 ; i < ARRAY_SIZE(positions) ; ++i) {
+		size_t pos = positions[i];
+		memset(input, 'a', 100);
+		memcpy(input + pos, "\\x41", 4);
+		memset(expected, 'a', 97);
+		expected[pos] = 'A';
+
+		int err;
+		size_t res = expand_escapes(input, 100, NULL, 0, &err);
+		if (err != 0 || res != 97) {
+			TEST_ERRMSG("escape at %zu: length-determination failed, err '%d', got '%zu'.", pos, err, res);
+			++fails;
+		}
+		memset(buf, '#', sizeof(buf));
+		res = expand_escapes(input, 100, buf, sizeof(buf), &err);
+		if (err != 0 || res != 97 || memcmp(buf, expected, res) != 0 || buf[res] != '#') {
+			TEST_ERRMSG("escape at %zu: expansion failed, err '%d', got '%zu'.", pos, err, res);
+			++fails;
+		}
+
+		// Nothing is written past the last plain character before an invalid escape.
+		memcpy(input + pos, "\\q", 2);
+		memset(buf, '#', sizeof(buf));
+		res = expand_escapes(input, 100, buf, sizeof(buf), &err);
+		if (err != ESC_ERROR_CHAR || res != pos || memchr(buf + pos, 'a', 100 - pos) != NULL) {
+			TEST_ERRMSG("error at %zu: err '%d', got '%zu', or output written past it.", pos, err, res);
+			++fails;
+		}
+	}
+
+	// Output is silently truncated at dlen, and errors beyond that point are not reported.
+	int err;
+	memset(buf, 0, sizeof(buf));
+	size_t res = expand_escapes("abc\\x41def\\q", 13, buf, 5, &err);
+	if (err != 0 || res != 5 || memcmp(buf, "abcAd", 6) != 0) {
+		TEST_ERRMSG("truncated expansion failed, err '%d', got '%zu'.", err, res);
+		++fails;
+	}
+
+	TEST_END();
+}
+
+static int test_hex_encode(void) {
+	TEST_START(hex_encode);
+
+	uint8_t data[100];
+	char out[2*sizeof(data)];
+	char expected[2*sizeof(data) + 1];
+
+	for (size_t i = 0 ; i < sizeof(data) ; ++i) {
+		data[i] = i * 0x97 + 0x0f;
+	}
+
+	// Lengths around the SIMD block size.
+	const size_t lens[] = { 0, 1, 31, 32, 33, 64, 65, sizeof(data) };
+	for (size_t t = 0 ; t < ARRAY_SIZE(lens) ; ++t) {
+		size_t len = lens[t];
+		for (size_t i = 0 ; i < len ; ++i) {
+			snprintf(expected + 2*i, 3, "%02x", data[i]);
+		}
+		size_t res = hex_encode(data, len, out);
+		if (res != 2*len) {
+			TEST_ERRMSG("length %zu: expected '%zu' chars, got '%zu'.", len, 2*len, res);
+			++fails;
+		} else if (memcmp(out, expected, res) != 0) {
+			TEST_ERRMSG("length %zu: output mismatch, got '%.*s'.", len, (int)res, out);
+			++fails;
+		}
+	}
+
+	TEST_END();
+}
+
+struct fprint_hex_test {
+	const char *input;
+	size_t len;
+	int width;
+	const char *indent;
+	int flags;
+	const char *expected_output;
+};
+
+static int test_fprint_hex(void) {
+	TEST_START(fprint_hex);
+	char buf[1024];
+
+	struct fprint_hex_test tests[] = {
+		{ "", 0, 4, "\n", HEX_OFFSET, "" },
+		{ "\x01\xAB", 2, 4, NULL, 0, "01 ab" },
+		{ "ABCDEF", 6, 4, NULL, 0, "41 42 43 44 45 46" },
+		{ "ABCDEF", 6, 4, "", HEX_OFFSET, "00000000: 41 42 43 44 00000004: 45 46" },
+		{ "ABCDEF", 6, 4, "\n", HEX_OFFSET, "00000000: 41 42 43 44\n00000004: 45 46" },
+		{ "ABCDEFGH", 8, 4, "\n  ", 0, "41 42 43 44\n  45 46 47 48" },
+		{ "AB\nDEF", 6, 4, "\n", HEX_OFFSET | HEX_ASCII,
+			"00000000: 41 42 0a 44  |AB.D|\n"
+			"00000004: 45 46        |EF|" },
+	};
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(tests) ; ++i) {
+		struct fprint_hex_test *test = &tests[i];
+		FILE *f = tmpfile();
+		if (!f) {
+			TEST_ERRMSG("tmpfile() failed.");
+			++fails;
+			break;
+		}
+		fprint_hex(f, (const uint8_t*)test->input, test->len, test->width, test->indent, test->flags);
+		rewind(f);
+		size_t res = fread(buf, 1, sizeof(buf) - 1, f);
+		buf[res] = 0;
+		fclose(f);
+
+		if (strcmp(buf, test->expected_output) != 0) {
+			TEST_ERRMSG("test %zu: output mismatch, expected '%s', got '%s'.", i, test->expected_output, buf);
+			++fails;
+		}
+	}
+
+	// Rows larger than the internal format buffer.
+	uint8_t big[3000];
+	static char bigbuf[3*sizeof(big)];
+	for (size_t i = 0 ; i < sizeof(big) ; ++i) {
+		big[i] = i;
+	}
+	FILE *f = tmpfile();
+	if (f) {
+		fprint_hex(f, big, sizeof(big), 2000, "\n", 0);
+		rewind(f);
+		size_t res = fread(bigbuf, 1, sizeof(bigbuf), f);
+		fclose(f);
+		if (res != 3*sizeof(big) - 1) {
+			TEST_ERRMSG("wide rows: expected %zu chars, got %zu.", 3*sizeof(big) - 1, res);
+			++fails;
+		}
+		for (size_t i = 0 ; i < sizeof(big) && i*3 + 1 < res ; ++i) {
+			char sep = i == sizeof(big) - 1 ? 0 : (i == 1999 ? '\n' : ' ');
+			if (bigbuf[i*3] != hex_pairs[2*big[i]] || bigbuf[i*3+1] != hex_pairs[2*big[i]+1] || (sep && bigbuf[i*3+2] != sep)) {
+				TEST_ERRMSG("wide rows: mismatch at byte %zu.", i);
+				++fails;
+				break;
+			}
+		}
+	}
+
+	// Large offsets must not be truncated.
+	size_t offset_len = hexfmt_offset(buf, 0x123456789);
+	if (offset_len != 11 || memcmp(buf, "123456789: ", offset_len) != 0) {
+		TEST_ERRMSG("offset formatting mismatch, got '%.*s'.", (int)offset_len, buf);
+		++fails;
+	}
+
+	TEST_END();
+}
+
+struct hex_decode_test {
+	const char *input;
+	const char *expected_output;
+	size_t expected_len;
+	int expected_err;
+	int flags; // -1 for hex_decode(), otherwise hex_decode_dump() flags.
+};
+
+static int test_hex_decode(void) {
+	TEST_START(hex_decode);
+	uint8_t buf[256];
+
+	struct hex_decode_test tests[] = {
+		// Expected pass tests:
+		{ "", "", 0, 0, -1 },
+		{ "00", "\0", 1, 0, -1 },
+		{ "4142aBfF", "AB\xAB\xFF", 4, 0, -1 },
+		{ "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+			"\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+			"\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f", 32, 0, -1 },
+		{ "41 42\n43", "ABC", 3, 0, 0 },
+		{ "00000000: 41 42\n00000002: 43", "ABC", 3, 0, HEX_OFFSET },
+		{ "123456789: 41", "A", 1, 0, HEX_OFFSET },
+		{ "00000000: 7c 42  ||B|\n00000002: 43     |C|", "|BC", 3, 0, HEX_OFFSET | HEX_ASCII },
+		// Expected error tests, expected_len is the error position:
+		{ "4", "", 0, ESC_ERROR, -1 },
+		{ "414", "", 2, ESC_ERROR, -1 },
+		{ "4g", "", 1, ESC_ERROR_HEX, -1 },
+		{ "41 42", "", 2, ESC_ERROR_HEX, -1 },
+		{ "00000000000000000000000000000000000000000000000000000000000000x0", "", 62, ESC_ERROR_HEX, -1 },
+		{ "41 4", "", 3, ESC_ERROR, 0 },
+		{ "41 4x", "", 4, ESC_ERROR_HEX, 0 },
+		{ "41 x", "", 3, ESC_ERROR_HEX, 0 },
+		{ "00000000: 41", "", 8, ESC_ERROR_HEX, 0 },
+		{ "41  |AB|", "", 4, ESC_ERROR, HEX_ASCII },
+	};
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(tests) ; ++i) {
+		struct hex_decode_test *test = &tests[i];
+		size_t len = strlen(test->input);
+		int err;
+
+		for (int sizing = 1 ; sizing >= 0 ; --sizing) {
+			uint8_t *out = sizing ? NULL : buf;
+			size_t res = test->flags < 0 ? hex_decode(test->input, len, out, &err) : hex_decode_dump(test->input, len, out, &err, test->flags);
+			if (err != test->expected_err) {
+				TEST_ERRMSG("test %zu: unexpected error, expected '%d', got '%d' (position %zu).", i, test->expected_err, err, res);
+				++fails;
+				break;
+			}
+			if (res != test->expected_len) {
+				TEST_ERRMSG("test %zu: expected result '%zu', got '%zu'.", i, test->expected_len, res);
+				++fails;
+				break;
+			}
+			if (out && err == 0 && memcmp(out, test->expected_output, res) != 0) {
+				TEST_ERRMSG("test %zu: output buffer contents mismatch.", i);
+				++fails;
+			}
+		}
+	}
+
+	// Round-trip fprint_hex output.
+	uint8_t data[200];
+	for (size_t i = 0 ; i < sizeof(data) ; ++i) {
+		data[i] = i * 0x3b + 7;
+	}
+	const int flag_sets[] = { 0, HEX_OFFSET, HEX_ASCII, HEX_OFFSET | HEX_ASCII };
+	for (size_t i = 0 ; i < ARRAY_SIZE(flag_sets) ; ++i) {
+		static char dump[4096];
+		FILE *f = tmpfile();
+		if (!f)
+			break;
+		fprint_hex(f, data, sizeof(data), 16, "\n\t", flag_sets[i]);
+		rewind(f);
+		size_t dump_len = fread(dump, 1, sizeof(dump), f);
+		fclose(f);
+
+		int err;
+		size_t res = hex_decode_dump(dump, dump_len, buf, &err, flag_sets[i]);
+		if (err != 0 || res != sizeof(data) || memcmp(buf, data, sizeof(data)) != 0) {
+			TEST_ERRMSG("round-trip with flags %d failed, err '%d', result '%zu'.", flag_sets[i], err, res);
+			++fails;
+		}
+	}
+
+	TEST_END();
+}
+
+// Feed input to an escape_stream in chunks of at most chunk bytes, into an output buffer of at most olen bytes per call.
+static size_t stream_expand(const char *input, size_t slen, size_t chunk, size_t olen, char *dest, int *err) {
+	struct escape_stream es;
+	escape_stream_init(&es);
+	size_t rp = 0;
+	size_t wp = 0;
+
+	while (rp < slen) {
+		size_t n = slen - rp < chunk ? slen - rp : chunk;
+		size_t consumed = 0;
+		size_t res = escape_stream_feed(&es, input + rp, n, &consumed, dest + wp, olen, err);
+		if (*err)
+			return res;
+		rp += consumed;
+		wp += res;
+	}
+	size_t res = escape_stream_finish(&es, dest + wp, olen, err);
+	if (*err)
+		return res;
+	return wp + res;
+}
+
+static int test_escape_stream(void) {
+	TEST_START(escape_stream);
+	char buf[1024];
+	char expected[1024];
+
+	const char *inputs[] = {
+		"", "A", "\\xFF", "A\\x40A", "\\0", "\\1\\32\\128", "\\\"", "\\a\\b\\f\\n\\r\\t\\v",
+		"abc\\x4Fdef\\12x\\255\\1\\9a", "\\25\\250\\x0", "trailing\\12",
+		"\\", "\\x", "\\x8", "\\xfz", "\\256", "\\?", "ok\\x4g", "abc\\999",
+	};
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(inputs) ; ++i) {
+		size_t slen = strlen(inputs[i]);
+		int expected_err;
+		size_t expected_res = expand_escapes(inputs[i], slen, expected, sizeof(expected), &expected_err);
+
+		for (size_t chunk = 1 ; chunk <= slen + 1 ; ++chunk) {
+			for (size_t olen = 1 ; olen <= 3 ; ++olen) {
+				int err;
+				size_t res = stream_expand(inputs[i], slen, chunk, olen, buf, &err);
+				if (err != expected_err || res != expected_res || (!err && memcmp(buf, expected, res) != 0)) {
+					TEST_ERRMSG("input %zu, chunk size %zu, output size %zu: expected '%zu' (err %d), got '%zu' (err %d).",
+						i, chunk, olen, expected_res, expected_err, res, err);
+					++fails;
+					chunk = slen + 1;
+					break;
+				}
+			}
+		}
+	}
+
+	// Sizing mode
+	struct escape_stream es;
+	escape_stream_init(&es);
+	size_t consumed;
+	int err;
+	size_t res = escape_stream_feed(&es, "ab\\x", 4, &consumed, NULL, 0, &err);
+	res += escape_stream_feed(&es, "41c\\1", 5, &consumed, NULL, 0, &err);
+	res += escape_stream_finish(&es, NULL, 0, &err);
+	if (err != 0 || res != 5) {
+		TEST_ERRMSG("sizing: expected '5', got '%zu' (err %d).", res, err);
+		++fails;
+	}
+
+	TEST_END();
+}
+
+static int test_escape_string(void) {
+	TEST_START(escape_string);
+	char buf[1024];
+
+	struct escape_test tests[] = {
+		{ "", "", 0, 0 },
+		{ "Hello, World!", "Hello, World!", 13, 0 },
+		{ "\"\\", "\\\"\\\\", 4, 0 },
+		{ "\a\b\f\n\r\t\v", "\\a\\b\\f\\n\\r\\t\\v", 14, 0 },
+		{ "\x01\x7f\x80\xff", "\\x01\\x7f\\x80\\xff", 16, 0 },
+		{ "A\x1b[0m", "A\\x1b[0m", 8, 0 },
+	};
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(tests) ; ++i) {
+		struct escape_test *test = &tests[i];
+		size_t slen = strlen(test->input);
+
+		size_t res_len = escape_string(test->input, slen, NULL, 0);
+		size_t res = escape_string(test->input, slen, buf, sizeof(buf));
+		if (res_len != test->expected_len || res != test->expected_len || memcmp(buf, test->expected_output, res) != 0) {
+			TEST_ERRMSG("test %zu: expected '%s' (%zu), got '%.*s' (%zu, sizing %zu).", i, test->expected_output, test->expected_len, (int)res, buf, res, res_len);
+			++fails;
+		}
+	}
+
+	// Escape sequences are never split when dest is too small.
+	size_t res = escape_string("ab\n\x01", 4, buf, 5);
+	if (res != 4 || memcmp(buf, "ab\\n", 4) != 0) {
+		TEST_ERRMSG("truncation: expected '4', got '%zu'.", res);
+		++fails;
+	}
+
+	// Round-trip random data, with varying amounts of binary, through expand_escapes.
+	static char input[4096];
+	static char escaped[4*sizeof(input)];
+	static char output[sizeof(input)];
+	uint32_t x = 0xBADC0DE;
+	for (int round = 0 ; round < 200 ; ++round) {
+		size_t slen = (round * 37) % sizeof(input);
+		int binary_pct = round % 101;
+		for (size_t i = 0 ; i < slen ; ++i) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			input[i] = (int)(x % 100) < binary_pct ? (char)(x >> 8) : (char)(' ' + (x >> 8) % 95);
+		}
+
+		size_t elen = escape_string(input, slen, escaped, sizeof(escaped));
+		size_t sizing = escape_string(input, slen, NULL, 0);
+		if (elen != sizing) {
+			TEST_ERRMSG("round %d: escaped length '%zu' doesn't match sizing result '%zu'.", round, elen, sizing);
+			++fails;
+			break;
+		}
+		for (size_t i = 0 ; i < elen ; ++i) {
+			if (escaped[i] < 0x20 || escaped[i] > 0x7e) {
+				TEST_ERRMSG("round %d: unprintable character in output at position %zu.", round, i);
+				++fails;
+				break;
+			}
+		}
+
+		int err;
+		size_t olen = expand_escapes(escaped, elen, output, sizeof(output), &err);
+		if (err != 0 || olen != slen || memcmp(input, output, slen) != 0) {
+			TEST_ERRMSG("round %d: round-trip failed, err '%d', got length '%zu', expected '%zu'.", round, err, olen, slen);
+			++fails;
+			break;
+		}
+	}
+
 	TEST_END();
 }
 
@@ -146,6 +538,65 @@ static int test_buf_printf(void) {
 	TEST_END();
 }
 
+static int test_strbuf(void) {
+	TEST_START(strbuf);
+	struct strbuf sb;
+
+	strbuf_init(&sb);
+	strbuf_append_str(&sb, "u=");
+	strbuf_append_u64(&sb, 0);
+	strbuf_append_char(&sb, ',');
+	strbuf_append_u64(&sb, UINT64_MAX);
+	strbuf_append_str(&sb, " i=");
+	strbuf_append_i64(&sb, INT64_MIN);
+	strbuf_append_char(&sb, ',');
+	strbuf_append_i64(&sb, -7);
+	strbuf_append_char(&sb, ',');
+	strbuf_append_i64(&sb, 42);
+	strbuf_append_str(&sb, " x=");
+	strbuf_append_hex(&sb, 0);
+	strbuf_append_char(&sb, ',');
+	strbuf_append_hex(&sb, 0xdeadbeef01ULL);
+	strbuf_printf(&sb, " %s=%d", "printf", 123);
+
+	const char *expected = "u=0,18446744073709551615 i=-9223372036854775808,-7,42 x=0,deadbeef01 printf=123";
+	if (sb.len != strlen(expected) || strcmp(sb.buf, expected) != 0 || sb.truncated) {
+		TEST_ERRMSG("unexpected contents '%s' (%zu).", sb.buf, sb.len);
+		++fails;
+	}
+
+	// Growth past the initial capacity, through both append and printf.
+	strbuf_reset(&sb);
+	for (int i = 0 ; i < 1000 ; ++i) {
+		strbuf_append_u64(&sb, i % 10);
+		strbuf_printf(&sb, "%d", (i + 1) % 10);
+	}
+	if (sb.len != 2000 || sb.buf[1998] != '9' || sb.buf[1999] != '0' || sb.buf[2000] != 0) {
+		TEST_ERRMSG("growth failed, length '%zu'.", sb.len);
+		++fails;
+	}
+	strbuf_free(&sb);
+
+	// Fixed buffer truncates and stays zero-terminated.
+	char buf[8];
+	strbuf_init_fixed(&sb, buf, sizeof(buf));
+	strbuf_append_str(&sb, "abc");
+	size_t res = strbuf_append_u64(&sb, 123456);
+	if (res != 4 || sb.len != 7 || !sb.truncated || strcmp(buf, "abc1234") != 0) {
+		TEST_ERRMSG("fixed buffer truncation failed, got '%s' (%zu).", buf, res);
+		++fails;
+	}
+	strbuf_reset(&sb);
+	res = strbuf_printf(&sb, "%s", "0123456789");
+	if (res != 7 || !sb.truncated || strcmp(buf, "0123456") != 0) {
+		TEST_ERRMSG("fixed buffer printf truncation failed, got '%s' (%zu).", buf, res);
+		++fails;
+	}
+	strbuf_free(&sb);
+
+	TEST_END();
+}
+
 static int test_read_entire_file(void) {
 	TEST_START(read_entire_file);
 
@@ -171,15 +622,459 @@ static int test_read_entire_file(void) {
 		++fails;
 	}
 
+	int err = 0;
+	str = read_entire_file_ex("does/not/exist", &len, READFILE_SEQUENTIAL, &err);
+	if (str || err != ENOENT) {
+		TEST_ERRMSG("Expected ENOENT for missing file, got '%d'", err);
+		++fails;
+	}
+	free(str);
+
+	// procfs files report a size of zero.
+	str = read_entire_file_ex("/proc/self/status", &len, 0, &err);
+	if (!str || err != 0 || len == 0 || len != strlen(str) || strstr(str, "Pid:") == NULL) {
+		TEST_ERRMSG("Reading /proc/self/status failed, err '%d'", err);
+		++fails;
+	}
+	free(str);
+
+	// Pipe with more data than the initial buffer.
+	int fds[2];
+	if (pipe(fds) == 0) {
+		const size_t pipe_len = 200000;
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(fds[0]);
+			char block[1000];
+			memset(block, 'p', sizeof(block));
+			for (size_t i = 0 ; i < pipe_len / sizeof(block) ; ++i) {
+				if (write(fds[1], block, sizeof(block)) != (ssize_t)sizeof(block))
+					_exit(1);
+			}
+			_exit(0);
+		}
+		close(fds[1]);
+		str = read_entire_fd(fds[0], &len, READFILE_SEQUENTIAL, &err);
+		close(fds[0]);
+		waitpid(pid, NULL, 0);
+		if (!str || err != 0 || len != pipe_len || str[0] != 'p' || str[len - 1] != 'p' || str[len] != 0) {
+			TEST_ERRMSG("Reading from pipe failed, err '%d', got length '%zu'", err, len);
+			++fails;
+		}
+		free(str);
+	}
+
+	TEST_END();
+}
+
+static int test_read_entire_file_arena(void) {
+	TEST_START(read_entire_file_arena);
+
+	struct arena a;
+	arena_init(&a, 4096);
+
+	size_t len = 0;
+	int err = 0;
+	char *before = arena_alloc(&a, 1);
+	*before = 'x';
+	char *str = read_entire_file_arena(&a, "LICENSE", &len, 0, &err);
+	if (!str || err != 0 || len != 1079 || len != strlen(str) || strstr(str, "SOFTWARE.") == NULL) {
+		TEST_ERRMSG("Reading LICENSE into arena failed, err '%d'", err);
+		++fails;
+	}
+	char *after = arena_alloc_aligned(&a, 1, 1);
+	fails += after != str + len + 1;
+
+	// Failure leaves the arena as it was.
+	struct arena_pos pos = arena_mark(&a);
+	str = read_entire_file_arena(&a, "does/not/exist", &len, 0, &err);
+	fails += str != NULL || err != ENOENT;
+	fails += arena_mark(&a).ptr != pos.ptr;
+
+	// Streams grow past the chunk size, and give back the unused space.
+	str = read_entire_file_arena(&a, "/proc/self/status", &len, 0, &err);
+	if (!str || err != 0 || len == 0 || len != strlen(str) || strstr(str, "Pid:") == NULL) {
+		TEST_ERRMSG("Reading /proc/self/status into arena failed, err '%d'", err);
+		++fails;
+	}
+	fails += arena_alloc_aligned(&a, 1, 1) != str + len + 1;
+
+	int fds[2];
+	if (pipe(fds) == 0) {
+		const size_t pipe_len = 200000;
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(fds[0]);
+			char block[1000];
+			memset(block, 'q', sizeof(block));
+			for (size_t i = 0 ; i < pipe_len / sizeof(block) ; ++i) {
+				if (write(fds[1], block, sizeof(block)) != (ssize_t)sizeof(block))
+					_exit(1);
+			}
+			_exit(0);
+		}
+		close(fds[1]);
+		str = read_entire_fd_arena(&a, fds[0], &len, 0, &err);
+		close(fds[0]);
+		waitpid(pid, NULL, 0);
+		if (!str || err != 0 || len != pipe_len || str[0] != 'q' || str[len - 1] != 'q' || str[len] != 0) {
+			TEST_ERRMSG("Reading from pipe into arena failed, err '%d', got length '%zu'", err, len);
+			++fails;
+		}
+	}
+	fails += *before != 'x';
+
+	arena_free(&a);
+
+	TEST_END();
+}
+
+static int test_map_entire_file(void) {
+	TEST_START(map_entire_file);
+
+	struct file_map fm;
+	int err;
+	const char *str = map_entire_file("LICENSE", &fm, FILEMAP_SEQUENTIAL | FILEMAP_WILLNEED, &err);
+	if (str) {
+		fails += err != 0;
+		if (fm.len != strlen(str)) {
+			TEST_ERRMSG("File size returned doesn't match strlen");
+			++fails;
+		}
+		size_t expected_len = 1079;
+		if (fm.len != expected_len) {
+			TEST_ERRMSG("LICENSE file size mismatch, got '%zu', expected %zu", fm.len, expected_len);
+			++fails;
+		}
+		if (fm.maplen == 0) {
+			TEST_ERRMSG("LICENSE file was not mapped");
+			++fails;
+		}
+		if (strstr(str, "SOFTWARE.") == NULL) {
+			TEST_ERRMSG("LICENSE file contents mismatch.");
+			++fails;
+		}
+		unmap_file(&fm);
+	} else {
+		TEST_ERRMSG("Mapping LICENSE failed");
+		++fails;
+	}
+
+	// A file that ends exactly on a page boundary must still be zero-terminated.
+	char filename[] = "/tmp/eutils_test_XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd >= 0) {
+		size_t pagesize = sysconf(_SC_PAGESIZE);
+		char *page = malloc(pagesize);
+		memset(page, 'A', pagesize);
+		ssize_t res = write(fd, page, pagesize);
+		close(fd);
+		free(page);
+
+		str = map_entire_file(filename, &fm, FILEMAP_POPULATE, &err);
+		if (res != (ssize_t)pagesize || !str || fm.len != pagesize || str[pagesize - 1] != 'A' || str[pagesize] != 0) {
+			TEST_ERRMSG("Page-sized file not mapped with zero-terminator");
+			++fails;
+		}
+		if (str)
+			unmap_file(&fm);
+		unlink(filename);
+	} else {
+		TEST_ERRMSG("Creating temporary file failed");
+		++fails;
+	}
+
+	// Errors are reported, whether from the open or from the fallback read of e.g a directory.
+	str = map_entire_file("/nonexistent/eutils", &fm, 0, &err);
+	if (str || err != ENOENT) {
+		TEST_ERRMSG("Mapping a missing file: expected ENOENT, got '%d'", err);
+		++fails;
+	}
+	str = map_entire_file(".", &fm, 0, &err);
+	if (str || err != EISDIR) {
+		TEST_ERRMSG("Mapping a directory: expected EISDIR, got '%d'", err);
+		++fails;
+	}
+
+	TEST_END();
+}
+
+static size_t join_records(const char *input, size_t len, char delim, int flags, char *dest, size_t dlen) {
+	struct record_iter it;
+	struct record rec;
+	struct strbuf sb;
+
+	strbuf_init_fixed(&sb, dest, dlen);
+	record_iter_init(&it, input, len, delim, flags);
+	while (record_next(&it, &rec)) {
+		strbuf_append_char(&sb, '[');
+		strbuf_append(&sb, rec.ptr, rec.len);
+		strbuf_append_char(&sb, ']');
+	}
+	return sb.len;
+}
+
+static int test_record_iter(void) {
+	TEST_START(record_iter);
+	char buf[256];
+
+	struct {
+		const char *input;
+		char delim;
+		int flags;
+		const char *expected;
+	} tests[] = {
+		{ "", '\n', 0, "" },
+		{ "\n", '\n', 0, "[]" },
+		{ "a", '\n', 0, "[a]" },
+		{ "a\nb\n", '\n', 0, "[a][b]" },
+		{ "a\n\nb", '\n', 0, "[a][][b]" },
+		{ "a\r\nb", '\n', 0, "[a\r][b]" },
+		{ "a\r\nb\r\n\r\nc\r", '\n', RECORD_CRLF, "[a][b][][c]" },
+		{ "\r\r\n", '\n', RECORD_CRLF, "[\r]" },
+		{ "x,y,,z", ',', 0, "[x][y][][z]" },
+		{ "0123456789012345678901234567890123456789\nshort\n0123456789012345678901234567890\n", '\n', 0,
+			"[0123456789012345678901234567890123456789][short][0123456789012345678901234567890]" },
+	};
+
+	for (size_t i = 0 ; i < ARRAY_SIZE(tests) ; ++i) {
+		size_t res = join_records(tests[i].input, strlen(tests[i].input), tests[i].delim, tests[i].flags, buf, sizeof(buf));
+		if (res != strlen(tests[i].expected) || memcmp(buf, tests[i].expected, res) != 0) {
+			TEST_ERRMSG("test %zu: expected '%s', got '%.*s'.", i, tests[i].expected, (int)res, buf);
+			++fails;
+		}
+	}
+
+	// Random input, checked against a plain memchr() split, both from a buffer and streamed
+	// from a file through small buffers. The previous streamed record must still be intact.
+	static char input[8192];
+	static size_t starts[sizeof(input) + 1], lens[sizeof(input) + 1];
+	uint32_t x = 0x11FE;
+	FILE *f = tmpfile();
+	if (!f) {
+		TEST_ERRMSG("Creating temporary file failed");
+		++fails;
+		TEST_END();
+	}
+
+	for (int round = 0 ; round < 100 && fails == 0 ; ++round) {
+		size_t len = (round * 383) % sizeof(input);
+		int flags = round & 1 ? RECORD_CRLF : 0;
+		int density = 1 + round % 50;
+		for (size_t i = 0 ; i < len ; ++i) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			input[i] = (int)(x % 100) < density ? "\n\r"[(x >> 8) & 1] : (char)('a' + (x >> 8) % 26);
+		}
+
+		size_t num = 0;
+		for (size_t pos = 0 ; pos < len ; ) {
+			const char *nl = memchr(input + pos, '\n', len - pos);
+			size_t end = nl ? (size_t)(nl - input) : len;
+			starts[num] = pos;
+			lens[num] = end - pos - ((flags & RECORD_CRLF) && end > pos && input[end - 1] == '\r');
+			++num;
+			pos = end + 1;
+		}
+
+		struct record_iter it;
+		struct record rec;
+		size_t n = 0;
+		record_iter_init(&it, input, len, '\n', flags);
+		while (record_next(&it, &rec) && n < num) {
+			if (rec.ptr != input + starts[n] || rec.len != lens[n])
+				break;
+			++n;
+		}
+		if (n != num || record_next(&it, &rec)) {
+			TEST_ERRMSG("round %d: buffer record %zu of %zu mismatch.", round, n, num);
+			++fails;
+		}
+
+		rewind(f);
+		if (ftruncate(fileno(f), 0) != 0 || fwrite(input, 1, len, f) != len || fflush(f) != 0) {
+			TEST_ERRMSG("Writing temporary file failed");
+			++fails;
+			break;
+		}
+		for (size_t bufsize = 64 ; bufsize <= 4096 ; bufsize *= 8) {
+			struct record_stream rs;
+			struct record prev = { NULL, 0 };
+			lseek(fileno(f), 0, SEEK_SET);
+			record_stream_init(&rs, fileno(f), bufsize, '\n', flags);
+			n = 0;
+			while (record_stream_next(&rs, &rec) && n < num) {
+				if (rec.len != lens[n] || memcmp(rec.ptr, input + starts[n], rec.len) != 0)
+					break;
+				if (n > 0 && (prev.len != lens[n - 1] || memcmp(prev.ptr, input + starts[n - 1], prev.len) != 0))
+					break;
+				prev = rec;
+				++n;
+			}
+			if (n != num || rs.err || record_stream_next(&rs, &rec)) {
+				TEST_ERRMSG("round %d: stream record %zu of %zu mismatch with bufsize %zu.", round, n, num, bufsize);
+				++fails;
+			}
+			record_stream_free(&rs);
+		}
+	}
+	fclose(f);
+
+	TEST_END();
+}
+
+static int test_strview(void) {
+	TEST_START(strview);
+
+	struct strview a = STRVIEW("abc");
+	struct strview ab = { "abc", 2 };
+	struct strview nul = { "ab\0c", 4 };
+	fails += a.len != 3;
+	fails += !strview_eq(a, strview_cstr("abc"));
+	fails += strview_eq(a, ab);
+	fails += strview_cmp(a, ab) <= 0 || strview_cmp(ab, a) >= 0;
+	fails += strview_cmp(a, STRVIEW("abd")) >= 0;
+	fails += strview_cmp(nul, ab) <= 0;
+	fails += strview_cmp(STRVIEW(""), STRVIEW("")) != 0;
+
+	TEST_END();
+}
+
+static int test_strintern(void) {
+	TEST_START(strintern);
+
+	struct strintern si;
+	if (strintern_init(&si, 0) != 0) {
+		TEST_ERRMSG("strintern_init failed");
+		return 1;
+	}
+
+	char buf[32] = "hello";
+	const char *h = strintern(&si, strview_cstr(buf));
+	fails += h == buf || strcmp(h, "hello") != 0 || strintern_len(h) != 5;
+	fails += strintern(&si, STRVIEW("hello")) != h;
+	fails += strintern_find(&si, STRVIEW("hello")) != h;
+	fails += strintern_find(&si, STRVIEW("hell")) != NULL;
+
+	// Embedded zeros, prefixes and the empty string are all distinct.
+	const char *e = strintern(&si, STRVIEW(""));
+	const char *z = strintern(&si, (struct strview){ "hel\0lo", 6 });
+	const char *p = strintern(&si, STRVIEW("hel"));
+	fails += e == NULL || *e != 0 || strintern_len(e) != 0;
+	fails += z == p || strintern_len(z) != 6 || strintern_len(p) != 3;
+	fails += si.count != 4;
+
+	// Grow through several tables; earlier pointers stay valid.
+	const size_t n = 20000;
+	const char **ptrs = malloc(n * sizeof(*ptrs));
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t len = snprintf(buf, sizeof(buf), "sym_%zu", i);
+		ptrs[i] = strintern(&si, (struct strview){ buf, len });
+	}
+	fails += si.count != n + 4;
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t len = snprintf(buf, sizeof(buf), "sym_%zu", i);
+		if (strintern_find(&si, (struct strview){ buf, len }) != ptrs[i] || strcmp(ptrs[i], buf) != 0) {
+			TEST_ERRMSG("'%s' lost after growing", buf);
+			++fails;
+			break;
+		}
+	}
+	fails += strintern(&si, STRVIEW("hello")) != h || strcmp(h, "hello") != 0;
+	free(ptrs);
+
+	strintern_free(&si);
+
+	TEST_END();
+}
+
+#define INTERN_THREAD_STRINGS 50000
+
+struct intern_reader {
+	struct strintern *si;
+	_Atomic int *done;
+	int fails;
+	size_t found;
+};
+
+// Look up strings while they're being added. Anything found must be complete.
+static void *intern_reader_fn(void *arg) {
+	struct intern_reader *r = arg;
+	char buf[32];
+	for (size_t k = 0 ; !atomic_load(r->done) ; ++k) {
+		size_t len = snprintf(buf, sizeof(buf), "thread_%zu", k * 7919 % INTERN_THREAD_STRINGS);
+		const char *s = strintern_find(r->si, (struct strview){ buf, len });
+		if (s) {
+			r->fails += strintern_len(s) != len || strcmp(s, buf) != 0;
+			++r->found;
+		}
+		if (k % 1024 == 0)
+			sched_yield();
+	}
+	return NULL;
+}
+
+static int test_strintern_threads(void) {
+	TEST_START(strintern_threads);
+
+	struct strintern si;
+	if (strintern_init(&si, 0) != 0) {
+		TEST_ERRMSG("strintern_init failed");
+		return 1;
+	}
+
+	_Atomic int done = 0;
+	struct intern_reader readers[3];
+	pthread_t threads[ARRAY_SIZE(readers)];
+	size_t started = 0;
+	for ( ; started < ARRAY_SIZE(readers) ; ++started) {
+		readers[started] = (struct intern_reader){ .si = &si, .done = &done };
+		if (pthread_create(&threads[started], NULL, intern_reader_fn, &readers[started]) != 0)
+			break;
+	}
+
+	char buf[32];
+	for (size_t i = 0 ; i < INTERN_THREAD_STRINGS ; ++i) {
+		size_t len = snprintf(buf, sizeof(buf), "thread_%zu", i);
+		fails += strintern(&si, (struct strview){ buf, len }) == NULL;
+		if (i % 1024 == 0)
+			sched_yield();
+	}
+	atomic_store(&done, 1);
+
+	for (size_t t = 0 ; t < started ; ++t) {
+		pthread_join(threads[t], NULL);
+		if (readers[t].fails) {
+			TEST_ERRMSG("reader %zu saw %d bad strings", t, readers[t].fails);
+			fails += readers[t].fails;
+		}
+	}
+	fails += si.count != INTERN_THREAD_STRINGS;
+
+	strintern_free(&si);
+
 	TEST_END();
 }
 
 int main(int UNUSED(argc), char UNUSED(*argv[])) {
 	size_t failed = 0;
 
+	failed += test_hex_encode();
+	failed += test_fprint_hex();
+	failed += test_hex_decode();
 	failed += test_expand_escapes();
+	failed += test_escape_stream();
+	failed += test_escape_string();
 	failed += test_buf_printf();
+	failed += test_strbuf();
 	failed += test_read_entire_file(); // Requires 'LICENSE' file to be available in current directory.
+	failed += test_read_entire_file_arena(); // Ditto.
+	failed += test_map_entire_file(); // Ditto.
+	failed += test_record_iter();
+	failed += test_strview();
+	failed += test_strintern();
+	failed += test_strintern_threads();
 
 	if (failed != 0) {
 		printf("Tests " RED "FAILED" NC "\n");